@@ -32,7 +32,7 @@
  * Requirements:
  * RB9704 needs to be provisioned for messaging topic 244 (RAW).
  * Have an open view of the sky where a good signal can be obtained.
- * Compile the library with IMT_QUEUE_SIZE defined as your queue size (5 for this example).
+ * The queues are sized to 5 messages with rbSetConfig() before rbBegin().
  * 
  * (OPTIONAL) If you want to use and test MT queuing do the following:
  * Remove or adjust rbAcknowledgeReceiveHeadAsync() so that messages aren't acknowledged right away.
@@ -169,6 +169,11 @@ int main(int argc, char * argv[])
         };
         //Register Callbacks
         rbRegisterCallbacks(&myCallbacks);
+        //Room for 5 queued messages each way, applied by rbBegin()
+        rbConfig_t myConfig = {0};
+        myConfig.moQueueSize = 5;
+        myConfig.mtQueueSize = 5;
+        rbSetConfig(&myConfig);
         //Begin serial connection and initialise the modem
         if(rbBegin(_serialDevice))
         {
@@ -255,8 +260,9 @@ int main(int argc, char * argv[])
                 }
                 //put cool app stuff here!
                 
-                //rbPoll() needs to be called very frequently
-                usleep(10000);
+                //rbPoll() needs to be called very frequently, sleep until the modem has
+                //something for it (or 10ms passes) instead of spinning
+                rbWaitForEvent(10);
             }
 
             //End serial connection
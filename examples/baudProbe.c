@@ -0,0 +1,127 @@
+#include "rockblock_9704.h"
+#include <string.h>
+#include <getopt.h>
+#include <limits.h>
+#include "crossplatform.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#define access _access
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * This script initialises a serial session with the RB9704, then tries the
+ * serial rates in RB_BAUD_PROBE_RATES with rbProbeBaud(). Each rate gets a
+ * burst of GET apiVersion round trips, the table shows which rates passed
+ * and the throughput they reached. The session is left at the highest rate
+ * that passed before it is ended.
+ *
+ * The modem's own UART runs at RB9704_BAUD, higher rates only pass when a
+ * bridge between the host and the modem buffers the difference.
+*/
+
+static char _serialDevice[PATH_MAX];
+
+typedef enum
+{
+    SUCCESS = 0,
+    INVALID_DEVICE,
+    INVALID_ARGUMENTS,
+    FAILED_TO_END_CONNECTION,
+    FAILED_TO_PROBE,
+    FAILED_INIT_SERIAL,
+} returnCode_t;
+
+static struct option _longOptions[] =
+{
+    {"device", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+};
+
+static void printHelp(const char * progName)
+{
+    printf("Usage: %s -d <device> [-h]\n", progName);
+    printf("  -d, --device   Serial device to use (mandatory)\n");
+    printf("  -h, --help     Display this help message\n");
+}
+
+int main(int argc, char * argv[])
+{
+    returnCode_t rVal = SUCCESS;
+    bool gotArgs = true;
+    int opt = 0;
+    _serialDevice[0] = '\0';
+
+    while ((opt = getopt_long(argc, argv, "d:h", _longOptions, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                strncpy(_serialDevice, optarg, PATH_MAX -1);
+            break;
+
+            case 'h':
+                printHelp(argv[0]);
+                gotArgs = false;
+            break;
+
+            case '?':
+            // fall through
+            default:
+                printHelp(argv[0]);
+                rVal = INVALID_ARGUMENTS;
+            break;
+        }
+    }
+
+    if ((rVal == SUCCESS) && (gotArgs == true))
+    {
+        //Begin serial connection and initialise the modem
+        if(rbBegin(_serialDevice))
+        {
+            static const uint32_t rates[] = RB_BAUD_PROBE_RATES;
+            const size_t count = sizeof(rates) / sizeof(rates[0]);
+            rbBaudProbe_t results[sizeof(rates) / sizeof(rates[0])];
+
+            printf("Successfully started serial session with RB9704\r\n");
+            usleep(100000); //Wait at least 100ms before sending commands the first time you run rbBegin after boot.
+
+            const bool found = rbProbeBaud(rates, count, results);
+            printf("%10s %8s %12s %10s\r\n", "baud", "passed", "round trips", "bytes/s");
+            for(size_t i = 0; i < count; i++)
+            {
+                printf("%10u %8s %12u %10u\r\n", (unsigned int)results[i].baud, results[i].passed ? "yes" : "no",
+                       (unsigned int)results[i].roundTrips, (unsigned int)results[i].bytesPerSecond);
+            }
+            if(found)
+            {
+                printf("Running at %u baud\r\n", (unsigned int)rbGetBaud());
+            }
+            else
+            {
+                printf("No rate passed, still at %u baud\r\n", (unsigned int)rbGetBaud());
+                rVal = FAILED_TO_PROBE;
+            }
+
+            if(rbEnd())
+            {
+                printf("Ended connection successfully\r\n");
+            }
+            else
+            {
+                printf("Failed to end connection\r\n");
+                rVal = FAILED_TO_END_CONNECTION;
+            }
+        }
+        else
+        {
+            printf("Failed to begin the serial connection\r\n");
+            rVal = FAILED_INIT_SERIAL;
+        }
+    }
+
+    return rVal;
+}
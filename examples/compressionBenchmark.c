@@ -0,0 +1,188 @@
+#include "rockblock_9704.h"
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+/**
+ * This example measures what compressing a topic with rbSetTopicCodec() buys and what it costs,
+ * without a modem attached. It builds typical JSON telemetry records, compresses and decompresses
+ * them with the built-in rbCodecLz codec many times and reports the compression ratio against the
+ * CPU time added to every message.
+ *
+ * Four cases are run: a single record and a batch of records, each with no dictionary and with a
+ * dictionary made of a few sample records. Short messages barely compress on their own, the
+ * dictionary gives the codec something to match against from the first byte. The sizes include
+ * the one byte header the library adds on compressed topics.
+ *
+ * Requirements:
+ * None, nothing is sent.
+ *
+*/
+
+#define RECORD_MAX 256U
+#define BATCH_RECORDS 10U
+#define SAMPLE_COUNT 64U
+#define DICTIONARY_RECORDS 4U
+
+typedef enum
+{
+    SUCCESS = 0,
+    INVALID_ARGUMENTS,
+    FAILED_CODEC,
+} returnCode_t;
+
+static struct option _longOptions[] =
+{
+    {"iterations", required_argument, 0, 'n'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+};
+
+static void printHelp(const char * progName)
+{
+    printf("Usage: %s [-n <iterations>] [-h]\n", progName);
+    printf("  -n, --iterations  Times each sample is compressed (default 2000)\n");
+    printf("  -h, --help        Display this help message\n");
+}
+
+static size_t makeRecord(char * out, const unsigned int seq)
+{
+    static const char * states[] = { "moving", "stopped", "charging" };
+    const unsigned int r = (seq * 2654435761U) >> 8;
+    return (size_t)snprintf(out, RECORD_MAX,
+                            "{\"ts\":%u,\"lat\":%.5f,\"lon\":%.5f,\"alt\":%.1f,\"speed\":%.1f,\"batt\":%.2f,"
+                            "\"temp\":%.1f,\"sats\":%u,\"hdop\":%.1f,\"state\":\"%s\"}",
+                            1760700000U + seq * 60U, 51.50740 + (r % 1000) * 0.00001, -0.12780 - (r % 777) * 0.00001,
+                            30.0 + (r % 200) * 0.1, (r % 300) * 0.1, 3.60 + (r % 60) * 0.01, 15.0 + (r % 150) * 0.1,
+                            6U + r % 8U, 0.6 + (r % 20) * 0.1, states[r % 3U]);
+}
+
+static size_t makeBatch(char * out, const unsigned int seq)
+{
+    size_t length = 0;
+    out[length++] = '[';
+    for(unsigned int i = 0; i < BATCH_RECORDS; i++)
+    {
+        if(i > 0)
+        {
+            out[length++] = ',';
+        }
+        length += makeRecord(out + length, seq + i);
+    }
+    out[length++] = ']';
+    return length;
+}
+
+static bool runCase(const char * name, const rbCodec_t * codec, const bool batch, const unsigned int iterations)
+{
+    const size_t capacity = BATCH_RECORDS * (RECORD_MAX + 1U) + 2U;
+    char * samples = (char *)malloc(SAMPLE_COUNT * capacity);
+    size_t * lengths = (size_t *)malloc(SAMPLE_COUNT * sizeof(size_t));
+    uint8_t * packed = (uint8_t *)malloc(capacity);
+    uint8_t * unpacked = (uint8_t *)malloc(capacity);
+    size_t rawTotal = 0;
+    size_t packedTotal = 0;
+    bool ok = samples != NULL && lengths != NULL && packed != NULL && unpacked != NULL;
+
+    for(unsigned int s = 0; ok && s < SAMPLE_COUNT; s++)
+    {
+        lengths[s] = batch ? makeBatch(samples + s * capacity, 1000U + s * BATCH_RECORDS) : makeRecord(samples + s * capacity, 1000U + s);
+    }
+
+    clock_t compressTime = 0;
+    clock_t decompressTime = 0;
+    for(unsigned int s = 0; ok && s < SAMPLE_COUNT; s++)
+    {
+        const uint8_t * raw = (const uint8_t *)(samples + s * capacity);
+        size_t compressed = 0;
+        size_t decompressed = 0;
+
+        clock_t start = clock();
+        for(unsigned int i = 0; i < iterations; i++)
+        {
+            compressed = codec->compress(codec, raw, lengths[s], packed, lengths[s] - 1U);
+        }
+        compressTime += clock() - start;
+
+        if(compressed > 0)
+        {
+            start = clock();
+            for(unsigned int i = 0; i < iterations; i++)
+            {
+                decompressed = codec->decompress(codec, packed, compressed, unpacked, capacity);
+            }
+            decompressTime += clock() - start;
+            ok = decompressed == lengths[s] && memcmp(unpacked, raw, lengths[s]) == 0;
+        }
+        rawTotal += lengths[s];
+        packedTotal += 1U + ((compressed > 0) ? compressed : lengths[s]); //header, stored if it didn't shrink
+    }
+
+    if(ok)
+    {
+        const double messages = (double)SAMPLE_COUNT * iterations;
+        printf("%-26s %8.1f %8.1f %7.2f %12.2f %12.2f\n", name, (double)rawTotal / SAMPLE_COUNT,
+               (double)packedTotal / SAMPLE_COUNT, (double)rawTotal / (double)packedTotal,
+               (double)compressTime * 1e6 / CLOCKS_PER_SEC / messages,
+               (double)decompressTime * 1e6 / CLOCKS_PER_SEC / messages);
+    }
+    else
+    {
+        printf("%-26s round trip failed\n", name);
+    }
+    free(samples);
+    free(lengths);
+    free(packed);
+    free(unpacked);
+    return ok;
+}
+
+int main(int argc, char * argv[])
+{
+    returnCode_t ret = SUCCESS;
+    unsigned int iterations = 2000U;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:h", _longOptions, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                iterations = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'h':
+                printHelp(argv[0]);
+                return SUCCESS;
+            default:
+                printHelp(argv[0]);
+                return INVALID_ARGUMENTS;
+        }
+    }
+    if (iterations == 0)
+    {
+        printHelp(argv[0]);
+        return INVALID_ARGUMENTS;
+    }
+
+    //Dictionary from records the receiver also knows, not from the samples being measured
+    static char dictionary[DICTIONARY_RECORDS * RECORD_MAX];
+    size_t dictionaryLength = 0;
+    for(unsigned int i = 0; i < DICTIONARY_RECORDS; i++)
+    {
+        dictionaryLength += makeRecord(dictionary + dictionaryLength, i * 7U);
+    }
+    rbCodec_t primed = rbCodecLz;
+    primed.dictionary = (const uint8_t *)dictionary;
+    primed.dictionaryLength = dictionaryLength;
+
+    printf("%-26s %8s %8s %7s %12s %12s\n", "case", "raw B", "sent B", "ratio", "comp us/msg", "decomp us/msg");
+    if (!runCase("record", &rbCodecLz, false, iterations) ||
+        !runCase("record + dictionary", &primed, false, iterations) ||
+        !runCase("batch of 10", &rbCodecLz, true, iterations) ||
+        !runCase("batch of 10 + dictionary", &primed, true, iterations))
+    {
+        ret = FAILED_CODEC;
+    }
+    return ret;
+}
@@ -0,0 +1,144 @@
+#include "rockblock_9704.h"
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <limits.h>
+#include "crossplatform.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#define access _access
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * This script measures how long the RB9704 takes to answer a GET apiVersion
+ * request with the port opened as usual, then again with the low-latency tty
+ * profile (rbConfig_t.lowLatency), and prints both. Each run begins and ends
+ * its own serial session.
+ *
+ * On Linux the profile lowers the USB-serial adapter's latency_timer, which
+ * needs write access to /sys/bus/usb-serial/devices/<tty>/latency_timer (eg.
+ * run as root or add a udev rule), without it only the termios and
+ * ASYNC_LOW_LATENCY settings apply.
+*/
+
+static char _serialDevice[PATH_MAX];
+
+typedef enum
+{
+    SUCCESS = 0,
+    INVALID_DEVICE,
+    INVALID_ARGUMENTS,
+    FAILED_TO_END_CONNECTION,
+    FAILED_TO_MEASURE,
+    FAILED_INIT_SERIAL,
+} returnCode_t;
+
+static struct option _longOptions[] =
+{
+    {"device", required_argument, 0, 'd'},
+    {"count", required_argument, 0, 'n'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+};
+
+static void printHelp(const char * progName)
+{
+    printf("Usage: %s -d <device> [-n <round trips>] [-h]\n", progName);
+    printf("  -d, --device   Serial device to use (mandatory)\n");
+    printf("  -n, --count    Round trips per run (default %u)\n", RB_LATENCY_ROUND_TRIPS);
+    printf("  -h, --help     Display this help message\n");
+}
+
+static returnCode_t measure(const char * name, const bool lowLatency, const uint32_t roundTrips)
+{
+    returnCode_t rVal = SUCCESS;
+    rbConfig_t config;
+    rbLatency_t latency;
+
+    memset(&config, 0, sizeof(config));
+    config.lowLatency = lowLatency;
+    rbSetConfig(&config);
+
+    //Begin serial connection and initialise the modem
+    if(rbBegin(_serialDevice))
+    {
+        usleep(100000); //Wait at least 100ms before sending commands the first time you run rbBegin after boot.
+        if(rbMeasureLatency(roundTrips, &latency))
+        {
+            printf("%-12s %8u %10.2f %10.2f %10.2f\r\n", name, (unsigned int)latency.roundTrips,
+                   latency.minUs / 1000.0, latency.avgUs / 1000.0, latency.maxUs / 1000.0);
+        }
+        else
+        {
+            printf("%-12s failed after %u round trips\r\n", name, (unsigned int)latency.roundTrips);
+            rVal = FAILED_TO_MEASURE;
+        }
+
+        if(!rbEnd())
+        {
+            printf("Failed to end connection\r\n");
+            rVal = FAILED_TO_END_CONNECTION;
+        }
+    }
+    else
+    {
+        printf("Failed to begin the serial connection\r\n");
+        rVal = FAILED_INIT_SERIAL;
+    }
+    return rVal;
+}
+
+int main(int argc, char * argv[])
+{
+    returnCode_t rVal = SUCCESS;
+    bool gotArgs = true;
+    int opt = 0;
+    uint32_t roundTrips = RB_LATENCY_ROUND_TRIPS;
+    _serialDevice[0] = '\0';
+
+    while ((opt = getopt_long(argc, argv, "d:n:h", _longOptions, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                strncpy(_serialDevice, optarg, PATH_MAX -1);
+            break;
+
+            case 'n':
+                roundTrips = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+
+            case 'h':
+                printHelp(argv[0]);
+                gotArgs = false;
+            break;
+
+            case '?':
+            // fall through
+            default:
+                printHelp(argv[0]);
+                rVal = INVALID_ARGUMENTS;
+            break;
+        }
+    }
+    if ((rVal == SUCCESS) && (gotArgs == true) && (roundTrips == 0))
+    {
+        printHelp(argv[0]);
+        rVal = INVALID_ARGUMENTS;
+    }
+
+    if ((rVal == SUCCESS) && (gotArgs == true))
+    {
+        printf("%-12s %8s %10s %10s %10s\r\n", "profile", "trips", "min ms", "avg ms", "max ms");
+        rVal = measure("default", false, roundTrips);
+        if (rVal == SUCCESS)
+        {
+            rVal = measure("low latency", true, roundTrips);
+        }
+    }
+
+    return rVal;
+}
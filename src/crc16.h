@@ -0,0 +1,60 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @file crc16.h
+ * @brief CRC-16/CCITT (poly 0x1021, no reflection, no final xor) as used for IMT payloads.
+ */
+
+/**
+ * @def CRC16_SLICING
+ * @brief Process 8 bytes per step with 4kB of extra tables. Left out on Arduino,
+ * define CRC16_NO_SLICING to leave it out elsewhere.
+ */
+#if !defined(ARDUINO) && !defined(CRC16_NO_SLICING)
+    #define CRC16_SLICING
+#endif
+
+/**
+ * @def CRC16_CLMUL
+ * @brief Carry-less multiply folding on x86-64, only used when the CPU reports
+ * PCLMULQDQ at runtime. Define CRC16_NO_CLMUL to leave it out.
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(CRC16_NO_CLMUL)
+    #define CRC16_CLMUL
+#endif
+
+/**
+ * @brief Continue a CRC over more data, start with crc 0 for a new message.
+ *
+ * crc16Update(crc16Update(0, a, n), b, m) gives the same result as one call over
+ * a followed by b, so the CRC can follow segments as they arrive. The fastest
+ * implementation available on this CPU is picked on each call.
+ *
+ * @param crc CRC of the data so far.
+ * @param data Pointer to the next bytes, may be NULL if length is 0.
+ * @param length Number of bytes.
+ * @return CRC including the new bytes.
+ */
+uint16_t crc16Update(uint16_t crc, const uint8_t * data, size_t length);
+
+/**
+ * @brief Name of the implementation crc16Update() uses for long buffers.
+ *
+ * @return "pclmul", "slicing-by-8" or "bytewise".
+ */
+const char * crc16Implementation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
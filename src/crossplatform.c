@@ -23,6 +23,15 @@ unsigned long millis(void)
     return GetTickCount64();
 }
 
+unsigned long micros(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&count);
+    return (unsigned long)((count.QuadPart / frequency.QuadPart) * 1000000 + ((count.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+}
+
 void delay(uint32_t ms)
 {
     Sleep(ms);
@@ -40,6 +49,13 @@ unsigned long millis(void)
     return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+unsigned long micros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void delay(uint32_t ms)
 {
     usleep(ms * 1000); // usleep takes microseconds
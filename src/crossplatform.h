@@ -23,11 +23,13 @@ extern "C" {
     char * stpncpy (char * dst, const char * src, size_t len);
 
     unsigned long millis(void);
+    unsigned long micros(void);
     void delay(uint32_t ms);
 #elif defined(__linux__) || defined(__APPLE__)
     #include <stdint.h>
 
     unsigned long millis(void);
+    unsigned long micros(void);
     void delay(uint32_t ms);
 #endif
 
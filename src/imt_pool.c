@@ -0,0 +1,86 @@
+#include "imt_pool.h"
+#include <stdlib.h>
+
+static const size_t classSize[IMT_POOL_CLASS_COUNT] = {64U, 256U, 1024U, 4096U, IMT_POOL_MAX_BLOCK};
+
+static int findClass(size_t size)
+{
+    int sizeClass = -1;
+    for (int i = 0; i < (int)IMT_POOL_CLASS_COUNT; i++)
+    {
+        if (size <= classSize[i])
+        {
+            sizeClass = i;
+            break;
+        }
+    }
+    return sizeClass;
+}
+
+void * imtPoolAlloc(size_t size, void * context)
+{
+    imt_pool_t * pool = (imt_pool_t *)context;
+    void * block = NULL;
+    int sizeClass = findClass(size);
+
+    if (sizeClass < 0)
+    {
+        block = malloc(size);
+    }
+    else if (pool->freeList[sizeClass] != NULL)
+    {
+        block = pool->freeList[sizeClass];
+        pool->freeList[sizeClass] = pool->freeList[sizeClass]->next;
+        pool->freeCount[sizeClass]--;
+    }
+    else
+    {
+        block = malloc(classSize[sizeClass]);
+    }
+
+    if (block != NULL)
+    {
+        pool->bytesInUse += size;
+        if (pool->bytesInUse > pool->bytesHighWater)
+        {
+            pool->bytesHighWater = pool->bytesInUse;
+        }
+    }
+    return block;
+}
+
+void imtPoolFree(void * block, size_t size, void * context)
+{
+    imt_pool_t * pool = (imt_pool_t *)context;
+    int sizeClass = findClass(size);
+
+    if (block != NULL)
+    {
+        pool->bytesInUse -= size;
+        if (sizeClass >= 0 && pool->freeCount[sizeClass] < IMT_POOL_MAX_FREE)
+        {
+            imt_pool_block_t * freed = (imt_pool_block_t *)block;
+            freed->next = pool->freeList[sizeClass];
+            pool->freeList[sizeClass] = freed;
+            pool->freeCount[sizeClass]++;
+        }
+        else
+        {
+            free(block);
+        }
+    }
+}
+
+void imtPoolDrain(imt_pool_t * pool)
+{
+    for (uint16_t i = 0; i < IMT_POOL_CLASS_COUNT; i++)
+    {
+        while (pool->freeList[i] != NULL)
+        {
+            imt_pool_block_t * next = pool->freeList[i]->next;
+            free(pool->freeList[i]);
+            pool->freeList[i] = next;
+        }
+        pool->freeCount[i] = 0;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef IMT_POOL_H
+#define IMT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @def IMT_POOL_CLASS_COUNT
+ * @brief Number of block size classes kept by the pool, 64 bytes up to IMT_POOL_MAX_BLOCK.
+ */
+#define IMT_POOL_CLASS_COUNT 5U
+
+/**
+ * @def IMT_POOL_MAX_BLOCK
+ * @brief Largest pooled block, bigger requests go straight to the heap and back.
+ */
+#define IMT_POOL_MAX_BLOCK 16384U
+
+/**
+ * @def IMT_POOL_MAX_FREE
+ * @brief Number of freed blocks kept for reuse in each size class.
+ */
+#ifndef IMT_POOL_MAX_FREE
+    #define IMT_POOL_MAX_FREE 8U
+#endif
+
+/**
+ * @struct imt_pool_block_t
+ * @brief Header written into a cached block to chain it on its free list.
+ */
+typedef struct imt_pool_block
+{
+    struct imt_pool_block * next;   /**< Next free block of the same size class */
+} imt_pool_block_t;
+
+/**
+ * @struct imt_pool_t
+ * @brief Size classed block pool backing the IMT queues.
+ *
+ * Blocks are rounded up to 64, 256, 1024, 4096 or 16384 bytes and cached on a
+ * free list when released, so a steady stream of small messages stops hitting
+ * the heap once warmed up. Anything larger than IMT_POOL_MAX_BLOCK is a plain
+ * heap allocation.
+ */
+typedef struct
+{
+    imt_pool_block_t * freeList[IMT_POOL_CLASS_COUNT];  /**< Cached blocks per size class */
+    uint16_t freeCount[IMT_POOL_CLASS_COUNT];           /**< Number of cached blocks per size class */
+    size_t bytesInUse;                                  /**< Bytes currently handed out */
+    size_t bytesHighWater;                              /**< Highest value bytesInUse has reached */
+} imt_pool_t;
+
+/**
+ * @brief Allocate a block, matches the imt_allocator_t alloc signature.
+ *
+ * @param size Number of bytes needed.
+ * @param context Pointer to the imt_pool_t.
+ * @return Pointer to the block, NULL if out of memory.
+ */
+void * imtPoolAlloc(size_t size, void * context);
+
+/**
+ * @brief Return a block, matches the imt_allocator_t free signature.
+ *
+ * @param block Pointer returned by imtPoolAlloc(), may be NULL.
+ * @param size The size that was passed to imtPoolAlloc().
+ * @param context Pointer to the imt_pool_t.
+ */
+void imtPoolFree(void * block, size_t size, void * context);
+
+/**
+ * @brief Give every cached block back to the heap.
+ *
+ * @param pool Pointer to the pool.
+ */
+void imtPoolDrain(imt_pool_t * pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
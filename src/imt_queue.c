@@ -1,202 +1,377 @@
 #include "imt_queue.h"
 
-static imt_queue_t imtMo;
-static imt_queue_t imtMt;
+static void freeBlocks(imt_queue_t * queue, imt_t * message)
+{
+    if(message->buffer != NULL)
+    {
+        if(queue->secureWipe)
+        {
+            volatile uint8_t * wipe = message->buffer;
+            for(size_t i = 0; i < message->capacity; i++)
+            {
+                wipe[i] = 0;
+            }
+        }
+        else
+        {
+            memset(message->buffer, 0, message->used); //only what was written
+        }
+        queue->allocator.free(message->buffer, message->capacity, queue->allocator.context);
+    }
+    if(message->segmentMap != NULL)
+    {
+        queue->allocator.free(message->segmentMap, (message->capacity + 7U) / 8U, queue->allocator.context);
+    }
+}
+
+static void clearMessage(imt_queue_t * queue, imt_t * message)
+{
+    if(message->buffer == NULL && message->payload != NULL && message->release != NULL)
+    {
+        message->release((const char *)message->payload, message->releaseContext); //hand borrowed payload back
+    }
+    freeBlocks(queue, message);
+    message->buffer = NULL;
+    message->capacity = 0;
+    message->used = 0;
+    message->payload = NULL;
+    message->release = NULL;
+    message->releaseContext = NULL;
+    memset(message->crc, 0, IMT_CRC_SIZE);
+    message->crcRunning = 0;
+    message->crcOffset = 0;
+    message->requestReference = 0;
+    message->idSet = false;
+    message->awaited = false;
+    message->received = 0;
+    message->segmentMap = NULL;
+    message->sequence = 0;
+    message->priority = 0;
+    message->id = 0;
+    message->topic = 0;
+    message->length = 0;
+    message->readyToProcess = false;
+    message->ready = false;
+}
+
+static bool reserveBuffer(imt_queue_t * queue, imt_t * message, const size_t length)
+{
+    message->buffer = (uint8_t *)queue->allocator.alloc(length, queue->allocator.context);
+    message->capacity = (message->buffer != NULL) ? length : 0;
+    return message->buffer != NULL;
+}
+
+imt_t * imtQueueMoReserve(imt_queue_t * queue, const uint16_t topic, const size_t capacity)
+{
+    imt_t * reserved = NULL;
+    uint16_t tempTail = queue->tail;
+    if(capacity > 0 && capacity <= IMT_PAYLOAD_SIZE)
+    {
+        if(queue->count >= queue->maxLength && !queue->locked)
+        {
+            imtQueueRemove(queue); //remove oldest entry if queue is full
+            tempTail = queue->tail;
+        }
 
-static uint8_t imtMoBuffer[IMT_QUEUE_SIZE][IMT_PAYLOAD_SIZE];
-static uint8_t imtMtBuffer[IMT_QUEUE_SIZE][IMT_PAYLOAD_SIZE];
+        if(queue->count < queue->maxLength && reserveBuffer(queue, &queue->messages[tempTail], capacity))
+        {
+            reserved = &queue->messages[tempTail];
+            reserved->payload = reserved->buffer;
+            reserved->topic = topic;
 
-static volatile bool mtLock = false;
-static volatile bool moLock = true;
+            queue->tail = (tempTail + 1) % queue->maxLength;
+            queue->count++;
+        }
+    }
+    return reserved;
+}
 
-extern uint16_t moQueuedMessages;
+bool imtQueueMoAdd(imt_queue_t * queue, const uint16_t topic, const char * data, const size_t length)
+{
+    imt_t * imtMo = (data != NULL) ? imtQueueMoReserve(queue, topic, length) : NULL;
+    if(imtMo != NULL)
+    {
+        memcpy(imtMo->buffer, data, length);
+        imtMo->used = length;
+        imtMo->length = length;
+    }
+    return imtMo != NULL;
+}
 
-bool imtQueueMoAdd(uint16_t topic, const char * data, const size_t length)
+bool imtQueueMoBorrow(imt_queue_t * queue, const uint16_t topic, const char * data, const size_t length,
+                      imtReleaseFunc release, void * context)
 {
     bool queued = false;
-    uint16_t tempTail = imtMo.tail;
+    uint16_t tempTail = queue->tail;
     if(data != NULL && length > 0)
     {
-        if(imtMo.count >= imtMt.maxLength && !moLock)
+        if(queue->count >= queue->maxLength && !queue->locked)
         {
-            imtQueueMoRemove(); //remove oldest entry if queue is full
+            imtQueueRemove(queue); //remove oldest entry if queue is full
+            tempTail = queue->tail;
         }
 
-        if(imtMo.count < imtMo.maxLength)
+        if(queue->count < queue->maxLength)
         {
-            memcpy(imtMoBuffer[tempTail], data, length);
-            imtMo.messages[tempTail].topic = topic;
-            imtMo.messages[tempTail].length = length;
+            queue->messages[tempTail].payload = (const uint8_t *)data;
+            queue->messages[tempTail].release = release;
+            queue->messages[tempTail].releaseContext = context;
+            queue->messages[tempTail].topic = topic;
+            queue->messages[tempTail].length = length;
             queued = true;
 
-            imtMo.tail = (tempTail + 1) % imtMo.maxLength;
-            imtMo.count++;
+            queue->tail = (tempTail + 1) % queue->maxLength;
+            queue->count++;
         }
     }
     return queued;
 }
 
-bool imtQueueMtAdd(const uint16_t topic, const uint16_t id, const size_t length)
+bool imtQueueMtAdd(imt_queue_t * queue, const uint16_t topic, const uint16_t id, const size_t length)
 {
     bool queued = false;
-    uint16_t tempTail = imtMt.tail;
-    if(id >= 0 && length > 0)
+    uint16_t tempTail = queue->tail;
+    if(length > 0 && length <= IMT_PAYLOAD_SIZE)
     {
-        if(imtMt.count >= imtMt.maxLength && !mtLock)
+        if(queue->count >= queue->maxLength && !queue->locked)
         {
-            imtQueueMtRemove(); //remove oldest entry if queue is full
+            imtQueueRemove(queue); //remove oldest entry if queue is full
+            tempTail = queue->tail;
         }
 
-        if(imtMt.count < imtMt.maxLength)
+        if(queue->count < queue->maxLength && reserveBuffer(queue, &queue->messages[tempTail], length))
         {
-            imtMt.messages[tempTail].id = id;
-            imtMt.messages[tempTail].topic = topic;
-            imtMt.messages[tempTail].length = length;
+            queue->messages[tempTail].id = id;
+            queue->messages[tempTail].topic = topic;
+            queue->messages[tempTail].length = length;
             queued = true;
 
-            imtMt.tail = (tempTail + 1) % imtMt.maxLength;
-            imtMt.count++;
+            queue->tail = (tempTail + 1) % queue->maxLength;
+            queue->count++;
         }
     }
     return queued;
 }
 
-void imtQueueMtLock(bool lock)
+void imtQueueSetBuffer(imt_queue_t * queue, imt_t * message, uint8_t * buffer, const size_t capacity, const size_t used)
 {
-    if(lock)
-    {
-        mtLock = true;
-    }
-    else
+    freeBlocks(queue, message);
+    message->buffer = buffer;
+    message->capacity = capacity;
+    message->used = used;
+    message->payload = buffer;
+    message->segmentMap = NULL;
+}
+
+bool imtQueueMtSegment(imt_queue_t * queue, imt_t * message, const size_t start, const size_t length)
+{
+    bool recorded = false;
+    const size_t end = start + length;
+
+    if(message->buffer != NULL && length > 0 && end <= message->capacity)
     {
-        mtLock = false;
+        if(message->segmentMap == NULL && start == message->received)
+        {
+            message->received = end; //in order, everything before start is already here
+            recorded = true;
+        }
+        else
+        {
+            if(message->segmentMap == NULL)
+            {
+                const size_t mapSize = (message->capacity + 7U) / 8U;
+                message->segmentMap = (uint8_t *)queue->allocator.alloc(mapSize, queue->allocator.context);
+                if(message->segmentMap != NULL)
+                {
+                    memset(message->segmentMap, 0, mapSize);
+                    for(size_t i = 0; i < message->received; i++)
+                    {
+                        message->segmentMap[i / 8U] |= (uint8_t)(1U << (i % 8U));
+                    }
+                }
+            }
+            if(message->segmentMap != NULL)
+            {
+                for(size_t i = start; i < end; i++)
+                {
+                    const uint8_t bit = (uint8_t)(1U << (i % 8U));
+                    if((message->segmentMap[i / 8U] & bit) == 0)
+                    {
+                        message->segmentMap[i / 8U] |= bit;
+                        message->received++;
+                    }
+                }
+                recorded = true;
+            }
+        }
     }
+    return recorded;
 }
 
-void imtQueueMoLock(bool lock)
+void imtQueueLock(imt_queue_t * queue, bool lock)
 {
     if(lock)
     {
-        moLock = true;
+        queue->locked = true;
     }
     else
     {
-        moLock = false;
+        queue->locked = false;
     }
 }
 
-imt_t * imtQueueMoGetFirst(void)
+imt_t * imtQueueGetFirst(imt_queue_t * queue)
 {
-    imt_t * mo = NULL;
+    imt_t * message = NULL;
 
-    if(imtMo.count > 0)
+    if(queue->count > 0)
     {
-        mo = &imtMo.messages[imtMo.head];
+        message = &queue->messages[queue->head];
     }
 
-    return mo;
+    return message;
 }
 
-imt_t * imtQueueMtGetFirst(void)
+imt_t * imtQueueGetLast(imt_queue_t * queue)
 {
-    imt_t * mt = NULL;
+    imt_t * message = NULL;
 
-    if(imtMt.count > 0)
+    if(queue->count > 0)
     {
-        mt = &imtMt.messages[imtMt.head];
+        message = &queue->messages[(queue->tail == 0) ? (queue->maxLength - 1) : (queue->tail - 1)]; //last added message
     }
 
-    return mt;
+    return message;
 }
 
-imt_t * imtQueueMtGetLast(void)
+imt_t * imtQueueGetAt(imt_queue_t * queue, const uint16_t index)
 {
-    imt_t * mt = NULL;
+    imt_t * message = NULL;
 
-    if(imtMt.count > 0)
+    if(index < queue->count)
     {
-        mt = &imtMt.messages[(imtMt.tail == 0) ? (imtMt.maxLength - 1) : (imtMt.tail - 1)]; //last added message
+        message = &queue->messages[(queue->head + index) % queue->maxLength];
     }
 
-    return mt;
+    return message;
 }
 
-bool imtQueueMoRemove(void)
+bool imtQueueRemove(imt_queue_t * queue)
 {
     bool removed = false;
-    imt_t * mo = imtQueueMoGetFirst();
-    if(mo != NULL)
-    {
-        uint16_t tempHead = imtMo.head;
-        memset(mo->buffer, 0, IMT_PAYLOAD_SIZE);
-        mo->id = 0;
-        mo->topic = 0;
-        mo->length = 0;
-        mo->readyToProcess = false;
-        mo->ready = false;
-
-        imtMo.head = (tempHead + 1) % imtMo.maxLength;
-        imtMo.count--;
-        if(moQueuedMessages > 0)
-        {
-            moQueuedMessages--;
-        }
+    imt_t * message = imtQueueGetFirst(queue);
+    if(message != NULL)
+    {
+        uint16_t tempHead = queue->head;
+        clearMessage(queue, message);
+
+        queue->head = (tempHead + 1) % queue->maxLength;
+        queue->count--;
         removed = true;
     }
     return removed;
 }
 
-bool imtQueueMtRemove(void)
+bool imtQueueRemoveLast(imt_queue_t * queue)
 {
     bool removed = false;
-    imt_t * mt = imtQueueMtGetFirst();
-    if(mt != NULL)
-    {
-        uint16_t tempHead = imtMt.head;
-        memset(mt->buffer, 0, IMT_PAYLOAD_SIZE);
-        mt->id = 0;
-        mt->topic = 0;
-        mt->length = 0;
-        mt->readyToProcess = false;
-        mt->ready = false;
-
-        imtMt.head = (tempHead + 1) % imtMt.maxLength;
-        imtMt.count--;
+    imt_t * message = imtQueueGetLast(queue);
+    if(message != NULL)
+    {
+        clearMessage(queue, message);
+
+        queue->tail = (queue->tail == 0) ? (queue->maxLength - 1) : (queue->tail - 1);
+        queue->count--;
         removed = true;
     }
     return removed;
 }
 
-void imtQueueInit(void)
+bool imtQueueRemoveAt(imt_queue_t * queue, const uint16_t index)
 {
-    for (uint16_t i = 0; i < IMT_QUEUE_SIZE; i++)
+    bool removed = false;
+    if(index == 0)
     {
-        imtMo.messages[i].buffer = imtMoBuffer[i];
-        memset(imtMo.messages[i].buffer, 0, IMT_PAYLOAD_SIZE);
-        imtMo.messages[i].id = 0;
-        imtMo.messages[i].length = 0;
-        imtMo.messages[i].ready = false;
-        imtMo.messages[i].readyToProcess = false;
-        imtMo.messages[i].topic = 0;
+        removed = imtQueueRemove(queue);
+    }
+    else if(index < queue->count)
+    {
+        clearMessage(queue, imtQueueGetAt(queue, index));
+        for(uint16_t i = index; i + 1U < queue->count; i++) //close the gap, order is kept
+        {
+            queue->messages[(queue->head + i) % queue->maxLength] = queue->messages[(queue->head + i + 1U) % queue->maxLength];
+        }
 
+        queue->tail = (queue->tail == 0) ? (queue->maxLength - 1) : (queue->tail - 1);
+        memset(&queue->messages[queue->tail], 0, sizeof(imt_t)); //its contents moved up a slot
+        queue->count--;
+        removed = true;
+    }
+    return removed;
+}
 
-        imtMt.messages[i].buffer = imtMtBuffer[i];
-        memset(imtMt.messages[i].buffer, 0, IMT_PAYLOAD_SIZE);
-        imtMt.messages[i].id = 0;
-        imtMt.messages[i].length = 0;
-        imtMt.messages[i].ready = false;
-        imtMt.messages[i].readyToProcess = false;
-        imtMt.messages[i].topic = 0;
+bool imtQueueMove(imt_queue_t * queue, const uint16_t from, const uint16_t to)
+{
+    bool moved = false;
+    if(from < queue->count && to < queue->count)
+    {
+        const imt_t message = *imtQueueGetAt(queue, from);
+        for(uint16_t i = from; i > to; i--) //towards the head
+        {
+            queue->messages[(queue->head + i) % queue->maxLength] = queue->messages[(queue->head + i - 1U) % queue->maxLength];
+        }
+        for(uint16_t i = from; i < to; i++) //towards the tail
+        {
+            queue->messages[(queue->head + i) % queue->maxLength] = queue->messages[(queue->head + i + 1U) % queue->maxLength];
+        }
+        queue->messages[(queue->head + to) % queue->maxLength] = message;
+        moved = true;
+    }
+    return moved;
+}
+
+void imtQueueSecureWipe(imt_queue_t * queue, bool wipe)
+{
+    queue->secureWipe = wipe;
+}
+
+void imtQueueInit(imt_queue_t * queue)
+{
+    for (uint16_t i = 0; i < queue->maxLength; i++)
+    {
+        clearMessage(queue, &queue->messages[i]);
     }
 
-    imtMo.head = 0;
-    imtMo.tail = 0;
-    imtMo.count = 0;
-    imtMo.maxLength = IMT_QUEUE_SIZE;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->count = 0;
+}
 
-    imtMt.head = 0;
-    imtMt.tail = 0;
-    imtMt.count = 0;
-    imtMt.maxLength = IMT_QUEUE_SIZE;
+bool imtQueueCreate(imt_queue_t * queue, const uint16_t depth, const imt_allocator_t * allocator)
+{
+    bool created = false;
+    imtQueueDestroy(queue);
+    if(depth > 0 && allocator != NULL && allocator->alloc != NULL && allocator->free != NULL)
+    {
+        queue->allocator = *allocator;
+        queue->messages = (imt_t *)queue->allocator.alloc(depth * sizeof(imt_t), queue->allocator.context);
+        if(queue->messages != NULL)
+        {
+            memset(queue->messages, 0, depth * sizeof(imt_t));
+            queue->maxLength = depth;
+            created = true;
+        }
+    }
+    return created;
+}
 
-}
\ No newline at end of file
+void imtQueueDestroy(imt_queue_t * queue)
+{
+    imtQueueInit(queue);
+    if(queue->messages != NULL)
+    {
+        queue->allocator.free(queue->messages, queue->maxLength * sizeof(imt_t), queue->allocator.context);
+    }
+    queue->messages = NULL;
+    queue->maxLength = 0;
+}
@@ -12,7 +12,7 @@ extern "C" {
 
 /**
  * @def IMT_QUEUE_SIZE
- * @brief Number of messages allowed in the internal message queue.
+ * @brief Default number of messages allowed in a queue, can be changed at runtime with imtQueueCreate().
  */
 #ifndef IMT_QUEUE_SIZE
     #define IMT_QUEUE_SIZE 1U
@@ -38,18 +38,63 @@ extern "C" {
     #endif
 #endif
 
+/**
+ * @def IMT_SECURE_WIPE
+ * @brief Define to wipe the whole payload block of every removed message by default,
+ * see imtQueueSecureWipe(). Otherwise only the bytes written are cleared.
+ */
+#ifdef IMT_SECURE_WIPE
+    #define IMT_SECURE_WIPE_DEFAULT true
+#else
+    #define IMT_SECURE_WIPE_DEFAULT false
+#endif
+
+/**
+ * @struct imt_allocator_t
+ * @brief Memory hooks used for the message table and payload blocks of a queue.
+ */
+typedef struct
+{
+    void * (*alloc)(size_t size, void * context);               /**< Return a block of at least size bytes, NULL on failure */
+    void (*free)(void * block, size_t size, void * context);    /**< Give back a block, size is the one it was allocated with */
+    void * context;                                             /**< User pointer passed to both hooks */
+} imt_allocator_t;
+
+/**
+ * @brief Called once the queue no longer references a borrowed MO payload.
+ *
+ * @param data Pointer to the payload that was lent with imtQueueMoBorrow().
+ * @param context User pointer given to imtQueueMoBorrow().
+ */
+typedef void (*imtReleaseFunc)(const char * data, void * context);
+
 /**
  * @struct imt_t
  * @brief Represents a single message in the queue.
  */
 typedef struct
 {
-    uint16_t id;            /**< Message ID assigned by the modem */
-    uint8_t * buffer;       /**< Pointer to the buffer where the message payload is stored */
-    size_t length;          /**< Length of the message payload */
-    uint16_t topic;         /**< Message topic ID */
-    bool readyToProcess;    /**< Used to determine if the message is ready for processing */
-    bool ready;             /**< Used to determine if the message is fully processed */
+    uint16_t id;                /**< Message ID assigned by the modem */
+    uint8_t * buffer;           /**< Payload block owned by the queue, NULL when empty or borrowed */
+    size_t capacity;            /**< Size of buffer in bytes */
+    size_t used;                /**< Bytes of buffer written so far, cleared on removal */
+    const uint8_t * payload;    /**< MO payload, either buffer or memory lent by the caller */
+    size_t length;              /**< Length of the message payload */
+    uint16_t topic;             /**< Message topic ID */
+    uint8_t crc[IMT_CRC_SIZE];  /**< MO CRC, sent after the payload */
+    uint16_t crcRunning;        /**< MT CRC over the first crcOffset bytes, trailing CRC included */
+    size_t crcOffset;           /**< MT bytes folded into crcRunning as segments arrived in order */
+    size_t received;            /**< MT bytes received, each segment counted once */
+    uint8_t * segmentMap;       /**< MT bit per byte received, only allocated once segments arrive out of order */
+    uint32_t sequence;          /**< Order the message was handed to the application in, 0 if it hasn't been */
+    uint8_t priority;           /**< MO scheduling priority of its topic, lower is sent first */
+    uint8_t requestReference;   /**< MO request_reference of its PUT messageOriginate, 0 until sent */
+    bool idSet;                 /**< MO id has been assigned by the modem */
+    bool awaited;               /**< MO a blocking send is waiting on */
+    imtReleaseFunc release;     /**< Called when a borrowed payload is dropped, may be NULL */
+    void * releaseContext;      /**< User pointer handed back to release */
+    bool readyToProcess;        /**< Used to determine if the message is ready for processing */
+    bool ready;                 /**< Used to determine if the message is fully processed */
 } imt_t;
 
 /**
@@ -58,91 +103,201 @@ typedef struct
  */
 typedef struct
 {
-    imt_t messages[IMT_QUEUE_SIZE]; /**< Array of queued messages */
-    uint16_t count;                 /**< Number of messages in queue */
-    uint16_t head;                  /**< Index of the message at the front */
-    uint16_t tail;                  /**< Index of the next free space for a message */
-    uint16_t maxLength;             /**< Maximum length of the queue */
+    imt_t * messages;           /**< Array of maxLength queued messages */
+    uint16_t count;             /**< Number of messages in queue */
+    uint16_t head;              /**< Index of the message at the front */
+    uint16_t tail;              /**< Index of the next free space for a message */
+    uint16_t maxLength;         /**< Maximum length of the queue */
+    volatile bool locked;       /**< Prevents the oldest message being discarded when full */
+    bool secureWipe;            /**< Wipe the whole block on removal instead of the used bytes */
+    imt_allocator_t allocator;  /**< Where the message array and payload blocks come from */
 } imt_queue_t;
 
 /**
  * @brief Add an outgoing mobile-originated (MO) message to the queue.
  * 
+ * @param queue Pointer to the MO queue.
  * @param topic Message topic ID.
  * @param data Pointer to the message payload.
  * @param length Message payload length in bytes.
  * @return Bool indicating success or failure to add the message to the queue.
  */
-bool imtQueueMoAdd(const uint16_t topic, const char * data, const size_t length);
+bool imtQueueMoAdd(imt_queue_t * queue, const uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Add an outgoing mobile-originated (MO) message and leave its payload for the caller to write.
+ * 
+ * @param queue Pointer to the MO queue.
+ * @param topic Message topic ID.
+ * @param capacity Size of the payload block to reserve.
+ * @return The new entry, NULL if it couldn't be added. Write up to capacity bytes
+ * to its buffer, then set used and length.
+ * 
+ * @note Use imtQueueRemoveLast() to give the entry back if the payload can't be written.
+ */
+imt_t * imtQueueMoReserve(imt_queue_t * queue, const uint16_t topic, const size_t capacity);
+
+/**
+ * @brief Add an outgoing mobile-originated (MO) message without copying the payload.
+ * 
+ * @param queue Pointer to the MO queue.
+ * @param topic Message topic ID.
+ * @param data Pointer to the message payload, must stay valid until release is called.
+ * @param length Message payload length in bytes.
+ * @param release Called once the message leaves the queue, may be NULL.
+ * @param context User pointer passed to release.
+ * @return Bool indicating success or failure to add the message to the queue.
+ * 
+ * @note release is not called when the message could not be added.
+ */
+bool imtQueueMoBorrow(imt_queue_t * queue, const uint16_t topic, const char * data, const size_t length,
+                      imtReleaseFunc release, void * context);
 
 /**
  * @brief Add an incoming mobile-terminated (MT) message to the queue.
  * 
+ * @param queue Pointer to the MT queue.
  * @param topic Message topic ID.
  * @param id Unique identifier of the message assigned by the modem.
- * @param length Message payload length in bytes.
+ * @param length Message payload length in bytes, a block of this size is reserved.
  * @return Bool indicating success or failure to add the message to the queue.
  */
-bool imtQueueMtAdd(const uint16_t topic, const uint16_t id, const size_t length);
+bool imtQueueMtAdd(imt_queue_t * queue, const uint16_t topic, const uint16_t id, const size_t length);
 
 /**
- * @brief Remove an outgoing mobile-originated (MO) message from the queue.
+ * @brief Remove the message at the head of the queue.
  * 
+ * @param queue Pointer to the selected queue.
  * @return Bool indicating success or failure to remove the message from the queue.
  */
-bool imtQueueMoRemove(void);
+bool imtQueueRemove(imt_queue_t * queue);
 
 /**
- * @brief Remove an outgoing mobile-terminated (MT) message from the queue.
+ * @brief Remove the most recently added message from the queue.
  * 
+ * @param queue Pointer to the selected queue.
  * @return Bool indicating success or failure to remove the message from the queue.
  */
-bool imtQueueMtRemove(void);
+bool imtQueueRemoveLast(imt_queue_t * queue);
 
 /**
- * @brief Get the address of the head of the MO queue.
+ * @brief Move a message to another position, the messages between shift by one.
  * 
- * @return Pointer to the next message in the queue, NULL if queue is empty.
+ * @param queue Pointer to the queue.
+ * @param from Position of the message, 0 is the head.
+ * @param to Position to move it to.
+ * @return false if either position is outside the queue.
  */
-imt_t * imtQueueMoGetFirst(void);
+bool imtQueueMove(imt_queue_t * queue, const uint16_t from, const uint16_t to);
 
 /**
- * @brief Get the address of the head of the MT queue.
+ * @brief Record that a segment of an MT has arrived.
+ *
+ * In order segments only move received on, the first one out of order
+ * allocates a map of every byte so repeats are not counted twice.
  * 
+ * @param queue Pointer to the queue holding the message.
+ * @param message Pointer to the MT.
+ * @param start Offset of the segment in the message.
+ * @param length Length of the segment.
+ * @return false if the segment is outside the message or the map can't be allocated.
+ */
+bool imtQueueMtSegment(imt_queue_t * queue, imt_t * message, const size_t start, const size_t length);
+
+/**
+ * @brief Swap a message's payload block for another, eg. once an MT has been decompressed.
+ *
+ * The old block and segment map are wiped and freed as if the message had been removed.
+ * 
+ * @param queue Pointer to the queue holding the message.
+ * @param message Pointer to the message.
+ * @param buffer New block, taken from queue->allocator.
+ * @param capacity Size buffer was allocated with.
+ * @param used Bytes of buffer written.
+ */
+void imtQueueSetBuffer(imt_queue_t * queue, imt_t * message, uint8_t * buffer, const size_t capacity, const size_t used);
+
+/**
+ * @brief Remove a message from anywhere in the queue, the ones behind it move up.
+ * 
+ * @param queue Pointer to the selected queue.
+ * @param index Position of the message, 0 is the head.
+ * @return Bool indicating success or failure to remove the message from the queue.
+ */
+bool imtQueueRemoveAt(imt_queue_t * queue, const uint16_t index);
+
+/**
+ * @brief Get the address of the head of the queue.
+ * 
+ * @param queue Pointer to the selected queue.
  * @return Pointer to the next message in the queue, NULL if queue is empty.
  */
-imt_t * imtQueueMtGetFirst(void);
+imt_t * imtQueueGetFirst(imt_queue_t * queue);
 
 /**
- * @brief Get the address of the latest message in the MT queue.
+ * @brief Get the address of the latest message in the queue.
  * 
+ * @param queue Pointer to the selected queue.
  * @return Pointer to the last message in the queue, NULL if queue is empty.
  */
-imt_t * imtQueueMtGetLast(void);
+imt_t * imtQueueGetLast(imt_queue_t * queue);
 
 /**
- * @brief Lock or unlock the MT queue to prevent messages from getting discarded if full.
+ * @brief Get the address of a message by its position in the queue.
  * 
+ * @param queue Pointer to the selected queue.
+ * @param index Position of the message, 0 is the head.
+ * @return Pointer to the message, NULL if there are not that many in the queue.
+ */
+imt_t * imtQueueGetAt(imt_queue_t * queue, const uint16_t index);
+
+/**
+ * @brief Lock or unlock a queue to prevent messages from getting discarded if full.
+ * 
+ * @param queue Pointer to the selected queue.
  * @param lock Called with true to lock the queue and false to unlock the queue.
  * 
- * @note This is set to false by default.
+ * @note The lock is kept across imtQueueInit().
  */
-void imtQueueMtLock(bool lock);
+void imtQueueLock(imt_queue_t * queue, bool lock);
 
 /**
- * @brief Lock or unlock the MO queue to prevent messages from getting discarded if full.
+ * @brief Choose how payload blocks are cleared when a message is removed.
  * 
- * @param lock Called with true to lock the queue and false to unlock the queue.
+ * @param queue Pointer to the selected queue.
+ * @param wipe true to zero the whole block through a volatile pointer, so the
+ * compiler can't elide it, false to only clear the bytes that were written.
+ * 
+ * @note The setting is kept across imtQueueInit() and imtQueueCreate().
+ */
+void imtQueueSecureWipe(imt_queue_t * queue, bool wipe);
+
+/**
+ * @brief Used to initialise (clean) a queue, every message is dropped but the depth is kept.
  * 
- * @note This is set to false by default.
+ * @param queue Pointer to the selected queue.
+ */
+void imtQueueInit(imt_queue_t * queue);
+
+/**
+ * @brief Build a queue of the given depth, any previous contents are dropped first.
+ * 
+ * @param queue Pointer to the selected queue.
+ * @param depth Number of messages the queue can hold.
+ * @param allocator Memory hooks for the message array and payload blocks, copied.
+ * @return Bool indicating success, on failure the queue is left empty with a depth of 0.
+ * 
+ * @note Payload blocks are sized to each message when it is added, so memory use
+ * follows the messages actually queued rather than depth * IMT_PAYLOAD_SIZE.
  */
-void imtQueueMoLock(bool lock);
+bool imtQueueCreate(imt_queue_t * queue, const uint16_t depth, const imt_allocator_t * allocator);
 
 /**
- * @brief Used to initialise both outgoing and incoming queues.
+ * @brief Drop every message and free the message array, the queue has a depth of 0 afterwards.
  * 
+ * @param queue Pointer to the selected queue.
  */
-void imtQueueInit (void);
+void imtQueueDestroy(imt_queue_t * queue);
 
 /**
  * @brief Inline function used to get the current size of the selected queue.
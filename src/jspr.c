@@ -12,14 +12,122 @@
 #include <unistd.h>
 #endif
 
-//Messaging Variables
-int messageReference = 1;
-static uint8_t jsprRxBuffer [RX_BUFFER_SIZE];
-extern serialContext context;
+#if defined(_MSC_VER)
+#define JSPR_THREAD_LOCAL __declspec(thread)
+#elif defined(ARDUINO)
+#define JSPR_THREAD_LOCAL
+#else
+#define JSPR_THREAD_LOCAL __thread
+#endif
+
+static char jsprEmpty[1] = "";
+
+// Context whose arena cJSON is allocating from, only set between parseJsprJson() and deleteJsprJson()
+static JSPR_THREAD_LOCAL jsprContext_t * jsonArenaOwner = NULL;
+// Where allocations outside a parse, and those that overflow the arena, go
+static void * (*jsonFallbackAlloc)(size_t size) = malloc;
+static void (*jsonFallbackFree)(void * block) = free;
+static bool jsonHooksInstalled = false;
+
+static void * jsonArenaAlloc(size_t size)
+{
+    void * block = NULL;
+    jsprContext_t * jspr = jsonArenaOwner;
+    const size_t rounded = (size + sizeof(uint64_t) - 1U) & ~(sizeof(uint64_t) - 1U);
+
+    if (jspr != NULL && rounded <= sizeof(jspr->jsonArena) - jspr->jsonArenaUsed)
+    {
+        block = (uint8_t *)jspr->jsonArena + jspr->jsonArenaUsed;
+        jspr->jsonArenaUsed += rounded;
+        if (jspr->jsonArenaUsed > jspr->jsonArenaHighWater)
+        {
+            jspr->jsonArenaHighWater = jspr->jsonArenaUsed;
+        }
+    }
+    else
+    {
+        if (jspr != NULL)
+        {
+            jspr->jsonArenaOverflows++;
+        }
+        block = jsonFallbackAlloc(size);
+    }
+    return block;
+}
+
+static void jsonArenaFree(void * block)
+{
+    jsprContext_t * jspr = jsonArenaOwner;
+    const uint8_t * arena = (jspr != NULL) ? (const uint8_t *)jspr->jsonArena : NULL;
+
+    // Arena blocks go back all at once when the parse is done
+    if (arena == NULL || (const uint8_t *)block < arena || (const uint8_t *)block >= arena + sizeof(jspr->jsonArena))
+    {
+        jsonFallbackFree(block);
+    }
+}
 
-int sendJspr(const char *buffer, size_t length)
+static void installJsonHooks(void)
 {
-        int bytesWritten = context.serialWrite(buffer, length);
+    cJSON_Hooks hooks = { jsonArenaAlloc, jsonArenaFree };
+    cJSON_InitHooks(&hooks);
+    jsonHooksInstalled = true;
+}
+
+static cJSON * parseJsprJson(jsprContext_t * jspr, const char * jsprString)
+{
+    cJSON * json = NULL;
+
+    // Without a context the tree is built on the heap
+    if (jspr != NULL)
+    {
+        jspr->jsonArenaUsed = 0;
+        jsonArenaOwner = jspr;
+    }
+    json = cJSON_Parse(jsprString);
+    if (json == NULL)
+    {
+        jsonArenaOwner = NULL;
+    }
+    return json;
+}
+
+static void deleteJsprJson(jsprContext_t * jspr, cJSON * json)
+{
+    cJSON_Delete(json);
+    if (jspr != NULL)
+    {
+        jspr->jsonArenaUsed = 0;
+    }
+    jsonArenaOwner = NULL;
+}
+
+void jsprSetJsonHooks(void * (*allocate)(size_t size), void (*release)(void * block))
+{
+    jsonFallbackAlloc = (allocate != NULL && release != NULL) ? allocate : malloc;
+    jsonFallbackFree = (allocate != NULL && release != NULL) ? release : free;
+    installJsonHooks();
+}
+
+void jsprInit(jsprContext_t * jspr, serialContext * serial)
+{
+    jspr->serial = serial;
+    jspr->rxStart = 0;
+    jspr->rxEnd = 0;
+    jspr->rxScanned = 0;
+    jspr->messageReference = 1;
+    jspr->jsonArenaUsed = 0;
+    jspr->jsonArenaHighWater = 0;
+    jspr->jsonArenaOverflows = 0;
+    if (!jsonHooksInstalled)
+    {
+        installJsonHooks(); // Once per process, hooks the application set come through jsprSetJsonHooks()
+    }
+}
+
+int sendJspr(jsprContext_t * jspr, const char *buffer, size_t length)
+{
+        int bytesWritten = jspr->serial->serialWrite(jspr->serial, buffer, length);
         if(0 > bytesWritten)
         {
             return -1;
@@ -32,140 +140,408 @@ int sendJspr(const char *buffer, size_t length)
         return bytesWritten;
 }
 
-bool receiveJspr(jsprResponse_t * response, const char * expectedTarget)
+int sendJsprSpans(jsprContext_t * jspr, const serialSpan_t * spans, const size_t count)
 {
-    bool received = false;
-    int loop;
-    char resultCode[JSPR_RESULT_CODE_LENGTH + 1]; // Plus 1 for the NULL
-    uint16_t pos = 0;
-    int bytesRead;
-    bool validResponse = false;
-    bool reading = true;
-    bool gotResponse = false;
+        int bytesWritten = 0;
+        if (jspr->serial->serialWritev != NULL)
+        {
+            bytesWritten = jspr->serial->serialWritev(jspr->serial, spans, count);
+        }
+        else
+        {
+            for (size_t i = 0; i < count && bytesWritten >= 0; i++) // Backend without writev, one write per span
+            {
+                int rc = jspr->serial->serialWrite(jspr->serial, spans[i].data, (uint16_t)spans[i].length);
+                bytesWritten = (rc < 0) ? -1 : bytesWritten + rc;
+            }
+        }
+        if(0 > bytesWritten)
+        {
+            return -1;
+        }
+#ifdef DEBUG
+        printf("SENT: "); // The terminator goes out with the last span
+        for (size_t i = 0; i < count; i++)
+        {
+            printf("%.*s", (int)spans[i].length, spans[i].data);
+        }
+        printf("\r\n");
+#endif
+        return bytesWritten;
+}
+
+// Indexed by jsprTarget_t
+static const char * const jsprTargetNames[JSPR_TARGET_COUNT] =
+{
+    "",
+    "apiVersion",
+    "simConfig",
+    "simStatus",
+    "operationalState",
+    "serviceConfig",
+    "hwInfo",
+    "firmware",
+    "bootInfo",
+    "constellationState",
+    "messageProvisioning",
+    "messageOriginate",
+    "messageOriginateSegment",
+    "messageOriginateStatus",
+    "messageTerminate",
+    "messageTerminateSegment",
+    "messageTerminateStatus"
+};
+
+jsprTarget_t jsprLookupTarget(const char * target, size_t length)
+{
+    jsprTarget_t id = JSPR_TARGET_UNKNOWN;
+
+    // The length and at most two characters single out the only possible
+    // match, one compare then confirms it
+    switch (length)
+    {
+        case 6:
+            id = JSPR_TARGET_HW_INFO;
+            break;
+        case 8:
+            id = (target[0] == 'f') ? JSPR_TARGET_FIRMWARE : JSPR_TARGET_BOOT_INFO;
+            break;
+        case 9:
+            id = (target[3] == 'C') ? JSPR_TARGET_SIM_CONFIG : JSPR_TARGET_SIM_STATUS;
+            break;
+        case 10:
+            id = JSPR_TARGET_API_VERSION;
+            break;
+        case 13:
+            id = JSPR_TARGET_SERVICE_CONFIG;
+            break;
+        case 16:
+            if (target[0] == 'o')
+            {
+                id = JSPR_TARGET_OPERATIONAL_STATE;
+            }
+            else
+            {
+                id = (target[7] == 'O') ? JSPR_TARGET_MESSAGE_ORIGINATE : JSPR_TARGET_MESSAGE_TERMINATE;
+            }
+            break;
+        case 18:
+            id = JSPR_TARGET_CONSTELLATION_STATE;
+            break;
+        case 19:
+            id = JSPR_TARGET_MESSAGE_PROVISIONING;
+            break;
+        case 22:
+            id = (target[7] == 'O') ? JSPR_TARGET_MESSAGE_ORIGINATE_STATUS : JSPR_TARGET_MESSAGE_TERMINATE_STATUS;
+            break;
+        case 23:
+            id = (target[7] == 'O') ? JSPR_TARGET_MESSAGE_ORIGINATE_SEGMENT : JSPR_TARGET_MESSAGE_TERMINATE_SEGMENT;
+            break;
+        default:
+            break;
+    }
+    if (id != JSPR_TARGET_UNKNOWN && memcmp(target, jsprTargetNames[id], length) != 0)
+    {
+        id = JSPR_TARGET_UNKNOWN;
+    }
+    return id;
+}
+
+static bool isResultCode(const char * start)
+{
+    uint32_t code = 0;
+    for (uint8_t i = 0; i < JSPR_RESULT_CODE_LENGTH; i++)
+    {
+        if (start[i] < '0' || start[i] > '9')
+        {
+            return false;
+        }
+        code = (code * 10U) + (uint32_t)(start[i] - '0');
+    }
+    return (code >= JSPR_RC_NO_ERROR) && (code <= JSPR_RC_SERIAL_PORT_ERROR);
+}
+
+static bool frameJsprLine(char * line, size_t length, jsprResponse_t * response)
+{
+    bool framed = false;
+    size_t codeStart = 0;
     char * targetStart = NULL;
     char * targetEnd = NULL;
-    uint16_t targetLength = 0;
-    size_t resultCodeIndexStart = 0;
     char * jsonStart = NULL;
 
-    clearResponse(response); //make sure we're dealing with an empty structure
-    if((context.serialRead != NULL) && (response != NULL))
+#ifdef DEBUG
+    printf("RECEIVED: %s\r\n", line);
+#endif
+    // Strip unwanted characters at the start, this can happen with bootInfo message
+    // this seems to be DC1 character at the start
+    while ((codeStart + JSPR_MIN_RESPONSE) <= length && !isResultCode(&line[codeStart]))
+    {
+        codeStart++;
+    }
+
+    if ((codeStart + JSPR_MIN_RESPONSE) <= length)
+    {
+        line += codeStart;
+        length -= codeStart;
+        response->code = ((uint32_t)(line[0] - '0') * 100U) + ((uint32_t)(line[1] - '0') * 10U) + (uint32_t)(line[2] - '0');
+
+        targetStart = &line[JSPR_RESULT_CODE_LENGTH + 1];
+        targetEnd = memchr(targetStart, ' ', length - (JSPR_RESULT_CODE_LENGTH + 1));
+        if (targetEnd == NULL)
+        {
+            targetEnd = &line[length];
+        }
+        if ((size_t)(targetEnd - targetStart) < JSPR_MAX_TARGET_LENGTH)
+        {
+            jsonStart = memchr(targetEnd, '{', (size_t)(&line[length] - targetEnd));
+            *targetEnd = '\0'; // Terminate the target in place, the JSON starts after this separator
+            response->target = targetStart;
+            response->targetId = jsprLookupTarget(targetStart, (size_t)(targetEnd - targetStart));
+            if (jsonStart != NULL)
+            {
+                response->json = jsonStart;
+                response->jsonSize = (uint16_t)(&line[length] - jsonStart);
+            }
+            framed = true;
+        }
+    }
+    return framed;
+}
+
+static bool nextJsprLine(jsprContext_t * jspr, jsprResponse_t * response)
+{
+    bool framed = false;
+    char * terminator;
+
+    while (!framed && jspr->rxScanned < jspr->rxEnd)
+    {
+        terminator = memchr(&jspr->rxBuffer[jspr->rxScanned], '\r', jspr->rxEnd - jspr->rxScanned);
+        if (terminator == NULL)
+        {
+            jspr->rxScanned = jspr->rxEnd;
+        }
+        else
+        {
+            char * line = &jspr->rxBuffer[jspr->rxStart];
+            size_t length = (size_t)(terminator - line);
+            *terminator = '\0'; // Replace with NULL
+            jspr->rxStart = (size_t)(terminator - jspr->rxBuffer) + 1U;
+            jspr->rxScanned = jspr->rxStart;
+
+            clearResponse(response);
+            framed = frameJsprLine(line, length, response);
+        }
+    }
+    return framed;
+}
+
+static int fillJsprWindow(jsprContext_t * jspr, const bool wait)
+{
+    int available = 0;
+    int bytesRead = 0;
+    size_t space;
+
+    if (jspr->rxStart > 0)
+    {
+        // Keep the partial line, drop everything that has already been framed
+        memmove(jspr->rxBuffer, &jspr->rxBuffer[jspr->rxStart], jspr->rxEnd - jspr->rxStart);
+        jspr->rxEnd -= jspr->rxStart;
+        jspr->rxScanned -= jspr->rxStart;
+        jspr->rxStart = 0;
+    }
+
+    if (jspr->rxEnd >= (RX_BUFFER_SIZE - 1))
+    {
+        // A line longer than the window can never be framed, drop it and resync
+        jspr->rxEnd = 0;
+        jspr->rxScanned = 0;
+    }
+    space = (RX_BUFFER_SIZE - 1) - jspr->rxEnd;
+
+    if (jspr->serial->serialPeek != NULL)
     {
-        memset(jsprRxBuffer, 0 , RX_BUFFER_SIZE);
-        do
+        available = jspr->serial->serialPeek(jspr->serial);
+    }
+    if (available <= 0)
+    {
+        if (!wait)
         {
-            while(pos < (RX_BUFFER_SIZE - 1))
+            return 0;
+        }
+        available = 1; // Let the serial read block until something arrives or it times out
+    }
+    if ((size_t)available > space)
+    {
+        available = (int)space;
+    }
+    if (available > UINT16_MAX)
+    {
+        available = UINT16_MAX;
+    }
+
+    bytesRead = jspr->serial->serialRead(jspr->serial, &jspr->rxBuffer[jspr->rxEnd], (uint16_t)available);
+    if (bytesRead > 0)
+    {
+        jspr->rxEnd += (size_t)bytesRead;
+    }
+    return bytesRead;
+}
+
+bool receiveJspr(jsprContext_t * jspr, jsprResponse_t * response, const char * expectedTarget)
+{
+    bool received = false;
+    unsigned long lastProgress = millis();
+
+    if((jspr->serial->serialRead != NULL) && (response != NULL))
+    {
+        clearResponse(response); //make sure we're dealing with an empty structure
+        while (!received)
+        {
+            if (nextJsprLine(jspr, response))
             {
-                bytesRead = context.serialRead(&jsprRxBuffer[pos], 1);
-                if (bytesRead <= 0)
+                if ((expectedTarget == NULL) ||
+                    (strncmp(response->target, expectedTarget, JSPR_MAX_TARGET_LENGTH) == 0))
                 {
-                    reading = false; //make function non-blocking
-                    break;
+                    received = true;
                 }
-                if (jsprRxBuffer[pos] == '\r' && pos > 2)
+                else
                 {
-                    jsprRxBuffer[pos] = '\0'; // Replace with NULL
-                    validResponse = true;
-                    break;
+                    clearResponse(response);
                 }
-                pos++;
             }
-
-            if(validResponse == true)
+            else if (fillJsprWindow(jspr, true) > 0)
             {
-#ifdef DEBUG
-            printf("RECEIVED: %s\r\n", jsprRxBuffer);
-#endif
-                if (pos >= JSPR_MIN_RESPONSE)
+                lastProgress = millis();
+            }
+            else
+            {
+                //the read timeout may be far shorter than a reply takes, give up after JSPR_RESPONSE_IDLE_MS of silence
+                const unsigned long idle = millis() - lastProgress;
+                if (idle >= JSPR_RESPONSE_IDLE_MS || jspr->serial->serialReadTimeoutUs >= JSPR_RESPONSE_IDLE_MS * 1000UL)
                 {
-                    // Strip unwanted characters at the start, this can happen with bootInfo message
-                    // this seems to be DC1 character at the start
-                    while ((response->code < JSPR_RC_NO_ERROR) || (response->code > JSPR_RC_SERIAL_PORT_ERROR))
+                    break; //make function non-blocking, a partial line is kept for the next call
+                }
+                if (jspr->serial->serialWait != NULL)
+                {
+                    if (jspr->serial->serialWait(jspr->serial, JSPR_RESPONSE_IDLE_MS - idle) < 0)
                     {
-                        if ((RX_BUFFER_SIZE - resultCodeIndexStart) <  JSPR_RESULT_CODE_LENGTH)
-                        {
-                            break;
-                        }
-
-                        for(uint8_t i = 0; i < JSPR_RESULT_CODE_LENGTH; i++)
-                        {
-                            resultCode[i] = jsprRxBuffer[i + resultCodeIndexStart];
-                        }
+                        break;
+                    }
+                }
+                else if (jspr->serial->serialReadTimeoutUs < 1000U)
+                {
+                    delay(1); // No way to sleep on the port, don't spin on a zero timeout
+                }
+            }
+        }
+    }
+    return received;
+}
 
-                        resultCode[JSPR_RESULT_CODE_LENGTH] = '\0';
-                        response->code = (uint16_t)atoi(resultCode);
+bool pollJspr(jsprContext_t * jspr, jsprResponse_t * response)
+{
+    bool received = false;
 
-                        if ((response->code < JSPR_RC_NO_ERROR) || (response->code > JSPR_RC_SERIAL_PORT_ERROR))
-                        {
-                            resultCodeIndexStart++;
-                        }
-                    };
+    if((jspr->serial->serialRead != NULL) && (response != NULL))
+    {
+        clearResponse(response);
+        received = nextJsprLine(jspr, response);
+        if (!received && fillJsprWindow(jspr, false) > 0)
+        {
+            received = nextJsprLine(jspr, response);
+        }
+    }
+    return received;
+}
 
-                    if (resultCodeIndexStart > 0)
-                    {
-                        memmove(jsprRxBuffer, &jsprRxBuffer[resultCodeIndexStart], (pos - resultCodeIndexStart));
-                    }
+void resetJspr(jsprContext_t * jspr)
+{
+    jspr->rxStart = 0;
+    jspr->rxEnd = 0;
+    jspr->rxScanned = 0;
+}
 
-                    targetStart = &jsprRxBuffer[JSPR_RESULT_CODE_LENGTH + 1];
-                    targetEnd = strchr(targetStart, ' ');
-                    targetLength = targetEnd - targetStart;
-                    if(targetLength < JSPR_MAX_TARGET_LENGTH)
-                    {
-                        memcpy(response->target, targetStart, targetLength);
-                        response->target[targetLength] = '\0';
-                    }
+static bool jsprLineBuffered(jsprContext_t * jspr)
+{
+    bool buffered = false;
+    if (jspr->rxScanned < jspr->rxEnd)
+    {
+        char * terminator = memchr(&jspr->rxBuffer[jspr->rxScanned], '\r', jspr->rxEnd - jspr->rxScanned);
+        if (terminator != NULL)
+        {
+            jspr->rxScanned = (size_t)(terminator - jspr->rxBuffer); // nextJsprLine picks up from here
+            buffered = true;
+        }
+        else
+        {
+            jspr->rxScanned = jspr->rxEnd;
+        }
+    }
+    return buffered;
+}
 
-                    if (expectedTarget != NULL)
-                    {
-                        if (strncmp(response->target, expectedTarget, JSPR_MAX_TARGET_LENGTH) !=0)
-                        {
-                            pos = 0;
-                            memset(jsprRxBuffer, 0 , RX_BUFFER_SIZE);
-                            memset(response, 0, sizeof(response));
-                            continue;
-                        }
-                    }
+bool waitJspr(jsprContext_t * jspr, const uint32_t timeoutMs)
+{
+    bool ready = false;
+    unsigned long startTime = millis();
+    unsigned long elapsed = 0;
 
-                    jsonStart = strchr(targetStart, '{');
-                    response->jsonSize = strchr(targetStart, '\0') - jsonStart;
-                    if(response->jsonSize < JSPR_MAX_JSON_LENGTH)
-                    {
-                        strncpy(response->json, jsonStart, response->jsonSize);
-                        response->json[response->jsonSize] = '\0';
-                    }
-                    reading = false;
-                    gotResponse = true;
-                    received = true;
+    while (!ready && jspr->serial->serialRead != NULL)
+    {
+        if (jsprLineBuffered(jspr))
+        {
+            ready = true;
+        }
+        else if (fillJsprWindow(jspr, false) <= 0)
+        {
+            elapsed = millis() - startTime;
+            if (elapsed >= timeoutMs)
+            {
+                break;
+            }
+            if (jspr->serial->serialWait != NULL)
+            {
+                if (jspr->serial->serialWait(jspr->serial, timeoutMs - elapsed) <= 0)
+                {
+                    break; // Timed out, woken up or failed
                 }
             }
-        }while(reading == true);
+            else
+            {
+                delay(1); // No way to sleep on the port, fall back to a short poll
+            }
+        }
     }
-    return received;
+    return ready;
 }
 
-bool waitForJsprMessage(jsprResponse_t * response, const char * expectedTarget, const uint32_t expectedCode, const uint32_t timeoutSeconds)
+bool waitForJsprMessage(jsprContext_t * jspr, jsprResponse_t * response, const char * expectedTarget, const uint32_t expectedCode, const uint32_t timeoutSeconds)
 {
     bool gotMessage = false;
     unsigned long startTime = millis();
+    unsigned long elapsed = 0;
 
     while (1)
     {
-        receiveJspr(response, expectedTarget);
-
-        if (response->code == expectedCode &&
-            strncmp(response->target, expectedTarget, JSPR_MAX_TARGET_LENGTH) == 0)
+        if (pollJspr(jspr, response))
         {
-            gotMessage = true;
-            break;
+            if (response->code == expectedCode &&
+                strncmp(response->target, expectedTarget, JSPR_MAX_TARGET_LENGTH) == 0)
+            {
+                gotMessage = true;
+                break;
+            }
+            continue;
         }
 
-        if ((millis() - startTime) > timeoutSeconds * 1000)
+        elapsed = millis() - startTime;
+        if (elapsed > timeoutSeconds * 1000)
         {
             gotMessage = false;
             break;
         }
 
-        delay(10);
+        waitJspr(jspr, (timeoutSeconds * 1000) - elapsed);
     }
 
     return gotMessage;
@@ -175,11 +551,12 @@ void clearResponse(jsprResponse_t * response)
 {
     response->code = 0;
     response->jsonSize = 0;
-    memset(response->json, 0, JSPR_MAX_JSON_LENGTH);
-    memset(response->target, 0, JSPR_MAX_TARGET_LENGTH);
+    response->json = jsprEmpty;
+    response->target = jsprEmpty;
+    response->targetId = JSPR_TARGET_UNKNOWN;
 }
 
-bool parseJsprBootInfo(const char * jsprString, jsprBootInfo_t * bootInfo)
+bool parseJsprBootInfo(jsprContext_t * jspr, const char * jsprString, jsprBootInfo_t * bootInfo)
 {
     bool parsed = false;
     cJSON * json = NULL;
@@ -194,7 +571,7 @@ bool parseJsprBootInfo(const char * jsprString, jsprBootInfo_t * bootInfo)
 
     if ((jsprString != NULL) && (bootInfo != NULL))
     {
-        json = cJSON_Parse(jsprString);
+        json = parseJsprJson(jspr, jsprString);
 
         if (json != NULL)
         {
@@ -255,20 +632,20 @@ bool parseJsprBootInfo(const char * jsprString, jsprBootInfo_t * bootInfo)
                 cPtr = NULL;
             }
         }
-        cJSON_Delete(json);
+        deleteJsprJson(jspr, json);
         parsed = true;
     }
 
     return parsed;
 }
 
-bool parseJsprGetApiVersion(char * jsprString, jsprApiVersion_t * apiVersion)
+bool parseJsprGetApiVersion(jsprContext_t * jspr, char * jsprString, jsprApiVersion_t * apiVersion)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (apiVersion != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * supportedVersions = cJSON_GetObjectItem(root, "supported_versions");
@@ -314,14 +691,14 @@ bool parseJsprGetApiVersion(char * jsprString, jsprApiVersion_t * apiVersion)
                 apiVersion->activeVersionSet = false;
             }
             parsed = true;
-            cJSON_Delete(root);
+            deleteJsprJson(jspr, root);
         }
     }
 
     return parsed;
 }
 
-bool parseJsprFirmwareInfo(const char * jsprString, jsprFirmwareInfo_t * firmwareInfo)
+bool parseJsprFirmwareInfo(jsprContext_t * jspr, const char * jsprString, jsprFirmwareInfo_t * firmwareInfo)
 {
     bool parsed = false;
     cJSON * json = NULL;
@@ -337,7 +714,7 @@ bool parseJsprFirmwareInfo(const char * jsprString, jsprFirmwareInfo_t * firmwar
 
     if ((jsprString != NULL) && (firmwareInfo != NULL))
     {
-        cJSON *json = cJSON_Parse(jsprString);
+        cJSON *json = parseJsprJson(jspr, jsprString);
         if (json != NULL)
         {
             slot = cJSON_GetObjectItem(json, "slot");
@@ -404,20 +781,20 @@ bool parseJsprFirmwareInfo(const char * jsprString, jsprFirmwareInfo_t * firmwar
             }
 
             parsed = true;
-            cJSON_Delete(json);
+            deleteJsprJson(jspr, json);
         }
     }
 
     return parsed;
 }
 
-bool parseJsprGetSimInterface(char * jsprString, jsprSimInterface_t * simInterface)
+bool parseJsprGetSimInterface(jsprContext_t * jspr, char * jsprString, jsprSimInterface_t * simInterface)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (simInterface != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * iface = cJSON_GetObjectItem(root, "interface");
@@ -449,20 +826,20 @@ bool parseJsprGetSimInterface(char * jsprString, jsprSimInterface_t * simInterfa
                 simInterface->ifaceSet = false;
             }
         parsed = true;
-        cJSON_Delete(root);
+        deleteJsprJson(jspr, root);
         }
     }
 
     return parsed;
 }
 
-bool parseJsprGetOperationalState(char * jsprString, jsprOperationalState_t * operationalState)
+bool parseJsprGetOperationalState(jsprContext_t * jspr, char * jsprString, jsprOperationalState_t * operationalState)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (operationalState != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * reason = cJSON_GetObjectItem(root, "reason");
@@ -517,69 +894,314 @@ bool parseJsprGetOperationalState(char * jsprString, jsprOperationalState_t * op
                 operationalState->operationalStateSet = false;
             }
         parsed = true;
-        cJSON_Delete(root);
+        deleteJsprJson(jspr, root);
         }
     }
 
     return parsed;
 }
 
+/*
+ * Allocation free scanner for the flat objects the modem sends on the message
+ * path. Members are visited once, in order, straight out of the receive window,
+ * cJSON is only used for the rarer query responses.
+ */
+typedef enum
+{
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+    JSON_NESTED
+} jsonType_t;
+
+typedef struct
+{
+    const char * key;
+    size_t keyLength;
+    const char * value;     /**< Strings start after the opening quote */
+    size_t valueLength;     /**< Strings exclude both quotes */
+    jsonType_t type;
+} jsonMember_t;
+
+typedef struct
+{
+    const char * name;
+    int value;
+} jsonEnum_t;
+
+static const jsonEnum_t messageResponses[] =
+{
+    { "message_accepted", MESSAGE_ACCEPTED },
+    { "subscription_invalid", SUBSCRIPTION_INVALID },
+    { "message_discarded_on_overflow", MESSAGE_DISCARDED_ON_OVERFLOW }
+};
+
+static const jsonEnum_t finalMoStatuses[] =
+{
+    { "mo_ack_received", MO_ACK_RECEIVED_MOS },
+    { "message_discarded_on_overflow", MESSAGE_DISCARDED_ON_OVERFLOW_MOS },
+    { "message_expired", MESSAGE_EXPIRED_MOS },
+    { "message_transfer_timeout", MESSAGE_TRANSFER_TIMEOUT_MOS },
+    { "segment_not_supplied", SEGMENT_NOT_SUPPLIED_MOS },
+    { "segment_incorrect", SEGMENT_INCORRECT_MOS },
+    { "network_error", NETWORK_ERROR_MOS },
+    { "message_cancelled_pre_transit", MESSAGE_CANCELLED_PRE_TRANSIT_MOS },
+    { "message_cancelled_in_transit", MESSAGE_CANCELLED_IN_TRANSIT_MOS },
+    { "subscription_invalid", SUBSCRIPTION_INVALID_MOS },
+    { "protocol_error", PROTOCOL_ERROR_MOS },
+    { "message_dropped_local_crc_error", MESSAGE_DROPPED_LOCAL_CRC_ERROR_MOS },
+    { "crc_error_in_transfer", CRC_ERROR_IN_TRANSFER_MOS },
+    { "user_supplied_crc_error", USER_SUPPLIED_CRC_ERROR_MOS }
+};
+
+static const jsonEnum_t finalMtStatuses[] =
+{
+    { "complete", COMPLETE },
+    { "message_timed_out", MESSAGE_TIMED_OUT },
+    { "message_cancelled", MESSAGE_CANCELLED },
+    { "crc_error_in_transfer", CRC_ERROR_IN_TRANSFER }
+};
+
+static const char * skipJsonSpace(const char * cursor)
+{
+    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+    {
+        cursor++;
+    }
+    return cursor;
+}
+
+// Return the closing quote of a string whose body starts at cursor, NULL if unterminated
+static const char * endJsonString(const char * cursor)
+{
+    while (*cursor != '"' && *cursor != '\0')
+    {
+        if (*cursor == '\\' && cursor[1] != '\0')
+        {
+            cursor++;
+        }
+        cursor++;
+    }
+    return (*cursor == '"') ? cursor : NULL;
+}
+
+// Skip an object or array, only the nesting is checked, NULL if unterminated
+static const char * endJsonNested(const char * cursor)
+{
+    unsigned int depth = 0;
+
+    do
+    {
+        if (*cursor == '{' || *cursor == '[')
+        {
+            depth++;
+        }
+        else if (*cursor == '}' || *cursor == ']')
+        {
+            depth--;
+        }
+        else if (*cursor == '"')
+        {
+            cursor = endJsonString(cursor + 1);
+        }
+        else if (*cursor == '\0')
+        {
+            cursor = NULL;
+        }
+        if (cursor != NULL)
+        {
+            cursor++;
+        }
+    } while (cursor != NULL && depth > 0);
+    return cursor;
+}
+
+static bool readJsonValue(const char * cursor, jsonMember_t * member, const char ** end)
+{
+    bool read = false;
+    const char * close = NULL;
+
+    member->value = cursor;
+    if (*cursor == '"')
+    {
+        close = endJsonString(cursor + 1);
+        if (close != NULL)
+        {
+            member->type = JSON_STRING;
+            member->value = cursor + 1;
+            member->valueLength = (size_t)(close - member->value);
+            *end = close + 1;
+            read = true;
+        }
+    }
+    else if (*cursor == '{' || *cursor == '[')
+    {
+        close = endJsonNested(cursor);
+        if (close != NULL)
+        {
+            member->type = JSON_NESTED;
+            member->valueLength = (size_t)(close - cursor);
+            *end = close;
+            read = true;
+        }
+    }
+    else
+    {
+        close = cursor;
+        while (*close != '\0' && strchr(",}] \t\r\n", *close) == NULL)
+        {
+            close++;
+        }
+        member->valueLength = (size_t)(close - cursor);
+        if (member->valueLength == 4 && strncmp(cursor, "true", 4) == 0)
+        {
+            member->type = JSON_TRUE;
+            read = true;
+        }
+        else if (member->valueLength == 5 && strncmp(cursor, "false", 5) == 0)
+        {
+            member->type = JSON_FALSE;
+            read = true;
+        }
+        else if (member->valueLength == 4 && strncmp(cursor, "null", 4) == 0)
+        {
+            member->type = JSON_NULL;
+            read = true;
+        }
+        else if (member->valueLength > 0 && (*cursor == '-' || (*cursor >= '0' && *cursor <= '9')))
+        {
+            member->type = JSON_NUMBER;
+            read = true;
+        }
+        *end = close;
+    }
+    return read;
+}
+
+/**
+ * Step to the next member of a flat object.
+ * Start with *cursor at the opening brace, returns 1 with member filled in,
+ * 0 at the closing brace, -1 if the text is not a well formed object.
+ */
+static int nextJsonMember(const char ** cursor, jsonMember_t * member)
+{
+    int result = -1;
+    const char * at = skipJsonSpace(*cursor);
+    const char * close = NULL;
+
+    if (*at == '{' || *at == ',')
+    {
+        const bool opening = (*at == '{');
+        at = skipJsonSpace(at + 1);
+        if (opening && *at == '}')
+        {
+            result = 0;
+        }
+        else if (*at == '"' && (close = endJsonString(at + 1)) != NULL)
+        {
+            member->key = at + 1;
+            member->keyLength = (size_t)(close - member->key);
+            at = skipJsonSpace(close + 1);
+            if (*at == ':' && readJsonValue(skipJsonSpace(at + 1), member, &at))
+            {
+                result = 1;
+            }
+        }
+    }
+    else if (*at == '}')
+    {
+        result = 0;
+    }
+    *cursor = at;
+    return result;
+}
+
+static bool isJsonKey(const jsonMember_t * member, const char * key)
+{
+    return strlen(key) == member->keyLength && strncmp(member->key, key, member->keyLength) == 0;
+}
+
+static bool readJsonInteger(const jsonMember_t * member, long minimum, long maximum, long * result)
+{
+    bool read = false;
+    char * end = NULL;
+
+    if (member->type == JSON_NUMBER)
+    {
+        long number = strtol(member->value, &end, 10);
+        if (end != member->value && number >= minimum && number <= maximum)
+        {
+            *result = number;
+            read = true;
+        }
+    }
+    return read;
+}
+
+static bool readJsonEnum(const jsonMember_t * member, const jsonEnum_t * table, size_t count, int * result)
+{
+    bool read = false;
+
+    if (member->type == JSON_STRING)
+    {
+        for (size_t i = 0; i < count && !read; i++)
+        {
+            if (strlen(table[i].name) == member->valueLength && strncmp(member->value, table[i].name, member->valueLength) == 0)
+            {
+                *result = table[i].value;
+                read = true;
+            }
+        }
+    }
+    return read;
+}
+
 bool parseJsprPutMessageOriginate(char * jsprString, jsprMessageOriginate_t  * messageOriginate)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (messageOriginate != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageOriginate_t fields = *messageOriginate;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        long messageId = -1;
+        int value;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageOriginate->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * requestReference = cJSON_GetObjectItem(root, "request_reference");
-            if(cJSON_IsNumber(requestReference))
+            else if (isJsonKey(&member, "request_reference") && readJsonInteger(&member, 1, 100, &number))
             {
-                if(requestReference->valueint >= 1 && requestReference->valueint <= 100)
-                {
-                    messageOriginate->requestReference = requestReference->valueint;
-                }
+                fields.requestReference = (uint8_t)number;
             }
-            cJSON * messageResponce = cJSON_GetObjectItem(root, "message_response");
-            if(cJSON_IsString(messageResponce))
+            else if (isJsonKey(&member, "message_response") && readJsonEnum(&member, messageResponses, sizeof(messageResponses) / sizeof(messageResponses[0]), &value))
             {
-                if(strcmp(messageResponce->valuestring, "message_accepted") == 0)
-                {
-                    messageOriginate->messageResponse = MESSAGE_ACCEPTED;
-                }
-                else if (strcmp(messageResponce->valuestring, "subscription_invalid") == 0)
-                {
-                    messageOriginate->messageResponse = SUBSCRIPTION_INVALID;
-                }
-                else if (strcmp(messageResponce->valuestring, "message_discarded_on_overflow") == 0)
-                {
-                    messageOriginate->messageResponse = MESSAGE_DISCARDED_ON_OVERFLOW;
-                }
+                fields.messageResponse = (messageOriginateResponses_t)value;
             }
-            messageOriginate->messageIdSet = false;
-            if(messageOriginate->messageResponse == MESSAGE_ACCEPTED)
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-                if(cJSON_IsNumber(messageId))
-                {
-                    if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                    {
-                        messageOriginate->messageId = messageId->valueint;
-                        messageOriginate->messageIdSet = true;
-                    }
-                }
+                messageId = number;
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            // The id only counts once the response is known, whichever order they came in
+            fields.messageIdSet = false;
+            if (fields.messageResponse == MESSAGE_ACCEPTED && messageId >= 0)
+            {
+                fields.messageId = (uint8_t)messageId;
+                fields.messageIdSet = true;
+            }
+            *messageOriginate = fields;
+            parsed = true;
         }
     }
     return parsed;
@@ -591,43 +1213,35 @@ bool parseJsprUnsMessageOriginateSegment(char * jsprString, jsprMessageOriginate
 
     if ((jsprString != NULL) && (messageOriginateSegment != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageOriginateSegment_t fields = *messageOriginateSegment;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageOriginateSegment->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * segmentLength = cJSON_GetObjectItem(root, "segment_length");
-            if(cJSON_IsNumber(segmentLength))
+            else if (isJsonKey(&member, "segment_length") && readJsonInteger(&member, 1, 1446, &number))
             {
-                if(segmentLength->valueint >= 1 && segmentLength->valueint <= 1446)
-                {
-                    messageOriginateSegment->segmentLength = segmentLength->valueint;
-                }
+                fields.segmentLength = (uint16_t)number;
             }
-            cJSON * segmentStart = cJSON_GetObjectItem(root, "segment_start");
-            if(cJSON_IsNumber(segmentStart))
+            else if (isJsonKey(&member, "segment_start") && readJsonInteger(&member, 0, 100001, &number))
             {
-                if(segmentStart->valueint >= 0 && segmentStart->valueint <= 100001)
-                {
-                    messageOriginateSegment->segmentStart = segmentStart->valueint;
-                }
+                fields.segmentStart = (uint32_t)number;
             }
-            cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-            if(cJSON_IsNumber(messageId))
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                {
-                    messageOriginateSegment->messageId = messageId->valueint;
-                }
+                fields.messageId = (uint8_t)number;
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            *messageOriginateSegment = fields;
+            parsed = true;
         }
     }
     return parsed;
@@ -639,90 +1253,121 @@ bool parseJsprUnsMessageTerminate(char * jsprString, jsprMessageTerminate_t * me
 
     if ((jsprString != NULL) && (messageTerminate != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageTerminate_t fields = *messageTerminate;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageTerminate->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * messageLengthMax = cJSON_GetObjectItem(root, "message_length_max");
-            if(cJSON_IsNumber(messageLengthMax))
+            else if (isJsonKey(&member, "message_length_max") && readJsonInteger(&member, 3, 100002, &number))
             {
-                if(messageLengthMax->valueint >= 3 && messageLengthMax->valueint <= 100002)
-                {
-                    messageTerminate->messageLengthMax = messageLengthMax->valueint;
-                }
+                fields.messageLengthMax = (uint32_t)number;
             }
-            cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-            if(cJSON_IsNumber(messageId))
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                {
-                    messageTerminate->messageId = messageId->valueint;
-                }
+                fields.messageId = (uint8_t)number;
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            *messageTerminate = fields;
+            parsed = true;
         }
     }
     return parsed;
 }
 
+// Base64 text can only carry "\/", which JSON allows for '/', undo it in place.
+// Any other escape can't be base64 and fails the string
+static bool unescapeJsonBase64(char * value, size_t * length)
+{
+    bool valid = true;
+    size_t in = 0;
+    size_t out = 0;
+
+    if (memchr(value, '\\', *length) != NULL)
+    {
+        while (in < *length && valid)
+        {
+            if (value[in] == '\\')
+            {
+                valid = (in + 1U < *length) && (value[in + 1U] == '/');
+                in++;
+            }
+            if (valid)
+            {
+                value[out++] = value[in++];
+            }
+        }
+        *length = out;
+    }
+    return valid;
+}
+
 bool parseJsprUnsMessageTerminateSegment(char * jsprString, jsprMessageTerminateSegment_t * messageTerminateSegment)
 {
     bool parsed = false;
 
+    // Data is left in place in the receive window for the caller to decode
+    // into the MT message so the segment is never copied
     if ((jsprString != NULL) && (messageTerminateSegment != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageTerminateSegment_t fields;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        int next;
+
+        memset(&fields, 0, sizeof(jsprMessageTerminateSegment_t));
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageTerminateSegment->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * segmentLength = cJSON_GetObjectItem(root, "segment_length");
-            if(cJSON_IsNumber(segmentLength))
+            else if (isJsonKey(&member, "segment_length") && readJsonInteger(&member, 1, 1446, &number))
             {
-                if(segmentLength->valueint >= 1 && segmentLength->valueint <= 1446)
-                {
-                    messageTerminateSegment->segmentLength = segmentLength->valueint;
-                }
+                fields.segmentLength = (uint16_t)number;
             }
-            cJSON * segmentStart = cJSON_GetObjectItem(root, "segment_start");
-            if(cJSON_IsNumber(segmentStart))
+            else if (isJsonKey(&member, "segment_start") && readJsonInteger(&member, 0, 100001, &number))
             {
-                if(segmentStart->valueint >= 0 && segmentStart->valueint <= 100001)
-                {
-                    messageTerminateSegment->segmentStart = segmentStart->valueint;
-                }
+                fields.segmentStart = (uint32_t)number;
             }
-            cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-            if(cJSON_IsNumber(messageId))
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                {
-                    messageTerminateSegment->messageId = messageId->valueint;
-                }
+                fields.messageId = (uint8_t)number;
+                fields.messageIdSet = true;
             }
-            cJSON * data = cJSON_GetObjectItem(root, "data");
-            if(cJSON_IsString(data))
+            else if (isJsonKey(&member, "data") && member.type == JSON_STRING)
             {
-                memset(messageTerminateSegment->data, 0, JSPR_MAX_SEGMENT_LENGTH);
-                memcpy(messageTerminateSegment->data, data->valuestring, strlen(data->valuestring));
-                messageTerminateSegment->dataLength = strlen(data->valuestring);
+                fields.dataLength = member.valueLength;
+                // The value lies inside jsprString, so it can be rewritten in place
+                if (unescapeJsonBase64(jsprString + (member.value - jsprString), &fields.dataLength))
+                {
+                    fields.data = member.value;
+                }
+                else
+                {
+                    fields.dataLength = 0; // Left unset, the segment then fails to decode
+                }
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            *messageTerminateSegment = fields;
+            parsed = true;
+        }
+        else if (fields.messageIdSet)
+        {
+            // Only the id, so the caller can fail the MT the broken line belonged to
+            messageTerminateSegment->messageId = fields.messageId;
+            messageTerminateSegment->messageIdSet = true;
         }
     }
     return parsed;
@@ -734,32 +1379,41 @@ bool parseJsprGetSignal(char * jsprString, jsprConstellationState_t * signal)
 
     if ((jsprString != NULL) && (signal != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprConstellationState_t fields = *signal;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        bool visibleSet = false;
+        bool levelSet = false;
+        long level = 0;
+        long number;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * constellationVisible = cJSON_GetObjectItem(root, "constellation_visible");
-            if(cJSON_IsBool(constellationVisible))
+            if (isJsonKey(&member, "constellation_visible") && (member.type == JSON_TRUE || member.type == JSON_FALSE))
             {
-                signal->constellationVisible = cJSON_IsTrue(constellationVisible);
-                if(signal->constellationVisible)
-                {
-                    cJSON * signalLevel = cJSON_GetObjectItem(root, "signal_level");
-                    if(cJSON_IsNumber(signalLevel))
-                    {
-                        signal->signalLevel = signalLevel->valueint;
-                    }
-                }
+                fields.constellationVisible = (member.type == JSON_TRUE);
+                visibleSet = true;
             }
-            cJSON * signalBars = cJSON_GetObjectItem(root, "signal_bars");
-            if(cJSON_IsNumber(signalBars))
+            else if (isJsonKey(&member, "signal_level") && member.type == JSON_NUMBER)
             {
-                if(signalBars->valueint >= 0 && signalBars->valueint <= 5)
-                {
-                    signal->signalBars = signalBars->valueint;
-                }
+                level = strtol(member.value, NULL, 10);
+                levelSet = true;
             }
-        parsed = true;
-        cJSON_Delete(root);
+            else if (isJsonKey(&member, "signal_bars") && readJsonInteger(&member, 0, 5, &number))
+            {
+                fields.signalBars = (uint8_t)number;
+            }
+        }
+        if (next == 0)
+        {
+            // The level is only meaningful while the constellation is visible
+            if (visibleSet && fields.constellationVisible && levelSet)
+            {
+                fields.signalLevel = (int16_t)level;
+            }
+            *signal = fields;
+            parsed = true;
         }
     }
     return parsed;
@@ -771,87 +1425,32 @@ bool parseJsprUnsMessageOriginateStatus(char * jsprString, jsprMessageOriginateS
 
     if ((jsprString != NULL) && (messageOriginateStatus != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageOriginateStatus_t fields = *messageOriginateStatus;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        int value;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageOriginateStatus->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-            if(cJSON_IsNumber(messageId))
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                {
-                    messageOriginateStatus->messageId = messageId->valueint;
-                }
+                fields.messageId = (uint8_t)number;
             }
-            cJSON * finalMoStatus = cJSON_GetObjectItem(root, "final_mo_status");
-            if(cJSON_IsString(finalMoStatus))
+            else if (isJsonKey(&member, "final_mo_status") && readJsonEnum(&member, finalMoStatuses, sizeof(finalMoStatuses) / sizeof(finalMoStatuses[0]), &value))
             {
-                if(strcmp(finalMoStatus->valuestring, "mo_ack_received") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MO_ACK_RECEIVED_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_discarded_on_overflow") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_DISCARDED_ON_OVERFLOW_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_expired") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_EXPIRED_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_transfer_timeout") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_TRANSFER_TIMEOUT_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "segment_not_supplied") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = SEGMENT_NOT_SUPPLIED_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "segment_incorrect") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = SEGMENT_INCORRECT_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "network_error") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = NETWORK_ERROR_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_cancelled_pre_transit") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_CANCELLED_PRE_TRANSIT_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_cancelled_in_transit") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_CANCELLED_IN_TRANSIT_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "subscription_invalid") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = SUBSCRIPTION_INVALID_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "protocol_error") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = PROTOCOL_ERROR_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_dropped_local_crc_error") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = MESSAGE_DROPPED_LOCAL_CRC_ERROR_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "crc_error_in_transfer") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = CRC_ERROR_IN_TRANSFER_MOS;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "user_supplied_crc_error") == 0)
-                {
-                    messageOriginateStatus->finalMoStatus = USER_SUPPLIED_CRC_ERROR_MOS;
-                }
+                fields.finalMoStatus = (jsprFinalMoStatus_t)value;
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            *messageOriginateStatus = fields;
+            parsed = true;
         }
     }
     return parsed;
@@ -863,59 +1462,44 @@ bool parseJsprUnsMessageTerminateStatus(char * jsprString, jsprMessageTerminateS
 
     if ((jsprString != NULL) && (messageTerminateStatus != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
-        if (root != NULL)
+        jsprMessageTerminateStatus_t fields = *messageTerminateStatus;
+        const char * cursor = jsprString;
+        jsonMember_t member;
+        long number;
+        int value;
+        int next;
+
+        while ((next = nextJsonMember(&cursor, &member)) > 0)
         {
-            cJSON * topicId = cJSON_GetObjectItem(root, "topic_id");
-            if(cJSON_IsNumber(topicId))
+            if (isJsonKey(&member, "topic_id") && readJsonInteger(&member, 64, 65535, &number))
             {
-                if(topicId->valueint >= 64 && topicId->valueint <= 65535)
-                {
-                    messageTerminateStatus->topic = topicId->valueint;
-                }
+                fields.topic = (uint16_t)number;
             }
-            cJSON * messageId = cJSON_GetObjectItem(root, "message_id");
-            if(cJSON_IsNumber(messageId))
+            else if (isJsonKey(&member, "message_id") && readJsonInteger(&member, 0, 255, &number))
             {
-                if(messageId->valueint >= 0 && messageId->valueint <= 255)
-                {
-                    messageTerminateStatus->messageId = messageId->valueint;
-                }
+                fields.messageId = (uint8_t)number;
             }
-            cJSON * finalMoStatus = cJSON_GetObjectItem(root, "final_mt_status");
-            if(cJSON_IsString(finalMoStatus))
+            else if (isJsonKey(&member, "final_mt_status") && readJsonEnum(&member, finalMtStatuses, sizeof(finalMtStatuses) / sizeof(finalMtStatuses[0]), &value))
             {
-                if(strcmp(finalMoStatus->valuestring, "complete") == 0)
-                {
-                    messageTerminateStatus->finalMtStatus = COMPLETE;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_timed_out") == 0)
-                {
-                    messageTerminateStatus->finalMtStatus = MESSAGE_TIMED_OUT;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "message_cancelled") == 0)
-                {
-                    messageTerminateStatus->finalMtStatus = MESSAGE_CANCELLED;
-                }
-                else if (strcmp(finalMoStatus->valuestring, "crc_error_in_transfer") == 0)
-                {
-                    messageTerminateStatus->finalMtStatus = CRC_ERROR_IN_TRANSFER;
-                }
+                fields.finalMtStatus = (jsprFinalMtStatus_t)value;
             }
-        parsed = true;
-        cJSON_Delete(root);
+        }
+        if (next == 0)
+        {
+            *messageTerminateStatus = fields;
+            parsed = true;
         }
     }
     return parsed;
 }
 
-bool parseJsprGetMessageProvisioning(char * jsprString, jsprMessageProvisioning_t * messageProvisioning)
+bool parseJsprGetMessageProvisioning(jsprContext_t * jspr, char * jsprString, jsprMessageProvisioning_t * messageProvisioning)
 {
         bool parsed = false;
 
     if ((jsprString != NULL) && (messageProvisioning != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * provisioning = cJSON_GetObjectItem(root, "provisioning");
@@ -978,19 +1562,19 @@ bool parseJsprGetMessageProvisioning(char * jsprString, jsprMessageProvisioning_
             }
         messageProvisioning->provisioningSet = true;
         parsed = true;
-        cJSON_Delete(root);
+        deleteJsprJson(jspr, root);
         }
     }
     return parsed;
 }
 
-bool parseJsprGetHwInfo(char * jsprString, jsprHwInfo_t * hwInfo)
+bool parseJsprGetHwInfo(jsprContext_t * jspr, char * jsprString, jsprHwInfo_t * hwInfo)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (hwInfo != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * hwVersion = cJSON_GetObjectItem(root, "hw_version");
@@ -1017,19 +1601,19 @@ bool parseJsprGetHwInfo(char * jsprString, jsprHwInfo_t * hwInfo)
                 hwInfo->boardTemp = boardTemp->valueint;
             }
         parsed = true;
-        cJSON_Delete(root);
+        deleteJsprJson(jspr, root);
         }
     }
     return parsed;
 }
 
-bool parseJsprGetSimStatus(char * jsprString, jsprSimStatus_t * simStatus)
+bool parseJsprGetSimStatus(jsprContext_t * jspr, char * jsprString, jsprSimStatus_t * simStatus)
 {
     bool parsed = false;
 
     if ((jsprString != NULL) && (simStatus != NULL))
     {
-        cJSON * root = cJSON_Parse(jsprString);
+        cJSON * root = parseJsprJson(jspr, jsprString);
         if (root != NULL)
         {
             cJSON * cardPresent = cJSON_GetObjectItem(root, "card_present");
@@ -1049,7 +1633,7 @@ bool parseJsprGetSimStatus(char * jsprString, jsprSimStatus_t * simStatus)
                 memcpy(simStatus->iccid, iccid->valuestring, JSPR_ICCID_MAX_LENGTH - 1);
             }
         parsed = true;
-        cJSON_Delete(root);
+        deleteJsprJson(jspr, root);
         }
     }
     return parsed;
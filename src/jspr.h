@@ -9,15 +9,38 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "crossplatform.h"
+#include "serial.h"
 
 #define RX_BUFFER_SIZE 8192U
 #define TX_BUFFER_SIZE 8192U
+#define COMMAND_MAX_LEN 2048U
 
 #define JSPR_MAX_TARGET_LENGTH 30U
 #define JSPR_RESULT_CODE_LENGTH 3U
 #define JSPR_MIN_RESPONSE 9U
 #define JSPR_MAX_TARGET_LENGTH 30U
 #define JSPR_MAX_JSON_LENGTH 3500U
+
+/**
+ * @def JSPR_JSON_ARENA_SIZE
+ * @brief Bytes each JSPR context sets aside for the cJSON tree of one response.
+ *
+ * A cJSON node costs several times the text it was parsed from, four times the
+ * largest response covers every query the library makes. Anything that does
+ * not fit falls back to the heap and is counted in jsonArenaOverflows.
+ */
+#ifndef JSPR_JSON_ARENA_SIZE
+#define JSPR_JSON_ARENA_SIZE (JSPR_MAX_JSON_LENGTH * 4U)
+#endif
+
+/**
+ * @def JSPR_RESPONSE_IDLE_MS
+ * @brief How long receiveJspr() keeps waiting for a reply once the port goes quiet,
+ * however short serialContext::serialReadTimeoutUs is.
+ */
+#ifndef JSPR_RESPONSE_IDLE_MS
+#define JSPR_RESPONSE_IDLE_MS 500U
+#endif
 #define JSPR_MAX_SEGMENT_LENGTH 1447U
 #define JSPR_MAX_NUM_API_VERSIONS 2U
 #define JSPR_VERSION_INFO_BUILD_INFO_LEN 50U
@@ -61,14 +84,69 @@ enum responseCodes
     JSPR_RC_SERIAL_PORT_ERROR = 500
 };
 
+/**
+ * @brief JSPR targets the library understands, resolved once when a line is framed.
+ */
+typedef enum
+{
+    JSPR_TARGET_UNKNOWN = 0,
+    JSPR_TARGET_API_VERSION,
+    JSPR_TARGET_SIM_CONFIG,
+    JSPR_TARGET_SIM_STATUS,
+    JSPR_TARGET_OPERATIONAL_STATE,
+    JSPR_TARGET_SERVICE_CONFIG,
+    JSPR_TARGET_HW_INFO,
+    JSPR_TARGET_FIRMWARE,
+    JSPR_TARGET_BOOT_INFO,
+    JSPR_TARGET_CONSTELLATION_STATE,
+    JSPR_TARGET_MESSAGE_PROVISIONING,
+    JSPR_TARGET_MESSAGE_ORIGINATE,
+    JSPR_TARGET_MESSAGE_ORIGINATE_SEGMENT,
+    JSPR_TARGET_MESSAGE_ORIGINATE_STATUS,
+    JSPR_TARGET_MESSAGE_TERMINATE,
+    JSPR_TARGET_MESSAGE_TERMINATE_SEGMENT,
+    JSPR_TARGET_MESSAGE_TERMINATE_STATUS,
+    JSPR_TARGET_COUNT
+} jsprTarget_t;
+
+/**
+ * @brief A framed JSPR line.
+ *
+ * target and json are NULL terminated views into the JSPR receive window, they
+ * stay valid until the next call to receiveJspr() or pollJspr().
+ */
 typedef struct
 {
     uint32_t code;
-    char target[JSPR_MAX_TARGET_LENGTH];
-    char json[JSPR_MAX_JSON_LENGTH];
+    char * target;
+    jsprTarget_t targetId;  /**< target resolved to an enum, JSPR_TARGET_UNKNOWN if not one of ours */
+    char * json;
     uint16_t jsonSize;
 } jsprResponse_t;
 
+/**
+ * @brief Per-device JSPR state, one for each serial port.
+ *
+ * Lines are framed in place in rxBuffer and handed out as views into it.
+ * Bytes between rxStart and rxEnd are unconsumed, anything before rxScanned
+ * is known not to contain a line terminator. Responses parsed with cJSON are
+ * built in jsonArena, which is emptied again once the parse is done.
+ */
+typedef struct
+{
+    serialContext * serial;
+    char rxBuffer[RX_BUFFER_SIZE];
+    size_t rxStart;
+    size_t rxEnd;
+    size_t rxScanned;
+    char commandBuffer[COMMAND_MAX_LEN];
+    int messageReference;
+    uint64_t jsonArena[JSPR_JSON_ARENA_SIZE / sizeof(uint64_t)]; /**< Backs cJSON while one response is parsed */
+    size_t jsonArenaUsed;
+    size_t jsonArenaHighWater;      /**< Most arena bytes a single response has needed */
+    uint32_t jsonArenaOverflows;    /**< Allocations that did not fit and went to the heap */
+} jsprContext_t;
+
 typedef struct
 {
     uint8_t major;
@@ -191,9 +269,10 @@ typedef struct
 {
     uint16_t topic;
     uint8_t messageId;
+    bool messageIdSet;      /**< message_id was read, also reported when the rest of the line is malformed */
     uint16_t segmentLength;
     uint32_t segmentStart;
-    char data[JSPR_MAX_SEGMENT_LENGTH];
+    const char * data;      /**< Base64 segment, a view into the JSPR receive window, not NULL terminated */
     size_t dataLength;
 } jsprMessageTerminateSegment_t;
 
@@ -286,15 +365,22 @@ typedef struct
 } jsprSimStatus_t;
 
 //internal functions
-int sendJspr(const char * buffer, size_t length);
-bool receiveJspr(jsprResponse_t * response, const char * expectedTarget);
-bool waitForJsprMessage(jsprResponse_t * response, const char * expectedTarget, const uint32_t expectedCode, const uint32_t timeoutSeconds);
+void jsprInit(jsprContext_t * jspr, serialContext * serial);
+void jsprSetJsonHooks(void * (*allocate)(size_t size), void (*release)(void * block));
+int sendJspr(jsprContext_t * jspr, const char * buffer, size_t length);
+int sendJsprSpans(jsprContext_t * jspr, const serialSpan_t * spans, const size_t count);
+bool receiveJspr(jsprContext_t * jspr, jsprResponse_t * response, const char * expectedTarget);
+bool pollJspr(jsprContext_t * jspr, jsprResponse_t * response);
+bool waitJspr(jsprContext_t * jspr, const uint32_t timeoutMs);
+void resetJspr(jsprContext_t * jspr);
+bool waitForJsprMessage(jsprContext_t * jspr, jsprResponse_t * response, const char * expectedTarget, const uint32_t expectedCode, const uint32_t timeoutSeconds);
 void clearResponse(jsprResponse_t * response);
-bool parseJsprBootInfo(const char * jsprString, jsprBootInfo_t * bootInfo);
-bool parseJsprGetApiVersion(char * jsprString, jsprApiVersion_t * apiVersion);
-bool parseJsprFirmwareInfo(const char * jsprString, jsprFirmwareInfo_t * firmwareInfo);
-bool parseJsprGetSimInterface(char * jsprString, jsprSimInterface_t * simInterface);
-bool parseJsprGetOperationalState(char * jsprString, jsprOperationalState_t * operationalState);
+jsprTarget_t jsprLookupTarget(const char * target, size_t length);
+bool parseJsprBootInfo(jsprContext_t * jspr, const char * jsprString, jsprBootInfo_t * bootInfo);
+bool parseJsprGetApiVersion(jsprContext_t * jspr, char * jsprString, jsprApiVersion_t * apiVersion);
+bool parseJsprFirmwareInfo(jsprContext_t * jspr, const char * jsprString, jsprFirmwareInfo_t * firmwareInfo);
+bool parseJsprGetSimInterface(jsprContext_t * jspr, char * jsprString, jsprSimInterface_t * simInterface);
+bool parseJsprGetOperationalState(jsprContext_t * jspr, char * jsprString, jsprOperationalState_t * operationalState);
 bool parseJsprPutMessageOriginate(char * jsprString, jsprMessageOriginate_t * messageOriginate);
 bool parseJsprUnsMessageOriginateSegment(char * jsprString, jsprMessageOriginateSegment_t * messageOriginateSegment);
 bool parseJsprUnsMessageTerminate(char * jsprString, jsprMessageTerminate_t * messageTerminate);
@@ -302,9 +388,9 @@ bool parseJsprUnsMessageTerminateSegment(char * jsprString, jsprMessageTerminate
 bool parseJsprGetSignal(char * jsprString, jsprConstellationState_t * signal);
 bool parseJsprUnsMessageOriginateStatus(char * jsprString, jsprMessageOriginateStatus_t * messageOriginateStatus);
 bool parseJsprUnsMessageTerminateStatus(char * jsprString, jsprMessageTerminateStatus_t * messageTerminateStatus);
-bool parseJsprGetMessageProvisioning(char * jsprString, jsprMessageProvisioning_t * messageProvisioning);
-bool parseJsprGetHwInfo(char * jsprString, jsprHwInfo_t * hwInfo);
-bool parseJsprGetSimStatus(char * jsprString, jsprSimStatus_t * simStatus);
+bool parseJsprGetMessageProvisioning(jsprContext_t * jspr, char * jsprString, jsprMessageProvisioning_t * messageProvisioning);
+bool parseJsprGetHwInfo(jsprContext_t * jspr, char * jsprString, jsprHwInfo_t * hwInfo);
+bool parseJsprGetSimStatus(jsprContext_t * jspr, char * jsprString, jsprSimStatus_t * simStatus);
 
 #ifdef __cplusplus
 }
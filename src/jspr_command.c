@@ -3,10 +3,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-extern serialContext context;
-extern int messageReference;
-static uint8_t jsprCommandBuffer [COMMAND_MAX_LEN];
-
 #define JSPR_GET_API_LEN 18U
 #define JSPR_GET_SIM_CONFIG_LEN 17U
 #define JSPR_GET_OPERATIONAL_STATE_LEN 24U
@@ -18,13 +14,13 @@ static uint8_t jsprCommandBuffer [COMMAND_MAX_LEN];
 #define JSPR_GET_FIRMWARE_LEN 16U
 #define JSPR_GET_SIM_STATUS_LEN 17U
 
-bool jsprGetApiVersion(void)
+bool jsprGetApiVersion(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getApiVersionStr[JSPR_GET_API_LEN] = "GET apiVersion {}\r";
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getApiVersionStr, JSPR_GET_API_LEN) == JSPR_GET_API_LEN)
+        if(sendJspr(jspr, getApiVersionStr, JSPR_GET_API_LEN) == JSPR_GET_API_LEN)
         {
             rVal = true;
         }
@@ -32,20 +28,20 @@ bool jsprGetApiVersion(void)
     return rVal;
 }
 
-bool jsprPutApiVersion(const jsprDottedVersion_t * apiVersion)
+bool jsprPutApiVersion(jsprContext_t * jspr, const jsprDottedVersion_t * apiVersion)
 {
     bool rVal = false;
     int rc = 0;
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer),
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer),
             "PUT apiVersion {\"active_version\": {\"major\": %d, \"minor\": %d, \"patch\": %d}}\r",
             apiVersion->major, apiVersion->minor, apiVersion->patch);
 
     if (rc > 0)
     {
         const size_t putApiVersionStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putApiVersionStrLen) == putApiVersionStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putApiVersionStrLen) == putApiVersionStrLen)
             {
                 rVal = true;
             }
@@ -55,41 +51,41 @@ bool jsprPutApiVersion(const jsprDottedVersion_t * apiVersion)
     return rVal;
 }
 
-bool putSimInterface(const availableSimInterfaces_t iface)
+bool putSimInterface(jsprContext_t * jspr, const availableSimInterfaces_t iface)
 {
     bool rVal = false;
 
     switch (iface)
     {
         case SIM_NONE:
-            rVal =  jsprPutSimInterface("none");
+            rVal =  jsprPutSimInterface(jspr, "none");
         break;
 
         case SIM_LOCAL:
-            rVal =  jsprPutSimInterface("local");
+            rVal =  jsprPutSimInterface(jspr, "local");
         break;
 
         case SIM_REMOTE:
-            rVal =  jsprPutSimInterface("remote");
+            rVal =  jsprPutSimInterface(jspr, "remote");
         break;
 
         case SIM_INTERNAL:
         // Fall through
         default:
-            rVal =  jsprPutSimInterface("internal");
+            rVal =  jsprPutSimInterface(jspr, "internal");
         break;
     }
 
     return rVal;
 }
 
-bool jsprGetSimInterface(void)
+bool jsprGetSimInterface(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getSimInterfaceStr[JSPR_GET_SIM_CONFIG_LEN] = "GET simConfig {}\r";
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getSimInterfaceStr, JSPR_GET_SIM_CONFIG_LEN) == JSPR_GET_SIM_CONFIG_LEN)
+        if(sendJspr(jspr, getSimInterfaceStr, JSPR_GET_SIM_CONFIG_LEN) == JSPR_GET_SIM_CONFIG_LEN)
         {
             rVal = true;
         }
@@ -97,20 +93,20 @@ bool jsprGetSimInterface(void)
     return rVal;
 }
 
-bool jsprPutSimInterface(const char * iface)
+bool jsprPutSimInterface(jsprContext_t * jspr, const char * iface)
 {
     bool rVal = false;
     int rc = 0;
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer),
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer),
             "PUT simConfig {\"interface\": \"%s\"}\r", iface);
 
     if (rc > 0)
     {
         const size_t putSimInterfaceStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putSimInterfaceStrLen) == putSimInterfaceStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putSimInterfaceStrLen) == putSimInterfaceStrLen)
             {
                 rVal = true;
             }
@@ -120,54 +116,54 @@ bool jsprPutSimInterface(const char * iface)
     return rVal;
 }
 
-bool putOperationalState(availableOperationalStates_t state)
+bool putOperationalState(jsprContext_t * jspr, availableOperationalStates_t state)
 {
     bool rVal = false;
 
     switch (state)
     {
         case INACTIVE:
-            rVal = jsprPutOperationalState("inactive");
+            rVal = jsprPutOperationalState(jspr, "inactive");
         break;
 
         case CAL_TEST:
-            rVal = jsprPutOperationalState("cal_test");
+            rVal = jsprPutOperationalState(jspr, "cal_test");
         break;
 
         case HW_SELF_TEST:
-            rVal = jsprPutOperationalState("hw_self_test");
+            rVal = jsprPutOperationalState(jspr, "hw_self_test");
         break;
 
         case RF_SCAN:
-            rVal = jsprPutOperationalState("rf_scan");
+            rVal = jsprPutOperationalState(jspr, "rf_scan");
         break;
 
         case LOOPBACK:
-            rVal = jsprPutOperationalState("loopback");
+            rVal = jsprPutOperationalState(jspr, "loopback");
         break;
 
         case FAULT:
-            rVal = jsprPutOperationalState("fault");
+            rVal = jsprPutOperationalState(jspr, "fault");
         break;
 
         case ACTIVE:
         // fall through
         default:
-            rVal = jsprPutOperationalState("active");
+            rVal = jsprPutOperationalState(jspr, "active");
         break;
     }
 
     return rVal;
 }
 
-bool jsprGetOperationalState(void)
+bool jsprGetOperationalState(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getOperationalStateStr[JSPR_GET_OPERATIONAL_STATE_LEN] = "GET operationalState {}\r";
 
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getOperationalStateStr, JSPR_GET_OPERATIONAL_STATE_LEN) == JSPR_GET_OPERATIONAL_STATE_LEN)
+        if(sendJspr(jspr, getOperationalStateStr, JSPR_GET_OPERATIONAL_STATE_LEN) == JSPR_GET_OPERATIONAL_STATE_LEN)
         {
             rVal = true;
         }
@@ -175,20 +171,20 @@ bool jsprGetOperationalState(void)
     return rVal;
 }
 
-bool jsprPutOperationalState(const char * state)
+bool jsprPutOperationalState(jsprContext_t * jspr, const char * state)
 {
     bool rVal = false;
     int rc = 0;
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer),
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer),
             "PUT operationalState {\"state\": \"%s\"}\r", state);
 
     if (rc > 0)
     {
         const size_t putOperationalStateStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putOperationalStateStrLen) == putOperationalStateStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putOperationalStateStrLen) == putOperationalStateStrLen)
             {
                 rVal = true;
             }
@@ -198,26 +194,26 @@ bool jsprPutOperationalState(const char * state)
     return rVal;
 }
 
-bool jsprPutMessageOriginate(const uint16_t topic, const size_t length)
+bool jsprPutMessageOriginate(jsprContext_t * jspr, const uint16_t topic, const size_t length)
 {
     bool rVal = false;
     int rc = 0;
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer),
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer),
             "PUT messageOriginate {\"topic_id\":%d, \"message_length\":%ld, \"request_reference\":%d}\r",
-            topic, length, messageReference);
+            topic, length, jspr->messageReference);
 
     if (rc > 0)
     {
-        messageReference++;
-        if(messageReference > 100)
+        jspr->messageReference++;
+        if(jspr->messageReference > 100)
         {
-            messageReference = 1;
+            jspr->messageReference = 1;
         }
         const size_t putMessageOriginateStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putMessageOriginateStrLen) == putMessageOriginateStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putMessageOriginateStrLen) == putMessageOriginateStrLen)
             {
                 rVal = true;
             }
@@ -227,21 +223,93 @@ bool jsprPutMessageOriginate(const uint16_t topic, const size_t length)
     return rVal;
 }
 
-bool jsprPutMessageOriginateSegment(jsprMessageOriginate_t * messageOriginate, const size_t segmentLength, uint32_t segmentStart, const char * data)
+static const char base64Alphabet[64] =
+{
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
+};
+
+static char * encodeBase64Groups(char * dest, const uint8_t * src, size_t groups)
+{
+    for (size_t i = 0; i < groups; i++, src += 3)
+    {
+        uint32_t triple = ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 8) | (uint32_t)src[2];
+        dest[0] = base64Alphabet[(triple >> 18) & 0x3FU];
+        dest[1] = base64Alphabet[(triple >> 12) & 0x3FU];
+        dest[2] = base64Alphabet[(triple >> 6) & 0x3FU];
+        dest[3] = base64Alphabet[triple & 0x3FU];
+        dest += 4;
+    }
+    return dest;
+}
+
+static char * encodeBase64Final(char * dest, const uint8_t * src, size_t length)
+{
+    if (length > 0)
+    {
+        uint32_t triple = (uint32_t)src[0] << 16;
+        if (length > 1)
+        {
+            triple |= (uint32_t)src[1] << 8;
+        }
+        dest[0] = base64Alphabet[(triple >> 18) & 0x3FU];
+        dest[1] = base64Alphabet[(triple >> 12) & 0x3FU];
+        dest[2] = (length > 1) ? base64Alphabet[(triple >> 6) & 0x3FU] : '=';
+        dest[3] = '=';
+        dest += 4;
+    }
+    return dest;
+}
+
+// Encode data followed by tail as one base64 string, the group straddling the two is joined on the stack
+static char * encodeBase64Spans(char * dest, const uint8_t * data, size_t dataLength, const uint8_t * tail, size_t tailLength)
+{
+    uint8_t joint[3];
+    size_t jointLength = dataLength % 3U;
+
+    dest = encodeBase64Groups(dest, data, dataLength / 3U);
+    if (jointLength > 0)
+    {
+        memcpy(joint, data + (dataLength - jointLength), jointLength);
+        while (jointLength < 3U && tailLength > 0)
+        {
+            joint[jointLength++] = *tail++;
+            tailLength--;
+        }
+        dest = (jointLength == 3U) ? encodeBase64Groups(dest, joint, 1) : encodeBase64Final(dest, joint, jointLength);
+    }
+    if (tailLength > 0)
+    {
+        dest = encodeBase64Groups(dest, tail, tailLength / 3U);
+        dest = encodeBase64Final(dest, tail + (tailLength - (tailLength % 3U)), tailLength % 3U);
+    }
+    return dest;
+}
+
+bool jsprPutMessageOriginateSegment(jsprContext_t * jspr, jsprMessageOriginate_t * messageOriginate, const size_t segmentLength, uint32_t segmentStart,
+                                    const uint8_t * data, const size_t dataLength, const uint8_t * tail, const size_t tailLength)
 {
     bool rVal = false;
     int rc = 0;
+    const char suffix[] = "\"}\r";
+    const size_t encodedLength = ((segmentLength + 2U) / 3U) * 4U;
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer),
-            "PUT messageOriginateSegment {\"topic_id\":%d, \"message_id\":%d, \"segment_length\":%ld, \"segment_start\":%d, \"data\":\"%s\"}\r",
-            messageOriginate->topic, messageOriginate->messageId, segmentLength, segmentStart, data);
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer),
+            "PUT messageOriginateSegment {\"topic_id\":%d, \"message_id\":%d, \"segment_length\":%ld, \"segment_start\":%d, \"data\":\"",
+            messageOriginate->topic, messageOriginate->messageId, segmentLength, segmentStart);
 
-    if (rc > 0)
+    if (rc > 0 && (dataLength + tailLength) == segmentLength && (data != NULL || dataLength == 0) && (tail != NULL || tailLength == 0) &&
+        ((size_t)rc + encodedLength + sizeof(suffix)) <= sizeof(jspr->commandBuffer))
     {
-        const size_t putMessageOriginateSegmentStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        // Encode the segment straight into the command buffer behind the JSON prefix, the terminator goes out as its own span
+        char * end = encodeBase64Spans(&jspr->commandBuffer[rc], data, dataLength, tail, tailLength);
+        const serialSpan_t spans[2] = { { jspr->commandBuffer, (size_t)(end - jspr->commandBuffer) }, { suffix, sizeof(suffix) - 1U } };
+        const size_t putMessageOriginateSegmentStrLen = spans[0].length + spans[1].length;
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putMessageOriginateSegmentStrLen) == putMessageOriginateSegmentStrLen)
+            if(sendJsprSpans(jspr, spans, 2) == (int)putMessageOriginateSegmentStrLen)
             {
                 rVal = true;
             }
@@ -251,14 +319,14 @@ bool jsprPutMessageOriginateSegment(jsprMessageOriginate_t * messageOriginate, c
     return rVal;
 }
 
-bool jsprGetSignal(void)
+bool jsprGetSignal(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getSignalStr[JSPR_GET_SIGNAL_LEN] = "GET constellationState {}\r";
 
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getSignalStr, JSPR_GET_SIGNAL_LEN) == JSPR_GET_SIGNAL_LEN)
+        if(sendJspr(jspr, getSignalStr, JSPR_GET_SIGNAL_LEN) == JSPR_GET_SIGNAL_LEN)
         {
             rVal = true;
         }
@@ -266,13 +334,13 @@ bool jsprGetSignal(void)
     return rVal;
 }
 
-bool jsprGetMessageProvisioning(void)
+bool jsprGetMessageProvisioning(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getMessageProvisioningStr[JSPR_GET_MESSAGE_PROVISIONING_LEN] = "GET messageProvisioning {}\r";
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getMessageProvisioningStr, JSPR_GET_MESSAGE_PROVISIONING_LEN) == JSPR_GET_MESSAGE_PROVISIONING_LEN)
+        if(sendJspr(jspr, getMessageProvisioningStr, JSPR_GET_MESSAGE_PROVISIONING_LEN) == JSPR_GET_MESSAGE_PROVISIONING_LEN)
         {
             rVal = true;
         }
@@ -280,13 +348,13 @@ bool jsprGetMessageProvisioning(void)
     return rVal;
 }
 
-bool jsprGetHwInfo(void)
+bool jsprGetHwInfo(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getHwInfoStr[JSPR_GET_HW_INFO_LEN] = "GET hwInfo {}\r";
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getHwInfoStr, JSPR_GET_HW_INFO_LEN) == JSPR_GET_HW_INFO_LEN)
+        if(sendJspr(jspr, getHwInfoStr, JSPR_GET_HW_INFO_LEN) == JSPR_GET_HW_INFO_LEN)
         {
             rVal = true;
         }
@@ -314,7 +382,7 @@ static void bootSlotToStr(const jsprBootSource_t slot, char * dest, const size_t
     }
 }
 
-bool jsprGetFirmware(const jsprBootSource_t slot)
+bool jsprGetFirmware(jsprContext_t * jspr, const jsprBootSource_t slot)
 {
     bool rVal = false;
     int rc = 0;
@@ -322,14 +390,14 @@ bool jsprGetFirmware(const jsprBootSource_t slot)
 
     bootSlotToStr(slot, slotStr, JSPR_BOOT_SOURCE_STR_LEN);
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer), "GET firmware {\"slot\": \"%s\"}\r", slotStr);
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer), "GET firmware {\"slot\": \"%s\"}\r", slotStr);
 
     if (rc > 0)
     {
         const size_t getFirmwareStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, getFirmwareStrLen) == getFirmwareStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, getFirmwareStrLen) == getFirmwareStrLen)
             {
                 rVal = true;
             }
@@ -339,7 +407,7 @@ bool jsprGetFirmware(const jsprBootSource_t slot)
     return rVal;
 }
 
-bool jsprPutFirmware(const jsprBootSource_t slot)
+bool jsprPutFirmware(jsprContext_t * jspr, const jsprBootSource_t slot)
 {
     bool rVal = false;
     int rc = 0;
@@ -347,14 +415,14 @@ bool jsprPutFirmware(const jsprBootSource_t slot)
 
     bootSlotToStr(slot, slotStr, JSPR_BOOT_SOURCE_STR_LEN);
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer), "PUT firmware {\"slot\": \"%s\"}\r", slotStr);
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer), "PUT firmware {\"slot\": \"%s\"}\r", slotStr);
 
     if (rc > 0)
     {
         const size_t putFirmwareStrLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putFirmwareStrLen) == putFirmwareStrLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putFirmwareStrLen) == putFirmwareStrLen)
             {
                 rVal = true;
             }
@@ -364,13 +432,13 @@ bool jsprPutFirmware(const jsprBootSource_t slot)
     return rVal;
 }
 
-bool jsprGetSimStatus(void)
+bool jsprGetSimStatus(jsprContext_t * jspr)
 {
     bool rVal = false;
     const char getSimStatusStr[JSPR_GET_SIM_STATUS_LEN] = "GET simStatus {}\r";
-    if (context.serialWrite != NULL)
+    if (jspr->serial->serialWrite != NULL)
     {
-        if(sendJspr(getSimStatusStr, JSPR_GET_SIM_STATUS_LEN) == JSPR_GET_SIM_STATUS_LEN)
+        if(sendJspr(jspr, getSimStatusStr, JSPR_GET_SIM_STATUS_LEN) == JSPR_GET_SIM_STATUS_LEN)
         {
             rVal = true;
         }
@@ -378,19 +446,19 @@ bool jsprGetSimStatus(void)
     return rVal;
 }
 
-bool jsprPutServiceConfig(const bool resync)
+bool jsprPutServiceConfig(jsprContext_t * jspr, const bool resync)
 {
     bool rVal = false;
     int rc = 0;
 
-    rc = snprintf(jsprCommandBuffer, sizeof(jsprCommandBuffer), "PUT serviceConfig {\"resync\": %s}\r", resync ? "true" : "false");
+    rc = snprintf(jspr->commandBuffer, sizeof(jspr->commandBuffer), "PUT serviceConfig {\"resync\": %s}\r", resync ? "true" : "false");
 
     if (rc > 0)
     {
         const size_t putServiceConfigLen = (const size_t)rc;
-        if (context.serialWrite != NULL)
+        if (jspr->serial->serialWrite != NULL)
         {
-            if(sendJspr(jsprCommandBuffer, putServiceConfigLen) == putServiceConfigLen)
+            if(sendJspr(jspr, jspr->commandBuffer, putServiceConfigLen) == putServiceConfigLen)
             {
                 rVal = true;
             }
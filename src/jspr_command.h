@@ -9,26 +9,25 @@ extern "C" {
 #include "crossplatform.h"
 #include <stdbool.h>
 
-#define COMMAND_MAX_LEN 2048U
+bool jsprGetApiVersion(jsprContext_t * jspr);
+bool jsprPutApiVersion(jsprContext_t * jspr, const jsprDottedVersion_t * apiVersion);
+bool jsprGetSimInterface(jsprContext_t * jspr);
+bool jsprPutSimInterface(jsprContext_t * jspr, const char * iface);
+bool jsprGetOperationalState(jsprContext_t * jspr);
+bool jsprPutOperationalState(jsprContext_t * jspr, const char * state);
+bool jsprPutMessageOriginate(jsprContext_t * jspr, const uint16_t topic, const size_t length);
+bool jsprPutMessageOriginateSegment(jsprContext_t * jspr, jsprMessageOriginate_t * messageOriginate, const size_t segmentLength, uint32_t segmentStart,
+                                    const uint8_t * data, const size_t dataLength, const uint8_t * tail, const size_t tailLength);
+bool jsprGetSignal(jsprContext_t * jspr);
+bool jsprGetMessageProvisioning(jsprContext_t * jspr);
+bool jsprGetHwInfo(jsprContext_t * jspr);
+bool jsprGetFirmware(jsprContext_t * jspr, const jsprBootSource_t slot);
+bool jsprPutFirmware(jsprContext_t * jspr, const jsprBootSource_t slot);
+bool jsprGetSimStatus(jsprContext_t * jspr);
+bool jsprPutServiceConfig(jsprContext_t * jspr, const bool resync);
 
-bool jsprGetApiVersion(void);
-bool jsprPutApiVersion(const jsprDottedVersion_t * apiVersion);
-bool jsprGetSimInterface(void);
-bool jsprPutSimInterface(const char * iface);
-bool jsprGetOperationalState(void);
-bool jsprPutOperationalState(const char * state);
-bool jsprPutMessageOriginate(const uint16_t topic, const size_t length);
-bool jsprPutMessageOriginateSegment(jsprMessageOriginate_t * messageOriginate, const size_t segmentLength, uint32_t segmentStart, const char * data);
-bool jsprGetSignal(void);
-bool jsprGetMessageProvisioning(void);
-bool jsprGetHwInfo(void);
-bool jsprGetFirmware(const jsprBootSource_t slot);
-bool jsprPutFirmware(const jsprBootSource_t slot);
-bool jsprGetSimStatus(void);
-bool jsprPutServiceConfig(const bool resync);
-
-bool putSimInterface(availableSimInterfaces_t iface);
-bool putOperationalState(availableOperationalStates_t state);
+bool putSimInterface(jsprContext_t * jspr, availableSimInterfaces_t iface);
+bool putOperationalState(jsprContext_t * jspr, availableOperationalStates_t state);
 
 #ifdef __cplusplus
 }
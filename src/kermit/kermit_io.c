@@ -5,8 +5,14 @@
 #include "kermit_io.h"
 #include "../third_party/ekermit/cdefs.h"
 #include "../serial.h"
+#include "../crossplatform.h"
 
-extern serialContext context;
+static serialContext * kermitContext = NULL;
+
+void kermit_io_set_context(serialContext * context)
+{
+    kermitContext = context;
+}
 static FILE * iFile = NULL;
 
 int kermit_io_readpkt(struct k_data *k, unsigned char *p, int len)
@@ -17,18 +23,30 @@ int kermit_io_readpkt(struct k_data *k, unsigned char *p, int len)
     UCHAR strippedByte;
     short ctrlCCount = 0;
     unsigned char *ptr = p;
+    unsigned long lastByte = millis();
 
-    if (context.serialRead == NULL)
+    if (kermitContext == NULL || kermitContext->serialRead == NULL)
     {
         return X_RC_ERROR;
     }
 
     while (1)
     {
-        if (context.serialRead(&receivedByte, 1) <= 0)
+        if (kermitContext->serialRead(kermitContext, (char *)&receivedByte, 1) <= 0)
         {
-            return X_RC_OK; // Timeout case
+            // Short read timeouts are retried until the line has been quiet for KERMIT_IO_IDLE_TIMEOUT_MS
+            if (kermitContext->serialReadTimeoutUs >= KERMIT_IO_IDLE_TIMEOUT_MS * 1000UL ||
+                millis() - lastByte >= KERMIT_IO_IDLE_TIMEOUT_MS)
+            {
+                return X_RC_OK; // Timeout case
+            }
+            if (kermitContext->serialReadTimeoutUs < 1000U)
+            {
+                delay(1);
+            }
+            continue;
         }
+        lastByte = millis();
 
         // Strip parity if needed
         strippedByte = (k->parity) ? receivedByte & 0x7F : receivedByte & 0xFF;
@@ -90,12 +108,12 @@ int kermit_io_tx_data(struct k_data *k, unsigned char *p, int length)
 {
     (void)k;
 
-    if (context.serialWrite == NULL)
+    if (kermitContext == NULL || kermitContext->serialWrite == NULL)
     {
         return SUCCESS;
     }
 
-    if (context.serialWrite(p, length) < 0)
+    if (kermitContext->serialWrite(kermitContext, (const char *)p, length) < 0)
     {
         return X_RC_ERROR;
     }
@@ -122,9 +140,9 @@ int kermit_io_inchk(struct k_data * k)
 {
     (void)k;
 
-    if (context.serialPeek != NULL)
+    if (kermitContext != NULL && kermitContext->serialPeek != NULL)
     {
-        return context.serialPeek();
+        return kermitContext->serialPeek(kermitContext);
     }
 
     return X_RC_ERROR;
@@ -263,9 +281,9 @@ int kermit_io_init_string(void)
     int rVal = X_RC_ERROR;
     const char kermitInitString[] = "kermit -ir\r";
 
-    if (context.serialWrite != NULL)
+    if (kermitContext != NULL && kermitContext->serialWrite != NULL)
     {
-        if (context.serialWrite(kermitInitString, 11) >= 0)
+        if (kermitContext->serialWrite(kermitContext, kermitInitString, 11) >= 0)
         {
             rVal = SUCCESS;
         }
@@ -7,6 +7,18 @@ extern "C" {
 #endif
 
 #include "../third_party/ekermit/kermit.h"
+#include "../serial.h"
+
+/**
+ * @def KERMIT_IO_IDLE_TIMEOUT_MS
+ * @brief Silence after which kermit_io_readpkt() gives up on a packet, whatever
+ * the context's read timeout.
+ */
+#ifndef KERMIT_IO_IDLE_TIMEOUT_MS
+#define KERMIT_IO_IDLE_TIMEOUT_MS 500U
+#endif
+
+void kermit_io_set_context(serialContext * context);
 
 int kermit_io_readpkt (struct k_data * k, unsigned char *p, int len);
 int kermit_io_tx_data(struct k_data * k, unsigned char *p, int n);
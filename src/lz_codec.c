@@ -0,0 +1,269 @@
+#include "lz_codec.h"
+#include <string.h>
+
+#define LZ_HASH_SIZE (1U << LZ_HASH_BITS)
+#define LZ_RUN_MASK 15U
+
+/**
+ * @brief The dictionary followed by the input, positions run through both.
+ */
+typedef struct
+{
+    const uint8_t * dictionary;
+    size_t dictionaryLength;
+    const uint8_t * in;
+    size_t end;                 /**< dictionaryLength + input length */
+} lzWindow_t;
+
+static uint8_t byteAt(const lzWindow_t * window, const size_t position)
+{
+    return (position < window->dictionaryLength) ? window->dictionary[position] : window->in[position - window->dictionaryLength];
+}
+
+static uint32_t read32(const lzWindow_t * window, const size_t position)
+{
+    uint32_t value;
+    if(position >= window->dictionaryLength)
+    {
+        const uint8_t * bytes = window->in + (position - window->dictionaryLength);
+        value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    }
+    else
+    {
+        value = (uint32_t)byteAt(window, position) | ((uint32_t)byteAt(window, position + 1U) << 8) |
+                ((uint32_t)byteAt(window, position + 2U) << 16) | ((uint32_t)byteAt(window, position + 3U) << 24);
+    }
+    return value;
+}
+
+static uint32_t hash(const uint32_t value)
+{
+    return (value * 2654435761U) >> (32U - LZ_HASH_BITS);
+}
+
+static bool putLength(uint8_t * out, const size_t outCapacity, size_t * produced, size_t length)
+{
+    bool put = true;
+    while(put && length >= 255U)
+    {
+        put = *produced < outCapacity;
+        if(put)
+        {
+            out[(*produced)++] = 255U;
+            length -= 255U;
+        }
+    }
+    if(put && *produced < outCapacity)
+    {
+        out[(*produced)++] = (uint8_t)length;
+    }
+    else
+    {
+        put = false;
+    }
+    return put;
+}
+
+static bool putSequence(const lzWindow_t * window, const size_t anchor, const size_t literals, const size_t offset,
+                        const size_t match, uint8_t * out, const size_t outCapacity, size_t * produced)
+{
+    bool put = *produced < outCapacity;
+    if(put)
+    {
+        const size_t matchCode = (match > 0) ? match - LZ_MIN_MATCH : 0;
+        out[(*produced)++] = (uint8_t)(((literals < LZ_RUN_MASK ? literals : LZ_RUN_MASK) << 4) |
+                                       (matchCode < LZ_RUN_MASK ? matchCode : LZ_RUN_MASK));
+        if(literals >= LZ_RUN_MASK)
+        {
+            put = putLength(out, outCapacity, produced, literals - LZ_RUN_MASK);
+        }
+        if(put && literals <= outCapacity - *produced)
+        {
+            memcpy(out + *produced, window->in + (anchor - window->dictionaryLength), literals); //literals are always input
+            *produced += literals;
+        }
+        else
+        {
+            put = false;
+        }
+        if(put && match > 0)
+        {
+            put = outCapacity - *produced >= 2U;
+            if(put)
+            {
+                out[(*produced)++] = (uint8_t)offset;
+                out[(*produced)++] = (uint8_t)(offset >> 8);
+                if(matchCode >= LZ_RUN_MASK)
+                {
+                    put = putLength(out, outCapacity, produced, matchCode - LZ_RUN_MASK);
+                }
+            }
+        }
+    }
+    return put;
+}
+
+size_t lzCompress(const uint8_t * dictionary, const size_t dictionaryLength, const uint8_t * in, const size_t inLength,
+                  uint8_t * out, const size_t outCapacity)
+{
+    uint32_t table[LZ_HASH_SIZE]; //position + 1, 0 is empty
+    lzWindow_t window;
+    size_t produced = 0;
+    bool fits = inLength <= UINT32_MAX - LZ_MAX_OFFSET - 1U;
+
+    window.dictionaryLength = (dictionary != NULL) ? dictionaryLength : 0;
+    window.dictionary = dictionary;
+    if(window.dictionaryLength > LZ_MAX_OFFSET)
+    {
+        window.dictionary += window.dictionaryLength - LZ_MAX_OFFSET; //only the tail is reachable
+        window.dictionaryLength = LZ_MAX_OFFSET;
+    }
+    window.in = in;
+    window.end = window.dictionaryLength + inLength;
+
+    memset(table, 0, sizeof(table));
+    for(size_t position = 0; position + LZ_MIN_MATCH <= window.dictionaryLength; position++)
+    {
+        table[hash(read32(&window, position))] = (uint32_t)(position + 1U);
+    }
+
+    size_t position = window.dictionaryLength;
+    size_t anchor = position;
+    while(fits && position + LZ_MIN_MATCH <= window.end)
+    {
+        const uint32_t value = read32(&window, position);
+        const uint32_t slot = hash(value);
+        const size_t candidate = table[slot];
+        table[slot] = (uint32_t)(position + 1U);
+        if(candidate != 0 && position - (candidate - 1U) <= LZ_MAX_OFFSET && read32(&window, candidate - 1U) == value)
+        {
+            const size_t from = candidate - 1U;
+            size_t match = LZ_MIN_MATCH;
+            while(position + match < window.end && byteAt(&window, from + match) == byteAt(&window, position + match))
+            {
+                match++; //may run into the bytes being matched, the decoder copies forwards
+            }
+            fits = putSequence(&window, anchor, position - anchor, position - from, match, out, outCapacity, &produced);
+            for(size_t next = position + 1U; next < position + match && next + LZ_MIN_MATCH <= window.end; next++)
+            {
+                table[hash(read32(&window, next))] = (uint32_t)(next + 1U);
+            }
+            position += match;
+            anchor = position;
+        }
+        else
+        {
+            position++;
+        }
+    }
+    if(fits)
+    {
+        fits = putSequence(&window, anchor, window.end - anchor, 0, 0, out, outCapacity, &produced);
+    }
+    return fits ? produced : 0;
+}
+
+static bool getLength(const uint8_t * in, const size_t inLength, size_t * read, size_t * length)
+{
+    bool got = true;
+    uint8_t more = 255U;
+    while(got && more == 255U)
+    {
+        got = *read < inLength;
+        if(got)
+        {
+            more = in[(*read)++];
+            *length += more;
+        }
+    }
+    return got;
+}
+
+/**
+ * @brief Walk a block, out NULL only counts the decompressed length.
+ */
+static size_t decode(const uint8_t * dictionary, size_t dictionaryLength, const uint8_t * in, const size_t inLength,
+                     uint8_t * out, const size_t outCapacity)
+{
+    size_t read = 0;
+    size_t produced = 0;
+    bool valid = in != NULL && inLength > 0;
+    bool done = false;
+
+    if(dictionaryLength > LZ_MAX_OFFSET)
+    {
+        dictionary += dictionaryLength - LZ_MAX_OFFSET;
+        dictionaryLength = LZ_MAX_OFFSET;
+    }
+    while(valid && !done)
+    {
+        const uint8_t token = in[read++];
+        size_t literals = token >> 4;
+        if(literals == LZ_RUN_MASK)
+        {
+            valid = getLength(in, inLength, &read, &literals);
+        }
+        if(valid && literals <= inLength - read && literals <= outCapacity - produced)
+        {
+            if(out != NULL)
+            {
+                memcpy(out + produced, in + read, literals);
+            }
+            read += literals;
+            produced += literals;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if(valid && read == inLength)
+        {
+            done = true; //literals only, the last sequence
+        }
+        else if(valid && inLength - read >= 2U)
+        {
+            const size_t offset = (size_t)in[read] | ((size_t)in[read + 1U] << 8);
+            size_t match = (token & LZ_RUN_MASK) + LZ_MIN_MATCH;
+            read += 2U;
+            if((token & LZ_RUN_MASK) == LZ_RUN_MASK)
+            {
+                valid = getLength(in, inLength, &read, &match);
+            }
+            valid = valid && read < inLength && offset > 0 && offset <= produced + dictionaryLength &&
+                    match <= outCapacity - produced;
+            if(valid && out != NULL)
+            {
+                if(offset <= produced && offset >= match)
+                {
+                    memcpy(out + produced, out + produced - offset, match);
+                }
+                else
+                {
+                    for(size_t i = 0; i < match; i++)
+                    {
+                        const size_t back = produced + i;
+                        out[back] = (offset > back) ? dictionary[dictionaryLength - (offset - back)] : out[back - offset];
+                    }
+                }
+            }
+            produced += match;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    return valid ? produced : 0;
+}
+
+size_t lzDecompressedLength(const uint8_t * in, const size_t inLength)
+{
+    return decode(NULL, LZ_MAX_OFFSET, in, inLength, NULL, SIZE_MAX); //any offset could reach into a dictionary
+}
+
+size_t lzDecompress(const uint8_t * dictionary, const size_t dictionaryLength, const uint8_t * in, const size_t inLength,
+                    uint8_t * out, const size_t outCapacity)
+{
+    return decode(dictionary, (dictionary != NULL) ? dictionaryLength : 0, in, inLength, out, outCapacity);
+}
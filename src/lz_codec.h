@@ -0,0 +1,93 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @file lz_codec.h
+ * @brief Small LZ77 block codec for MO/MT payloads, needs no heap and only a
+ * hash table on the stack while compressing.
+ *
+ * A block is a run of sequences. Each one starts with a token byte, the high
+ * nibble is the literal count and the low nibble the match length minus
+ * LZ_MIN_MATCH. A nibble of 15 is continued by bytes added to it, ending with
+ * the first byte below 255. The literals follow, then a 2 byte little endian
+ * offset back into the output and the match length continuation. The last
+ * sequence has literals only and ends the block.
+ *
+ * Both sides may share a dictionary, eg. a sample of typical telemetry,
+ * which matches can reach back into. Short messages gain the most from it.
+ */
+
+/**
+ * @def LZ_MIN_MATCH
+ * @brief Shortest match encoded, shorter repeats are sent as literals.
+ */
+#define LZ_MIN_MATCH 4U
+
+/**
+ * @def LZ_MAX_OFFSET
+ * @brief Furthest back a match can reach, dictionary bytes before that are never used.
+ */
+#define LZ_MAX_OFFSET 65535U
+
+/**
+ * @def LZ_HASH_BITS
+ * @brief log2 of the match finder's table size, 4 bytes per entry on the stack.
+ */
+#ifndef LZ_HASH_BITS
+    #ifdef ARDUINO
+        #define LZ_HASH_BITS 8U
+    #else
+        #define LZ_HASH_BITS 12U
+    #endif
+#endif
+
+/**
+ * @brief Compress a block.
+ *
+ * @param dictionary Bytes the decoder will also have, may be NULL if dictionaryLength is 0.
+ * @param dictionaryLength Length of the dictionary.
+ * @param in Data to compress.
+ * @param inLength Length of the data.
+ * @param out Where to put the block.
+ * @param outCapacity Size of out.
+ * @return Length of the block, 0 if it doesn't fit in outCapacity.
+ */
+size_t lzCompress(const uint8_t * dictionary, const size_t dictionaryLength, const uint8_t * in, const size_t inLength,
+                  uint8_t * out, const size_t outCapacity);
+
+/**
+ * @brief Find the decompressed length of a block without decoding it.
+ *
+ * @param in The block.
+ * @param inLength Length of the block.
+ * @return Decompressed length, 0 if the block is malformed.
+ */
+size_t lzDecompressedLength(const uint8_t * in, const size_t inLength);
+
+/**
+ * @brief Decompress a block.
+ *
+ * @param dictionary The dictionary it was compressed with, may be NULL if dictionaryLength is 0.
+ * @param dictionaryLength Length of the dictionary.
+ * @param in The block.
+ * @param inLength Length of the block.
+ * @param out Where to put the data.
+ * @param outCapacity Size of out.
+ * @return Decompressed length, 0 if the block is malformed or doesn't fit in outCapacity.
+ */
+size_t lzDecompress(const uint8_t * dictionary, const size_t dictionaryLength, const uint8_t * in, const size_t inLength,
+                    uint8_t * out, const size_t outCapacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,319 @@
+#if defined(__linux__) || defined(__APPLE__)
+#include "mo_journal.h"
+#include "crc16.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOURNAL_MAGIC "RBMOJRN1"
+#define JOURNAL_RECORD_MAGIC 0x4A4F4D52U //"RMOJ"
+#define JOURNAL_DATA_START 64U
+
+typedef struct
+{
+    char magic[8];
+    uint64_t checkpoint;        /**< Sequence << 32 | offset of the oldest record not retired */
+} journalHeader_t;
+
+typedef enum
+{
+    JOURNAL_RECORD_LIVE = 1,
+    JOURNAL_RECORD_RETIRED,
+    JOURNAL_RECORD_WRAP         /**< The ring carries on at JOURNAL_DATA_START */
+} journalRecordState_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t length;
+    uint16_t topic;
+    uint16_t crc;               /**< Over sequence, length, topic and the payload */
+    uint32_t state;             /**< journalRecordState_t, the only field changed after writing */
+    uint32_t reserved;
+} journalRecord_t;
+
+static journalRecord_t * recordAt(mo_journal_t * journal, const size_t offset)
+{
+    return (journalRecord_t *)(journal->map + offset);
+}
+
+static size_t recordSize(const size_t length)
+{
+    return (sizeof(journalRecord_t) + length + 7U) & ~(size_t)7U;
+}
+
+static uint16_t recordCrc(journalRecord_t * record)
+{
+    uint16_t crc = crc16Update(0, (const uint8_t *)&record->sequence,
+                               sizeof(record->sequence) + sizeof(record->length) + sizeof(record->topic));
+    return crc16Update(crc, (const uint8_t *)(record + 1), record->length);
+}
+
+static bool validRecord(mo_journal_t * journal, const size_t offset, const uint32_t sequence)
+{
+    bool valid = false;
+    if(offset + sizeof(journalRecord_t) <= journal->size)
+    {
+        journalRecord_t * record = recordAt(journal, offset);
+        if(record->magic == JOURNAL_RECORD_MAGIC && record->sequence == sequence)
+        {
+            if(record->state == JOURNAL_RECORD_WRAP)
+            {
+                valid = record->length == 0;
+            }
+            else if(record->state == JOURNAL_RECORD_LIVE || record->state == JOURNAL_RECORD_RETIRED)
+            {
+                valid = offset + recordSize(record->length) <= journal->size && recordCrc(record) == record->crc;
+            }
+        }
+    }
+    return valid;
+}
+
+static size_t skipWrap(mo_journal_t * journal, const size_t offset)
+{
+    size_t next = offset;
+    if(offset != journal->end && recordAt(journal, offset)->state == JOURNAL_RECORD_WRAP)
+    {
+        next = JOURNAL_DATA_START;
+    }
+    return next;
+}
+
+static void syncRange(mo_journal_t * journal, const size_t offset, const size_t length)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t start = offset & ~(page - 1U);
+    msync(journal->map + start, (offset + length) - start, MS_ASYNC);
+}
+
+static void checkpoint(mo_journal_t * journal)
+{
+    journalHeader_t * header = (journalHeader_t *)journal->map;
+    const uint32_t sequence = (journal->first == journal->end) ? journal->nextSequence : recordAt(journal, journal->first)->sequence;
+    __atomic_store_n(&header->checkpoint, ((uint64_t)sequence << 32) | (uint64_t)journal->first, __ATOMIC_RELEASE);
+    syncRange(journal, 0, sizeof(journalHeader_t));
+}
+
+static void advanceFirst(mo_journal_t * journal)
+{
+    if(journal->live == 0)
+    {
+        journal->first = JOURNAL_DATA_START; //empty, start again at the front
+        journal->cursor = JOURNAL_DATA_START;
+        journal->end = JOURNAL_DATA_START;
+    }
+    else
+    {
+        while(journal->first != journal->end)
+        {
+            journal->first = skipWrap(journal, journal->first);
+            if(journal->first == journal->end || recordAt(journal, journal->first)->state != JOURNAL_RECORD_RETIRED)
+            {
+                break;
+            }
+            journal->first += recordSize(recordAt(journal, journal->first)->length);
+        }
+    }
+    checkpoint(journal);
+}
+
+bool moJournalOpen(mo_journal_t * journal, const char * path, const size_t size)
+{
+    bool opened = false;
+    struct stat info;
+    journal->map = NULL;
+    journal->fd = open(path, O_RDWR | O_CREAT, 0600);
+    if(journal->fd >= 0 && fstat(journal->fd, &info) == 0)
+    {
+        journal->size = (size > JOURNAL_DATA_START) ? size : JOURNAL_DATA_START * 2U;
+        if((size_t)info.st_size > journal->size)
+        {
+            journal->size = (size_t)info.st_size; //never shrink, records may sit past size
+        }
+        if(journal->size <= UINT32_MAX && //offsets are checkpointed in 32 bits
+           ((size_t)info.st_size == journal->size || ftruncate(journal->fd, (off_t)journal->size) == 0))
+        {
+            void * map = mmap(NULL, journal->size, PROT_READ | PROT_WRITE, MAP_SHARED, journal->fd, 0);
+            if(map != MAP_FAILED)
+            {
+                journal->map = (uint8_t *)map;
+                opened = true;
+            }
+        }
+    }
+
+    if(opened)
+    {
+        journalHeader_t * header = (journalHeader_t *)journal->map;
+        if(memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0)
+        {
+            memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+            header->checkpoint = ((uint64_t)1U << 32) | JOURNAL_DATA_START;
+        }
+        const uint64_t saved = __atomic_load_n(&header->checkpoint, __ATOMIC_ACQUIRE);
+        uint32_t sequence = (uint32_t)(saved >> 32);
+        size_t offset = (size_t)(saved & 0xFFFFFFFFU);
+        if(offset < JOURNAL_DATA_START || offset >= journal->size)
+        {
+            offset = JOURNAL_DATA_START;
+        }
+
+        journal->first = offset;
+        journal->live = 0;
+        for(size_t walked = 0; walked < journal->size && validRecord(journal, offset, sequence);)
+        {
+            journalRecord_t * record = recordAt(journal, offset);
+            if(record->state == JOURNAL_RECORD_WRAP)
+            {
+                walked += sizeof(journalRecord_t);
+                offset = JOURNAL_DATA_START;
+            }
+            else
+            {
+                if(record->state == JOURNAL_RECORD_LIVE)
+                {
+                    journal->live++;
+                }
+                walked += recordSize(record->length);
+                offset += recordSize(record->length);
+                sequence++;
+            }
+        }
+        journal->end = offset; //anything after is torn or from an older lap
+        journal->nextSequence = sequence;
+        advanceFirst(journal);
+        journal->cursor = journal->first;
+    }
+    else if(journal->fd >= 0)
+    {
+        close(journal->fd);
+    }
+    return opened;
+}
+
+void moJournalClose(mo_journal_t * journal)
+{
+    if(journal->map != NULL)
+    {
+        msync(journal->map, journal->size, MS_SYNC);
+        munmap(journal->map, journal->size);
+        close(journal->fd);
+        memset(journal, 0, sizeof(mo_journal_t));
+    }
+}
+
+const char * moJournalAppend(mo_journal_t * journal, const uint16_t topic, const char * data, const size_t length)
+{
+    char * payload = NULL;
+    const size_t need = recordSize(length);
+    size_t offset = 0;
+
+    if(journal->map != NULL && length <= UINT32_MAX)
+    {
+        if(journal->first <= journal->end) //not wrapped, leave room for a wrap marker
+        {
+            if(journal->end + need + sizeof(journalRecord_t) <= journal->size)
+            {
+                offset = journal->end;
+            }
+            else if(JOURNAL_DATA_START + need < journal->first)
+            {
+                journalRecord_t * wrap = recordAt(journal, journal->end);
+                wrap->sequence = journal->nextSequence;
+                wrap->length = 0;
+                wrap->topic = 0;
+                wrap->crc = recordCrc(wrap);
+                wrap->state = JOURNAL_RECORD_WRAP;
+                wrap->reserved = 0;
+                wrap->magic = JOURNAL_RECORD_MAGIC;
+                syncRange(journal, journal->end, sizeof(journalRecord_t));
+                offset = JOURNAL_DATA_START;
+            }
+        }
+        else if(journal->end + need < journal->first) //never catch up with first, end == first means empty
+        {
+            offset = journal->end;
+        }
+    }
+
+    if(offset != 0)
+    {
+        journalRecord_t * record = recordAt(journal, offset);
+        payload = (char *)(record + 1);
+        memcpy(payload, data, length);
+        record->sequence = journal->nextSequence;
+        record->length = (uint32_t)length;
+        record->topic = topic;
+        record->crc = recordCrc(record);
+        record->state = JOURNAL_RECORD_LIVE;
+        record->reserved = 0;
+        record->magic = JOURNAL_RECORD_MAGIC; //last, a torn record is never valid
+        syncRange(journal, offset, need);
+        journal->end = offset + need;
+        journal->nextSequence++;
+        journal->live++;
+    }
+    return payload;
+}
+
+bool moJournalPeek(mo_journal_t * journal, uint16_t * topic, const char ** data, size_t * length)
+{
+    bool found = false;
+    if(journal->map != NULL)
+    {
+        while(journal->cursor != journal->end && !found)
+        {
+            journal->cursor = skipWrap(journal, journal->cursor);
+            if(journal->cursor != journal->end)
+            {
+                journalRecord_t * record = recordAt(journal, journal->cursor);
+                if(record->state == JOURNAL_RECORD_LIVE)
+                {
+                    *topic = record->topic;
+                    *data = (const char *)(record + 1);
+                    *length = record->length;
+                    found = true;
+                }
+                else
+                {
+                    journal->cursor += recordSize(record->length); //retired before a restart
+                }
+            }
+        }
+    }
+    return found;
+}
+
+void moJournalAdvance(mo_journal_t * journal)
+{
+    if(journal->map != NULL && journal->cursor != journal->end)
+    {
+        journal->cursor += recordSize(recordAt(journal, journal->cursor)->length);
+    }
+}
+
+bool moJournalRetire(mo_journal_t * journal, const char * data)
+{
+    bool retired = false;
+    const uint8_t * payload = (const uint8_t *)data;
+    if(journal->map != NULL && payload >= journal->map + JOURNAL_DATA_START + sizeof(journalRecord_t) &&
+       payload < journal->map + journal->size)
+    {
+        journalRecord_t * record = (journalRecord_t *)(payload - sizeof(journalRecord_t));
+        if(record->magic == JOURNAL_RECORD_MAGIC && record->state == JOURNAL_RECORD_LIVE)
+        {
+            record->state = JOURNAL_RECORD_RETIRED;
+            syncRange(journal, (size_t)((uint8_t *)record - journal->map), sizeof(journalRecord_t));
+            journal->live--;
+            advanceFirst(journal);
+            retired = true;
+        }
+    }
+    return retired;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef MO_JOURNAL_H
+#define MO_JOURNAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @struct mo_journal_t
+ * @brief Append-only ring of MO records in a memory mapped file.
+ *
+ * Every record carries a sequence number and a CRC over its header and
+ * payload. The file header holds a checkpoint, the offset and sequence of
+ * the oldest record not yet retired, written with a single 64 bit store so
+ * a crash leaves either the old or the new one. Reopening walks the ring
+ * from the checkpoint and stops at the first record that is torn or older
+ * than expected, everything before that is replayed.
+ *
+ * The file is mapped once at its full size, so payload pointers handed out
+ * stay valid until the journal is closed.
+ */
+typedef struct
+{
+    uint8_t * map;              /**< Mapping of the whole file, NULL when closed */
+    size_t size;                /**< Mapped length in bytes */
+    int fd;                     /**< Open file descriptor */
+    size_t first;               /**< Offset of the oldest record not retired */
+    size_t cursor;              /**< Offset of the next record to hand out */
+    size_t end;                 /**< Offset the next record is written at */
+    uint32_t nextSequence;      /**< Sequence number of the next record */
+    size_t live;                /**< Records written and not yet retired */
+} mo_journal_t;
+
+/**
+ * @brief Open (or create) a journal and find the records left in it.
+ *
+ * A file smaller than size is grown, a larger one is used at its own size.
+ *
+ * @param journal Pointer to a closed journal.
+ * @param path File backing the journal.
+ * @param size Minimum file size in bytes.
+ * @return false if the file can't be opened or mapped.
+ */
+bool moJournalOpen(mo_journal_t * journal, const char * path, const size_t size);
+
+/**
+ * @brief Flush and unmap the journal, records not retired stay in the file.
+ *
+ * @param journal Pointer to the journal, closing a closed journal does nothing.
+ */
+void moJournalClose(mo_journal_t * journal);
+
+/**
+ * @brief Write a record for an MO.
+ *
+ * @param journal Pointer to an open journal.
+ * @param topic Topic of the MO.
+ * @param data Payload to copy into the journal.
+ * @param length Length of the payload.
+ * @return Pointer to the payload inside the journal, NULL if it is closed or full.
+ */
+const char * moJournalAppend(mo_journal_t * journal, const uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Look at the next record that hasn't been handed out.
+ *
+ * @param journal Pointer to the journal.
+ * @param topic Set to the record's topic.
+ * @param data Set to the payload inside the journal.
+ * @param length Set to the payload length.
+ * @return false if every record has been handed out.
+ */
+bool moJournalPeek(mo_journal_t * journal, uint16_t * topic, const char ** data, size_t * length);
+
+/**
+ * @brief Mark the record returned by moJournalPeek() as handed out.
+ *
+ * @param journal Pointer to the journal.
+ */
+void moJournalAdvance(mo_journal_t * journal);
+
+/**
+ * @brief Retire a record, it won't be replayed when the journal is reopened.
+ *
+ * @param journal Pointer to the journal.
+ * @param data Payload pointer returned by moJournalAppend() or moJournalPeek().
+ * @return false if data isn't a live record of this journal.
+ */
+bool moJournalRetire(mo_journal_t * journal, const char * data);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,7 +1,10 @@
 #include "rockblock_9704.h"
+#include "rockblock_9704_device.h"
 #include "jspr_command.h"
 #include "serial.h"
 #include "imt_queue.h"
+#include "crc16.h"
+#include "lz_codec.h"
 
 #include "third_party/cJSON/cJSON.h"
 #include "third_party/base64/base64.h"
@@ -19,47 +22,665 @@
 
 #define IMT_MIN_TOPIC_ID 64U
 #define IMT_MAX_TOPIC_ID 65535U
-#define FIRMWARE_VERSION_STRING_LEN 13U
+#define RB_MT_WAIT_SLICE_MS 1000U
+#define RB_IO_THREAD_IDLE_MS 1000U
+#define RB_BAUD_PROBE_SETTLE_MS 20U
+#define RB_BATCH_MAX_SIZE ((IMT_PAYLOAD_SIZE) - IMT_CRC_SIZE - 1U) //leaves room for a codec header
+
+/**
+ * @brief Calculate the CRC of a queued MO, it is sent after the payload.
+ *
+ * @param imtMo Pointer to the queued message.
+ * @return true on success, false on failure.
+ */
+static bool appendCrc(imt_t * imtMo);
+
+/**
+ * @brief Finish the CRC of a completed MT and compare it with the IMT CRC it carries.
+ *
+ * Segments that arrived in order were folded in as they were decoded, only the
+ * rest of the message is read here.
+ *
+ * @param imtMt Pointer to the completed message, length must be set.
+ * @return true if the message is intact.
+ */
+static bool verifyMtCrc(imt_t * imtMt);
+
+/**
+ * @brief Answer a messageOriginateSegment request, the segment is base64 encoded
+ * straight into the JSPR command buffer.
+ * 
+ * The payload is read in place, so borrowed buffers are never copied.
+ *
+ * @param device Pointer to the device.
+ * @param imtMo Pointer to the queued message.
+ * @param segmentStart Offset of the segment within payload and CRC.
+ * @param segmentLength Length of the segment in bytes.
+ * @return true if the segment was written to the modem.
+ */
+static bool sendMoSegment(rbDevice_t * device, const imt_t * imtMo, const size_t segmentStart, const size_t segmentLength);
+
+/**
+ * @brief Handlers for the targets rbDevicePoll() processes, one per target,
+ * each checks the result code of device->response itself.
+ *
+ * @param device Pointer to the device holding the framed line.
+ */
+static void handleMessageOriginate(rbDevice_t * device);
+static void handleMessageOriginateSegment(rbDevice_t * device);
+static void handleMessageOriginateStatus(rbDevice_t * device);
+static void handleMessageTerminate(rbDevice_t * device);
+static void handleMessageTerminateSegment(rbDevice_t * device);
+static void handleMessageTerminateStatus(rbDevice_t * device);
+static void handleConstellationState(rbDevice_t * device);
+
+/**
+ * @brief Pass a line for any other target to the application handler registered for it.
+ *
+ * @param device Pointer to the device holding the framed line.
+ */
+static void handleOtherTarget(rbDevice_t * device);
+
+/**
+ * @brief Send the modem a request to queue a message, the reply is picked up by rbPoll().
+ *
+ * @param device Pointer to the device.
+ * @param index Position of the message in the MO queue, it becomes the last one in flight.
+ * @return true if request was sent successfully, false otherwise.
+ */
+static bool requestMo(rbDevice_t * device, const uint16_t index);
+
+/**
+ * @brief Offer queued messages to the modem until RB_MO_IN_FLIGHT are in flight,
+ * messages that can't be offered are dropped.
+ *
+ * @param device Pointer to the device.
+ */
+static void pumpMo(rbDevice_t * device);
+
+/**
+ * @brief Queue the MO of a blocking send, framed as a batch of one when the topic is batched.
+ *
+ * @param device Pointer to the device.
+ * @param topic Topic ID.
+ * @param data Payload, copied into the MO queue.
+ * @param length Length of the payload.
+ * @return true if the MO was queued at the tail.
+ */
+static bool queueBlockingMo(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Report the outcome of an MO in flight, remove it and offer the next one.
+ *
+ * @param device Pointer to the device.
+ * @param index Position of the message in the MO queue.
+ * @param status Outcome handed to moMessageComplete, or to the blocking send waiting on it.
+ */
+static void finishMo(rbDevice_t * device, const uint16_t index, const rbMsgStatus_t status);
+
+/**
+ * @brief Hand an event to the callbacks registered for the device, plain and device aware.
+ *
+ * @param device Pointer to the device.
+ * @return reportMt() returns true if a callback took the MT.
+ */
+static void reportMo(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status);
+static bool reportMt(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status);
+static void reportProvisioning(rbDevice_t * device, const jsprMessageProvisioning_t * messageProvisioning);
+static void reportConstellation(rbDevice_t * device, const jsprConstellationState_t * state);
+#ifdef RB_IO_THREAD
+static void reportSubmitFailed(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length);
+#endif
+
+/**
+ * @brief Handle one line from the modem, what rbDevicePoll() does apart from
+ * flushing batches. Used while a blocking send or receive waits.
+ *
+ * @param device Pointer to the device.
+ */
+static void pollDevice(rbDevice_t * device);
+
+#ifdef RB_IO_THREAD
+/**
+ * @brief Hand a completed MT over to the application when the I/O thread is running.
+ *
+ * @param device Pointer to the device.
+ * @param imtMt Pointer to the completed message in the MT queue.
+ */
+static void deliverMt(rbDevice_t * device, imt_t * imtMt);
+
+/**
+ * @brief Free a submission copy, or hand a borrowed buffer back if it never reached the MO queue.
+ *
+ * @param submission Pointer to the submission taken off the queue.
+ * @param queued true if the MO queue took the message over.
+ */
+static void discardSubmission(rbIoSubmission_t * submission, bool queued);
+
+/**
+ * @brief Remove the MT the application released, the oldest one delivered.
+ *
+ * @param device Pointer to the device.
+ */
+static void releaseMt(rbDevice_t * device);
+
+/**
+ * @brief Free the MT hand-over rings sized when the I/O thread started.
+ *
+ * @param device Pointer to the device.
+ */
+static void freeIoSlots(rbDevice_t * device);
+#endif
+
+#ifdef RB_MO_JOURNAL
+/**
+ * @brief Move MOs waiting in the journal into the MO queue while it has room.
+ *
+ * @param device Pointer to the device.
+ */
+static void feedJournal(rbDevice_t * device);
+
+/**
+ * @brief Release callback of MOs borrowed from the journal, retires their record.
+ *
+ * @param data Payload inside the journal.
+ * @param context Pointer to the device.
+ */
+static void retireJournalMo(const char * data, void * context);
+#endif
 
 #ifndef SERIAL_CONTEXT_SETUP_FUNC
     #error A serial context function is needed
 #endif
 
-extern int messageReference;
-extern serialContext context;
-extern enum serialState serialState;
+static rbDevice_t defaultDevice;
+static bool defaultDeviceInitialised = false;
+
+void rbDeviceInit(rbDevice_t * device)
+{
+    memset(device, 0, sizeof(rbDevice_t));
+    serialInitContext(&device->context);
+    jsprInit(&device->jspr, &device->context);
+    clearResponse(&device->response);
+    imtQueueLock(&device->imtMo, true); //MO queue is locked by default, queues are built by rbDeviceBegin()
+}
+
+bool setupQueues(rbDevice_t * device)
+{
+    bool built;
+    imt_allocator_t allocator;
+    uint16_t moDepth = (device->config.moQueueSize > 0) ? device->config.moQueueSize : IMT_QUEUE_SIZE;
+    uint16_t mtDepth = (device->config.mtQueueSize > 0) ? device->config.mtQueueSize : IMT_QUEUE_SIZE;
+
+    if(device->config.allocator.alloc != NULL && device->config.allocator.free != NULL)
+    {
+        allocator.alloc = device->config.allocator.alloc;
+        allocator.free = device->config.allocator.free;
+        allocator.context = device->config.allocator.context;
+    }
+    else
+    {
+        allocator.alloc = imtPoolAlloc;
+        allocator.free = imtPoolFree;
+        allocator.context = &device->pool;
+    }
+#ifdef RB_MO_JOURNAL
+    moJournalClose(&device->moJournal); //closed first, MOs cleared from the queue stay in the file
+#endif
+
+    if(device->imtMo.maxLength == moDepth && device->imtMo.allocator.alloc == allocator.alloc &&
+       device->imtMo.allocator.context == allocator.context)
+    {
+        imtQueueInit(&device->imtMo); //same shape, just clean
+    }
+    else
+    {
+        imtQueueCreate(&device->imtMo, moDepth, &allocator);
+    }
+    if(device->imtMt.maxLength == mtDepth && device->imtMt.allocator.alloc == allocator.alloc &&
+       device->imtMt.allocator.context == allocator.context)
+    {
+        imtQueueInit(&device->imtMt);
+    }
+    else
+    {
+        imtQueueCreate(&device->imtMt, mtDepth, &allocator);
+    }
+    imtQueueSecureWipe(&device->imtMo, device->config.secureWipe || IMT_SECURE_WIPE_DEFAULT);
+    imtQueueSecureWipe(&device->imtMt, device->config.secureWipe || IMT_SECURE_WIPE_DEFAULT);
+    device->moQueuedMessages = 0;
+    device->moInFlight = 0;
+    built = device->imtMo.maxLength == moDepth && device->imtMt.maxLength == mtDepth;
+#ifdef RB_MO_JOURNAL
+    if(built && device->config.moJournalPath != NULL)
+    {
+        built = moJournalOpen(&device->moJournal, device->config.moJournalPath,
+                              (device->config.moJournalSize > 0) ? device->config.moJournalSize : RB_MO_JOURNAL_SIZE);
+        if(built)
+        {
+            feedJournal(device); //replay what was left unsent
+        }
+    }
+#endif
+    return built;
+}
+
+bool rbDeviceSetConfig(rbDevice_t * device, const rbConfig_t * config)
+{
+    bool set = false;
+    if(config == NULL)
+    {
+        memset(&device->config, 0, sizeof(rbConfig_t));
+        set = true;
+    }
+    else if((config->allocator.alloc == NULL) == (config->allocator.free == NULL)) //both hooks or neither
+    {
+        device->config = *config;
+        set = true;
+    }
+    return set;
+}
+
+rbDevice_t * rbDeviceCreate(void)
+{
+    rbDevice_t * device = (rbDevice_t *)malloc(sizeof(rbDevice_t));
+    if(device != NULL)
+    {
+        rbDeviceInit(device);
+    }
+    return device;
+}
+
+void rbDeviceDestroy(rbDevice_t * device)
+{
+    if(device != NULL)
+    {
+#ifdef RB_IO_THREAD
+        rbDeviceStopIoThread(device);
+#endif
+        if(device->context.serialState == OPEN)
+        {
+            rbDeviceEnd(device);
+        }
+#ifdef RB_MO_JOURNAL
+        moJournalClose(&device->moJournal);
+#endif
+        if(device->context.serialRelease != NULL)
+        {
+            device->context.serialRelease(&device->context);
+        }
+        for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES; i++)
+        {
+            free(device->topicBatches[i].buffer); //records never flushed are lost
+        }
+        imtQueueDestroy(&device->imtMo);
+        imtQueueDestroy(&device->imtMt);
+        imtPoolDrain(&device->pool);
+        if(device == &defaultDevice)
+        {
+            defaultDeviceInitialised = false;
+        }
+        else
+        {
+            free(device);
+        }
+    }
+}
+
+rbDevice_t * rbDefaultDevice(void)
+{
+    if(!defaultDeviceInitialised)
+    {
+        rbDeviceInit(&defaultDevice);
+        defaultDeviceInitialised = true;
+    }
+    return &defaultDevice;
+}
+
+static bool removeMoAt(rbDevice_t * device, const uint16_t index)
+{
+    bool removed = imtQueueRemoveAt(&device->imtMo, index);
+    if(removed)
+    {
+        if(device->moQueuedMessages > 0)
+        {
+            device->moQueuedMessages--;
+        }
+        if(index < device->moInFlight)
+        {
+            device->moInFlight--;
+        }
+    }
+    return removed;
+}
+
+static uint16_t moInFlightLimit(rbDevice_t * device)
+{
+    uint16_t limit = (device->config.moInFlight > 0) ? device->config.moInFlight : RB_MO_IN_FLIGHT;
+    if(limit > device->imtMo.maxLength)
+    {
+        limit = device->imtMo.maxLength;
+    }
+    return limit;
+}
+
+static int findMo(rbDevice_t * device, const uint8_t id)
+{
+    int index = -1;
+    for(uint16_t i = 0; i < device->moInFlight && index < 0; i++)
+    {
+        imt_t * imtMo = imtQueueGetAt(&device->imtMo, i);
+        if(imtMo->idSet && imtMo->id == id)
+        {
+            index = (int)i;
+        }
+    }
+    return index;
+}
+
+static int findMt(rbDevice_t * device, const uint16_t id)
+{
+    int index = -1;
+    for(uint16_t i = 0; i < device->imtMt.count && index < 0; i++)
+    {
+        imt_t * imtMt = imtQueueGetAt(&device->imtMt, i);
+        if(imtMt->readyToProcess && !imtMt->ready && imtMt->id == id)
+        {
+            index = (int)i;
+        }
+    }
+    return index;
+}
+
+static int firstReadyMt(rbDevice_t * device, const bool unread)
+{
+    int index = -1;
+    for(uint16_t i = 0; i < device->imtMt.count && index < 0; i++)
+    {
+        imt_t * imtMt = imtQueueGetAt(&device->imtMt, i);
+        if(imtMt->ready && (!unread || imtMt->readyToProcess))
+        {
+            index = (int)i;
+        }
+    }
+    return index;
+}
+
+static void failMt(rbDevice_t * device, const uint16_t index, const rbMsgStatus_t status)
+{
+    imt_t * imtMt = imtQueueGetAt(&device->imtMt, index);
+    if(!reportMt(device, imtMt->id, status))
+    {
+        device->mtDropped = true;
+    }
+    imtQueueRemoveAt(&device->imtMt, index); //never handed out, free the slot
+}
+
+static uint8_t topicPriority(rbDevice_t * device, const uint16_t topic)
+{
+    uint8_t priority = (uint8_t)LOW_PRIORITY; //unprovisioned topics never overtake provisioned ones
+    if(device->messageProvisioningInfo.provisioningSet)
+    {
+        for(int i = 0; i < device->messageProvisioningInfo.topicCount; i++)
+        {
+            if(device->messageProvisioningInfo.provisioning[i].topicId == topic)
+            {
+                priority = (uint8_t)device->messageProvisioningInfo.provisioning[i].priority;
+                break;
+            }
+        }
+    }
+    return priority;
+}
+
+static bool journalledMo(const imt_t * imtMo)
+{
+#ifdef RB_MO_JOURNAL
+    return imtMo->release == retireJournalMo;
+#else
+    (void)imtMo;
+    return false;
+#endif
+}
+
+static bool makeRoomForMo(rbDevice_t * device, const uint8_t priority)
+{
+    bool room = true;
+    if(device->imtMo.count >= device->imtMo.maxLength && !device->imtMo.locked)
+    {
+        int index = -1;
+        for(uint16_t i = device->moInFlight; i < device->imtMo.count; i++) //only MOs the modem hasn't been offered
+        {
+            imt_t * imtMo = imtQueueGetAt(&device->imtMo, i);
+            if(!journalledMo(imtMo) && (index < 0 || (device->config.moEviction == RB_MO_EVICT_LOWEST_PRIORITY &&
+               imtMo->priority > imtQueueGetAt(&device->imtMo, (uint16_t)index)->priority)))
+            {
+                index = (int)i;
+            }
+        }
+        if(index < 0)
+        {
+            room = false; //every entry is with the modem or kept by the journal
+        }
+        else if(device->config.moEviction == RB_MO_EVICT_OLDEST || 
+                imtQueueGetAt(&device->imtMo, (uint16_t)index)->priority >= priority)
+        {
+            removeMoAt(device, (uint16_t)index);
+        }
+        else
+        {
+            room = false; //everything waiting is more urgent than the new MO
+        }
+    }
+    return room;
+}
+
+static size_t lzCodecCompress(const rbCodec_t * codec, const uint8_t * in, size_t inLength, uint8_t * out, size_t outCapacity)
+{
+    return lzCompress(codec->dictionary, codec->dictionaryLength, in, inLength, out, outCapacity);
+}
+
+static size_t lzCodecDecompressedLength(const rbCodec_t * codec, const uint8_t * in, size_t inLength)
+{
+    (void)codec;
+    return lzDecompressedLength(in, inLength);
+}
+
+static size_t lzCodecDecompress(const rbCodec_t * codec, const uint8_t * in, size_t inLength, uint8_t * out, size_t outCapacity)
+{
+    return lzDecompress(codec->dictionary, codec->dictionaryLength, in, inLength, out, outCapacity);
+}
+
+const rbCodec_t rbCodecLz = { RB_CODEC_LZ, lzCodecCompress, lzCodecDecompressedLength, lzCodecDecompress, NULL, 0, NULL };
+
+static const rbCodec_t * topicCodec(rbDevice_t * device, const uint16_t topic)
+{
+    const rbCodec_t * codec = NULL;
+    for(size_t i = 0; i < RB_MAX_TOPIC_CODECS && codec == NULL; i++)
+    {
+        if(device->topicCodecs[i].codec != NULL && device->topicCodecs[i].topic == topic)
+        {
+            codec = device->topicCodecs[i].codec;
+        }
+    }
+    return codec;
+}
 
-static uint8_t base64Buffer [BASE64_TEMP_BUFFER];
-static uint8_t crcBuffer [IMT_CRC_SIZE];
+static size_t encodeMo(const rbCodec_t * codec, const char * data, const size_t length, uint8_t * out)
+{
+    size_t encoded;
+    const size_t compressed = (length > 1U) ? codec->compress(codec, (const uint8_t *)data, length, out + 1, length - 1U) : 0;
+    if(compressed > 0)
+    {
+        out[0] = codec->id;
+        encoded = compressed + 1U;
+    }
+    else
+    {
+        out[0] = RB_CODEC_STORED; //didn't get smaller, out holds length + 1 bytes
+        memcpy(out + 1, data, length);
+        encoded = length + 1U;
+    }
+    return encoded;
+}
 
-static char firmwareVersion [FIRMWARE_VERSION_STRING_LEN];
+static bool queueMo(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length)
+{
+    bool queued = false;
+    const rbCodec_t * codec = topicCodec(device, topic);
+    if(makeRoomForMo(device, topicPriority(device, topic)))
+    {
+        if(codec == NULL)
+        {
+            queued = imtQueueMoAdd(&device->imtMo, topic, data, length);
+        }
+        else if(length < IMT_PAYLOAD_SIZE - IMT_CRC_SIZE) //room for the header
+        {
+            imt_t * imtMo = imtQueueMoReserve(&device->imtMo, topic, length + 1U);
+            if(imtMo != NULL)
+            {
+                imtMo->used = encodeMo(codec, data, length, imtMo->buffer);
+                imtMo->length = imtMo->used;
+                queued = true;
+            }
+        }
+    }
+    return queued;
+}
 
-jsprHwInfo_t hwInfo;
-jsprSimStatus_t simStatus;
-jsprFirmwareInfo_t firmwareInfo;
-jsprMessageProvisioning_t messageProvisioningInfo;
-static jsprResponse_t response;
+static bool decodeMt(rbDevice_t * device, imt_t * imtMt)
+{
+    bool decoded = true;
+    const rbCodec_t * codec = topicCodec(device, imtMt->topic);
+    const size_t length = imtMt->length - IMT_CRC_SIZE; //CRC already checked, length > IMT_CRC_SIZE
 
-uint32_t messageLengthAsync = 0;
-uint16_t moQueuedMessages = 0;
-bool Receivelock = false;
-bool moDropped = false;
-bool moSent = false;
-bool mtDropped = false;
-bool mtReceived = false;
+    if(codec != NULL && imtMt->buffer[0] == RB_CODEC_STORED)
+    {
+        memmove(imtMt->buffer, imtMt->buffer + 1, length - 1U + IMT_CRC_SIZE);
+        imtMt->length -= 1U;
+    }
+    else if(codec != NULL)
+    {
+        const size_t size = (imtMt->buffer[0] == codec->id) ? codec->decompressedLength(codec, imtMt->buffer + 1, length - 1U) : 0;
+        uint8_t * buffer = NULL;
+        decoded = false;
+        if(size > 0 && size <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+        {
+            buffer = (uint8_t *)device->imtMt.allocator.alloc(size + IMT_CRC_SIZE, device->imtMt.allocator.context);
+        }
+        if(buffer != NULL)
+        {
+            decoded = codec->decompress(codec, imtMt->buffer + 1, length - 1U, buffer, size) == size;
+            if(decoded)
+            {
+                memset(buffer + size, 0, IMT_CRC_SIZE);
+                imtQueueSetBuffer(&device->imtMt, imtMt, buffer, size + IMT_CRC_SIZE, size + IMT_CRC_SIZE);
+                imtMt->length = size + IMT_CRC_SIZE;
+            }
+            else
+            {
+                device->imtMt.allocator.free(buffer, size + IMT_CRC_SIZE, device->imtMt.allocator.context);
+            }
+        }
+    }
+    return decoded;
+}
 
-static const rbCallbacks_t *rbCallbacks = NULL;
+static uint16_t placeMo(rbDevice_t * device)
+{
+    uint16_t index = device->imtMo.count - 1U;
+    imt_t * imtMo = imtQueueGetAt(&device->imtMo, index);
+    imtMo->priority = topicPriority(device, imtMo->topic);
+    while(index > device->moInFlight && imtQueueGetAt(&device->imtMo, index - 1U)->priority > imtMo->priority)
+    {
+        index--; //ahead of less urgent MOs, behind older ones of the same priority
+    }
+    imtQueueMove(&device->imtMo, device->imtMo.count - 1U, index);
+    return index;
+}
 
-void rbRegisterCallbacks(const rbCallbacks_t *callbacks) 
+void rbDeviceRegisterCallbacks(rbDevice_t * device, const rbCallbacks_t *callbacks) 
 {
     if (callbacks) 
     {
-        rbCallbacks = callbacks;
+        device->callbacks = callbacks;
+    }
+}
+
+void rbDeviceRegisterDeviceCallbacks(rbDevice_t * device, const rbDeviceCallbacks_t *callbacks, void * context)
+{
+    device->deviceCallbacks = callbacks;
+    device->callbacksContext = context;
+}
+
+static void reportMo(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status)
+{
+    if(device->callbacks && device->callbacks->moMessageComplete)
+    {
+        device->callbacks->moMessageComplete(id, status);
+    }
+    if(device->deviceCallbacks && device->deviceCallbacks->moMessageComplete)
+    {
+        device->deviceCallbacks->moMessageComplete(device, id, status, device->callbacksContext);
+    }
+}
+
+static bool reportMt(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status)
+{
+    bool reported = false;
+    if(device->callbacks && device->callbacks->mtMessageComplete)
+    {
+        device->callbacks->mtMessageComplete(id, status);
+        reported = true;
+    }
+    if(device->deviceCallbacks && device->deviceCallbacks->mtMessageComplete)
+    {
+        device->deviceCallbacks->mtMessageComplete(device, id, status, device->callbacksContext);
+        reported = true;
+    }
+    return reported;
+}
+
+static void reportProvisioning(rbDevice_t * device, const jsprMessageProvisioning_t * messageProvisioning)
+{
+    if(device->callbacks && device->callbacks->messageProvisioning)
+    {
+        device->callbacks->messageProvisioning(messageProvisioning);
+    }
+    if(device->deviceCallbacks && device->deviceCallbacks->messageProvisioning)
+    {
+        device->deviceCallbacks->messageProvisioning(device, messageProvisioning, device->callbacksContext);
+    }
+}
+
+static void reportConstellation(rbDevice_t * device, const jsprConstellationState_t * state)
+{
+    if(device->callbacks && device->callbacks->constellationState)
+    {
+        device->callbacks->constellationState(state);
+    }
+    if(device->deviceCallbacks && device->deviceCallbacks->constellationState)
+    {
+        device->deviceCallbacks->constellationState(device, state, device->callbacksContext);
+    }
+}
+
+#ifdef RB_IO_THREAD
+static void reportSubmitFailed(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length)
+{
+    if(device->callbacks && device->callbacks->moSubmitFailed)
+    {
+        device->callbacks->moSubmitFailed(topic, data, length);
+    }
+    if(device->deviceCallbacks && device->deviceCallbacks->moSubmitFailed)
+    {
+        device->deviceCallbacks->moSubmitFailed(device, topic, data, length, device->callbacksContext);
     }
 }
+#endif
 
 #ifdef RB_GPIO
-bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout)
+bool rbDeviceBeginGpio(rbDevice_t * device, char * port, const rbGpioTable_t * gpioInfo, const int timeout)
 {
     bool enabled = false;
     if (gpioDriveLow(gpioInfo->powerEnable.chip, gpioInfo->powerEnable.pin))
@@ -69,7 +690,7 @@ bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout)
             if (gpioListenIridBooted(gpioInfo->booted.chip, gpioInfo->booted.pin, timeout))
             {
                 sleep(1);
-                if (rbBegin(port))
+                if (rbDeviceBegin(device, port))
                 {
                     enabled = true;
                 }
@@ -79,14 +700,14 @@ bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout)
     return enabled;
 }
 
-bool rbEndGpio(const rbGpioTable_t * gpioInfo)
+bool rbDeviceEndGpio(rbDevice_t * device, const rbGpioTable_t * gpioInfo)
 {
     bool disabled = false;
     if (gpioDriveHigh(gpioInfo->powerEnable.chip, gpioInfo->powerEnable.pin))
     {
         if (gpioDriveLow(gpioInfo->iridiumEnable.chip, gpioInfo->iridiumEnable.pin))
         {
-            if (rbEnd())
+            if (rbDeviceEnd(device))
             {
                 disabled = true;
             }
@@ -96,61 +717,25 @@ bool rbEndGpio(const rbGpioTable_t * gpioInfo)
 }
 #endif
 
-static const uint16_t CRC16Table[256] =
-{
-  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-  0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-  0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
-  0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
-  0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
-  0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
-  0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
-  0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
-  0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-  0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
-  0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
-  0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
-  0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
-  0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
-  0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
-  0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
-  0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
-  0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-  0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
-  0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
-  0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
-  0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-  0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
-  0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
-  0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
-  0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
-  0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-  0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
-  0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
-  0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
-  0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
-  0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
-};
-
-void clearLeftoverData(void)
+void clearLeftoverData(rbDevice_t * device)
 {
 char garbageData[32];
 int available;
 
-    if(context.serialRead != NULL && context.serialPeek != NULL)
+    if(device->context.serialRead != NULL && device->context.serialPeek != NULL)
     {
-        while((available = context.serialPeek()) > 0)
+        while((available = device->context.serialPeek(&device->context)) > 0)
         {
             uint16_t garbageDataSize = (available > sizeof(garbageData))
                                         ? sizeof(garbageData)
                                         : (uint16_t)available;
 
-            context.serialRead(garbageData, garbageDataSize);
+            device->context.serialRead(&device->context, garbageData, garbageDataSize);
         }
     }
 }
 
-bool setApi(void)
+bool setApi(rbDevice_t * device)
 {
     bool set = false;
     for(int i = 0; i < 2; i++)
@@ -160,20 +745,20 @@ bool setApi(void)
 #else
         usleep(5000);
 #endif
-        if(jsprGetApiVersion())
+        if(jsprGetApiVersion(&device->jspr))
         {
-            if (receiveJspr(&response, "apiVersion"))
+            if (receiveJspr(&device->jspr, &device->response, "apiVersion"))
             {
-                if(JSPR_RC_NO_ERROR == response.code)
+                if(JSPR_RC_NO_ERROR == device->response.code)
                 {
                     jsprApiVersion_t apiVersion;
-                    parseJsprGetApiVersion(response.json, &apiVersion);
+                    parseJsprGetApiVersion(&device->jspr, device->response.json, &apiVersion);
                     if(!apiVersion.activeVersionSet)
                     {
-                        jsprPutApiVersion(&apiVersion.supportedVersions[0]);
-                        receiveJspr(&response, "apiVersion");
+                        jsprPutApiVersion(&device->jspr, &apiVersion.supportedVersions[0]);
+                        receiveJspr(&device->jspr, &device->response, "apiVersion");
                     }
-                    if(JSPR_RC_NO_ERROR == response.code || apiVersion.activeVersionSet)
+                    if(JSPR_RC_NO_ERROR == device->response.code || apiVersion.activeVersionSet)
                     {
                         set = true;
                         i = 2;
@@ -185,35 +770,35 @@ bool setApi(void)
     return set;
 }
 
-bool setSim(void)
+bool setSim(rbDevice_t * device)
 {
     bool set = false;
-    if(jsprGetSimInterface())
+    if(jsprGetSimInterface(&device->jspr))
     {
-        if (receiveJspr(&response, "simConfig"))
+        if (receiveJspr(&device->jspr, &device->response, "simConfig"))
         {
-            if(JSPR_RC_NO_ERROR == response.code)
+            if(JSPR_RC_NO_ERROR == device->response.code)
             {
                 jsprSimInterface_t simInterface;
-                parseJsprGetSimInterface(response.json, &simInterface);
+                parseJsprGetSimInterface(&device->jspr, device->response.json, &simInterface);
                 
                 if(!simInterface.ifaceSet || simInterface.iface != SIM_INTERNAL)
                 {
-                    putSimInterface(SIM_INTERNAL);
-                    receiveJspr(&response, "simConfig");
-                    if ((JSPR_RC_NO_ERROR == response.code) &&
-                        (strncmp(response.target, "simConfig", JSPR_MAX_TARGET_LENGTH) == 0))
+                    putSimInterface(&device->jspr, SIM_INTERNAL);
+                    receiveJspr(&device->jspr, &device->response, "simConfig");
+                    if ((JSPR_RC_NO_ERROR == device->response.code) &&
+                        (strncmp(device->response.target, "simConfig", JSPR_MAX_TARGET_LENGTH) == 0))
                     {
-                        parseJsprGetSimInterface(response.json, &simInterface);
+                        parseJsprGetSimInterface(&device->jspr, device->response.json, &simInterface);
 
                         // Wait for unsolicited simStatus to come back
-                        if (waitForJsprMessage(&response, "simStatus", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                        if (waitForJsprMessage(&device->jspr, &device->response, "simStatus", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
                         {
                             set = true;
                         }
                     }
                 }
-                else if (JSPR_RC_NO_ERROR == response.code && simInterface.iface == SIM_INTERNAL)
+                else if (JSPR_RC_NO_ERROR == device->response.code && simInterface.iface == SIM_INTERNAL)
                 {
                     set = true;
                 }
@@ -223,17 +808,17 @@ bool setSim(void)
     return set;
 }
 
-bool setState(void)
+bool setState(rbDevice_t * device)
 {
     bool set = false;
-    if(jsprGetOperationalState())
+    if(jsprGetOperationalState(&device->jspr))
     {
-        if(receiveJspr(&response, "operationalState"))
+        if(receiveJspr(&device->jspr, &device->response, "operationalState"))
         {
-            if(JSPR_RC_NO_ERROR == response.code)
+            if(JSPR_RC_NO_ERROR == device->response.code)
             {
                 jsprOperationalState_t state;
-                parseJsprGetOperationalState(response.json, &state);
+                parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
                 if(state.operationalStateSet)
                 {
                     if(state.operationalState == ACTIVE)
@@ -242,22 +827,22 @@ bool setState(void)
                     }
                     else if(state.operationalState == INACTIVE)
                     {
-                        putOperationalState(ACTIVE);
-                        receiveJspr(&response, "operationalState");
-                        if(JSPR_RC_NO_ERROR == response.code)
+                        putOperationalState(&device->jspr, ACTIVE);
+                        receiveJspr(&device->jspr, &device->response, "operationalState");
+                        if(JSPR_RC_NO_ERROR == device->response.code)
                         {
                             set = true;
                         }
                     }
                     else //if its in another mode it may need to be turned inactive first
                     {
-                        putOperationalState(INACTIVE);
-                        receiveJspr(&response, "operationalState");
-                        if(JSPR_RC_NO_ERROR == response.code)
+                        putOperationalState(&device->jspr, INACTIVE);
+                        receiveJspr(&device->jspr, &device->response, "operationalState");
+                        if(JSPR_RC_NO_ERROR == device->response.code)
                         {
-                            putOperationalState(ACTIVE);
-                            receiveJspr(&response, "operationState");
-                            if(JSPR_RC_NO_ERROR == response.code)
+                            putOperationalState(&device->jspr, ACTIVE);
+                            receiveJspr(&device->jspr, &device->response, "operationState");
+                            if(JSPR_RC_NO_ERROR == device->response.code)
                             {
                                 set = true;
                             }
@@ -271,49 +856,189 @@ bool setState(void)
 }
 
 #ifndef ARDUINO
-bool rbBegin(const char* port)
+static bool reopenAtBaud(rbDevice_t * device, const uint32_t baud)
 {
-    bool began = false;
-    if(SERIAL_CONTEXT_SETUP_FUNC(port, RB9704_BAUD))
+    bool reopened = false;
+    if(device->context.serialState != OPEN || device->context.serialDeInit(&device->context))
     {
-        if(context.serialInit != NULL)
+        device->context.serialState = CLOSED;
+        device->context.serialBaud = baud;
+        if(device->context.serialInit(&device->context))
         {
-            if(context.serialInit())
-            {
-                clearLeftoverData();
-                serialState = OPEN;
-                if(setApi())
-                {
-                    if(setSim())
-                    {
-                        if(setState())
-                        {
-                            imtQueueInit(); //initialise (clean) the queue
-                            began = true;
-                        }
-                    }
-                }
-            }
+            device->context.serialState = OPEN;
+            sendJspr(&device->jspr, "\r", 1U); //end anything a wrong rate left in the modem's line buffer
+            delay(RB_BAUD_PROBE_SETTLE_MS);
+            clearLeftoverData(device);
+            resetJspr(&device->jspr);
+            reopened = true;
         }
     }
-    return began;
+    return reopened;
 }
-#endif
 
-static size_t encodeData(const char * srcBuffer, const size_t srcLength, char * destBuffer, const size_t destLength)
+//One intact apiVersion reply within RB_BAUD_PROBE_TIMEOUT_MS of since, unsolicited lines are skipped
+static bool awaitApiVersion(rbDevice_t * device, const unsigned long since, size_t * bytes)
 {
-    size_t encodedBytes = -1;
-    if(srcBuffer != NULL && srcLength > 0 && destBuffer != NULL && destLength > 0)
+    bool replied = false;
+    bool failed = false;
+    while(!replied && !failed)
     {
-        int err = mbedtls_base64_encode((unsigned char*)destBuffer, destLength, &encodedBytes, (unsigned char*)srcBuffer, srcLength);
-        if (0 != err)
+        if(pollJspr(&device->jspr, &device->response))
         {
-            encodedBytes = -1;
+            jsprApiVersion_t apiVersion;
+            if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "apiVersion") == 0 &&
+               parseJsprGetApiVersion(&device->jspr, device->response.json, &apiVersion))
+            {
+                *bytes += 6U + strlen(device->response.target) + strlen(device->response.json); //code, spaces and \r
+                replied = true;
+            }
+            else if(JSPR_RC_UNSOLICITED_MESSAGE != device->response.code)
+            {
+                failed = true; //garbled, or a reply we didn't ask for
+            }
         }
-    }
-    return encodedBytes;
-}
-
+        else if(millis() - since >= RB_BAUD_PROBE_TIMEOUT_MS)
+        {
+            failed = true;
+        }
+        else
+        {
+            waitJspr(&device->jspr, RB_BAUD_PROBE_TIMEOUT_MS - (millis() - since));
+        }
+    }
+    return replied;
+}
+
+static void probeRoundTrips(rbDevice_t * device, rbBaudProbe_t * result)
+{
+    const unsigned long start = millis();
+    size_t bytes = 0;
+    bool passed = true;
+
+    for(uint32_t sent = 0; passed && sent < RB_BAUD_PROBE_ROUND_TRIPS; sent += RB_BAUD_PROBE_BURST)
+    {
+        const unsigned long burstStart = millis();
+        for(uint32_t i = 0; passed && i < RB_BAUD_PROBE_BURST; i++)
+        {
+            passed = jsprGetApiVersion(&device->jspr);
+            bytes += sizeof("GET apiVersion {}\r") - 1U;
+        }
+        for(uint32_t replies = 0; passed && replies < RB_BAUD_PROBE_BURST; replies++)
+        {
+            passed = awaitApiVersion(device, burstStart, &bytes);
+            if(passed)
+            {
+                result->roundTrips++;
+            }
+        }
+    }
+    const unsigned long elapsed = millis() - start;
+    result->passed = passed;
+    result->bytesPerSecond = passed ? (uint32_t)((bytes * 1000U) / ((elapsed > 0) ? elapsed : 1U)) : 0;
+}
+
+bool rbDeviceMeasureLatency(rbDevice_t * device, const uint32_t roundTrips, rbLatency_t * result)
+{
+    bool passed = device->context.serialState == OPEN;
+    uint64_t totalUs = 0;
+    size_t bytes = 0;
+
+    memset(result, 0, sizeof(rbLatency_t));
+    for(uint32_t i = 0; passed && i < roundTrips; i++) //one at a time, a queued request would hide the turnaround
+    {
+        const unsigned long startUs = micros();
+        passed = jsprGetApiVersion(&device->jspr) && awaitApiVersion(device, millis(), &bytes);
+        if(passed)
+        {
+            const uint32_t us = (uint32_t)(micros() - startUs);
+            result->minUs = (result->roundTrips == 0 || us < result->minUs) ? us : result->minUs;
+            result->maxUs = (us > result->maxUs) ? us : result->maxUs;
+            totalUs += us;
+            result->roundTrips++;
+        }
+    }
+    result->avgUs = (result->roundTrips > 0) ? (uint32_t)(totalUs / result->roundTrips) : 0;
+    return passed && roundTrips > 0;
+}
+
+bool rbDeviceProbeBaud(rbDevice_t * device, const uint32_t * rates, const size_t count, rbBaudProbe_t * results)
+{
+    static const uint32_t defaultRates[] = RB_BAUD_PROBE_RATES;
+    const uint32_t * tried = (rates != NULL) ? rates : defaultRates;
+    size_t triedCount = (rates != NULL) ? count : sizeof(defaultRates) / sizeof(defaultRates[0]);
+    const uint32_t original = device->context.serialBaud;
+    const bool wasOpen = device->context.serialState == OPEN;
+    uint32_t bestRate = 0;
+
+    if(triedCount > RB_BAUD_PROBE_MAX_RATES)
+    {
+        triedCount = RB_BAUD_PROBE_MAX_RATES;
+    }
+    for(size_t i = 0; i < triedCount && wasOpen; i++)
+    {
+        rbBaudProbe_t result = { tried[i], false, 0, 0 };
+        if(reopenAtBaud(device, tried[i]))
+        {
+            probeRoundTrips(device, &result);
+            if(result.passed && tried[i] > bestRate)
+            {
+                bestRate = tried[i];
+            }
+        }
+        if(results != NULL)
+        {
+            results[i] = result;
+        }
+    }
+    if(wasOpen)
+    {
+        reopenAtBaud(device, (bestRate != 0) ? bestRate : original); //fall back to what worked before
+    }
+    return bestRate != 0;
+}
+
+bool rbDeviceBegin(rbDevice_t * device, const char* port)
+{
+    bool began = false;
+    if(SERIAL_CONTEXT_SETUP_FUNC(&device->context, port, RB9704_BAUD))
+    {
+#if defined(__linux__) || defined(__APPLE__)
+        if(device->context.serialInit == openPortLinux) //the handle is only a serialLinuxPort_t with the Linux preset
+        {
+            setLowLatencyLinux(&device->context, device->config.lowLatency);
+        }
+#endif
+        if(device->context.serialInit != NULL)
+        {
+            if(device->context.serialInit(&device->context))
+            {
+                clearLeftoverData(device);
+                resetJspr(&device->jspr);
+                device->context.serialState = OPEN;
+                if(setApi(device))
+                {
+                    if(device->config.probeBaud)
+                    {
+                        rbDeviceProbeBaud(device, NULL, 0, NULL); //stays at RB9704_BAUD if nothing faster passes
+                    }
+                    if(setSim(device))
+                    {
+                        if(setState(device))
+                        {
+                            if(setupQueues(device)) //build (or clean) the queues
+                            {
+                                began = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return began;
+}
+#endif
+
 static size_t decodeData(const char * srcBuffer, const size_t srcLength, char * destBuffer, const size_t destLength)
 {
     size_t decodedBytes = -1;
@@ -328,161 +1053,176 @@ static size_t decodeData(const char * srcBuffer, const size_t srcLength, char *
     return decodedBytes;
 }
 
-static bool appendCrc(uint8_t * buffer, size_t length)
+static bool verifyMtCrc(imt_t * imtMt)
+{
+    if(imtMt->crcOffset < imtMt->length && imtMt->length <= imtMt->capacity)
+    {
+        //segments that landed out of order were skipped, they are all here now
+        imtMt->crcRunning = crc16Update(imtMt->crcRunning, imtMt->buffer + imtMt->crcOffset, imtMt->length - imtMt->crcOffset);
+        imtMt->crcOffset = imtMt->length;
+    }
+    return imtMt->length > IMT_CRC_SIZE && imtMt->crcOffset == imtMt->length && imtMt->crcRunning == 0; //crc over data + crc is 0
+}
+
+static bool appendCrc(imt_t * imtMo)
 {
     bool appended = false;
-    uint16_t crc = calculateCrc(buffer, length, 0);
+    uint16_t crc = crc16Update(0, imtMo->payload, imtMo->length);
     if (crc > 0)
     {
-        crcBuffer[0] = (crc >> 8) & 0xFFU;
-        crcBuffer[1] = crc & 0xFFU;
-        memcpy(buffer + length, crcBuffer, IMT_CRC_SIZE);
+        imtMo->crc[0] = (crc >> 8) & 0xFFU;
+        imtMo->crc[1] = crc & 0xFFU;
         appended = true;
     }
-    memset(crcBuffer, 0, IMT_CRC_SIZE);
     return appended;
 }
 
-bool rbSendMessage(const char * data, const size_t length, const int timeout)
+static bool sendMoSegment(rbDevice_t * device, const imt_t * imtMo, const size_t segmentStart, const size_t segmentLength)
 {
     bool sent = false;
-    bool queued = false;
-    if(checkProvisioning(RAW_TOPIC))
+    size_t dataLength = 0;
+    jsprMessageOriginate_t messageOriginate;
+    if(imtMo->payload != NULL && segmentLength > 0 && segmentStart + segmentLength <= imtMo->length + IMT_CRC_SIZE)
     {
-        if (moQueuedMessages > 0)
+        if(segmentStart < imtMo->length)
         {
-            imtQueueMoRemove();
+            dataLength = imtMo->length - segmentStart;
+            if(dataLength > segmentLength)
+            {
+                dataLength = segmentLength;
+            }
         }
+        messageOriginate.messageId = imtMo->id;
+        messageOriginate.topic = imtMo->topic;
+        //payload is read in place, the crc follows it once the payload runs out
+        sent = jsprPutMessageOriginateSegment(&device->jspr, &messageOriginate, segmentLength, segmentStart,
+                                              (dataLength > 0) ? imtMo->payload + segmentStart : NULL, dataLength,
+                                              (segmentLength > dataLength) ? imtMo->crc + ((segmentStart + dataLength) - imtMo->length) : NULL,
+                                              segmentLength - dataLength);
+    }
+    return sent;
+}
+
+bool rbDeviceSendMessage(rbDevice_t * device, const char * data, const size_t length, const int timeout)
+{
+    bool sent = false;
+    bool queued = false;
+    if(checkProvisioning(device, RAW_TOPIC))
+    {
         if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
         {
-            queued = imtQueueMoAdd(RAW_TOPIC, data, length);
+            queued = queueBlockingMo(device, RAW_TOPIC, data, length);
             if(queued)
             {
-                sent = sendMoFromQueue(timeout);
+                sent = sendMoFromQueue(device, timeout);
             }
         }
     }
     return sent;
 }
 
-bool rbSendMessageCloudloop(cloudloopTopics_t topic, const char * data, const size_t length, const int timeout)
+bool rbDeviceSendMessageCloudloop(rbDevice_t * device, cloudloopTopics_t topic, const char * data, const size_t length, const int timeout)
 {
     bool sent = false;
     bool queued = false;
-    if(checkProvisioning(topic))
+    if(checkProvisioning(device, topic))
     {
-        if (moQueuedMessages > 0)
-        {
-            imtQueueMoRemove();
-        }
         if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
         {
-            queued = imtQueueMoAdd(topic, data, length);
+            queued = queueBlockingMo(device, topic, data, length);
             if(queued)
             {
-                sent = sendMoFromQueue(timeout);
+                sent = sendMoFromQueue(device, timeout);
             }
         }
     }
     return sent;
 }
 
-bool rbSendMessageAny(uint16_t topic, const char * data, const size_t length, const int timeout)
+bool rbDeviceSendMessageAny(rbDevice_t * device, uint16_t topic, const char * data, const size_t length, const int timeout)
 {
     bool sent = false;
     bool queued = false;
-    if(checkProvisioning(topic))
+    if(checkProvisioning(device, topic))
     {
-        if (moQueuedMessages > 0)
-        {
-            imtQueueMoRemove();
-        }
         if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
         {
-            queued = imtQueueMoAdd(topic, data, length);
-            if(queued >= 0)
+            queued = queueBlockingMo(device, topic, data, length);
+            if(queued)
             {
-                sent = sendMoFromQueue(timeout);
+                sent = sendMoFromQueue(device, timeout);
             }
         }
     }
     return sent;
 }
 
-static bool sendMoFromQueue(const int timeout)
+static int awaitedMo(rbDevice_t * device)
+{
+    int index = -1;
+    for(uint16_t i = 0; i < device->imtMo.count && index < 0; i++)
+    {
+        if(imtQueueGetAt(&device->imtMo, i)->awaited)
+        {
+            index = (int)i;
+        }
+    }
+    return index;
+}
+
+static bool sendMoFromQueue(rbDevice_t * device, const int timeout)
 {
     bool sent = false;
-    bool started = false;
+    bool waiting = true;
     unsigned long start = millis();
-    int initCrc = 0;
-    int segmentStart;
-    int segmentLength;
-    int encodedBytes;
-    imt_t * imtMo = imtQueueMoGetFirst();
-
-    if(imtMo != NULL)
+    int index;
+
+    //just queued at the tail, offered ahead of the MOs still waiting
+    imtQueueMove(&device->imtMo, device->imtMo.count - 1U, device->moInFlight);
+    imtQueueGetAt(&device->imtMo, device->moInFlight)->awaited = true;
+    device->moQueuedMessages += 1;
+    device->moAwaitedSent = false;
+    pumpMo(device);
+    while (waiting)
     {
-        if(appendCrc(imtMo->buffer, imtMo->length))
+        pollDevice(device);
+        index = awaitedMo(device);
+        if(index < 0)
         {
-            if(imtMo->buffer != NULL && imtMo->length > 0 && imtMo->topic >= IMT_MIN_TOPIC_ID 
-            && imtMo->topic <= IMT_MAX_TOPIC_ID)
+            sent = device->moAwaitedSent; //finished, or dropped before the modem took it
+            waiting = false;
+        }
+        else if ((millis() - start) >= (timeout * 1000UL))
+        {
+            if(index < device->moInFlight)
             {
-                if(jsprPutMessageOriginate(imtMo->topic, imtMo->length + IMT_CRC_SIZE))
-                {
-                    if(receiveJspr(&response, "messageOriginate"))
-                    {
-                        if(JSPR_RC_NO_ERROR == response.code)
-                        {
-                            jsprMessageOriginate_t messageOriginate;
-                            parseJsprPutMessageOriginate(response.json, &messageOriginate);
-                            imtMo->id = messageOriginate.messageId;
-                            started = true;
-                            while (true)
-                            {
-                                rbPoll();
-                                if(moDropped)
-                                {
-                                    sent = false;
-                                    moDropped = false;
-                                    break;
-                                }
-                                else if (moSent)
-                                {
-                                    sent = true;
-                                    moSent = false;
-                                    break;
-                                }
-                                else if ((millis() - start) >= (timeout * 1000UL))
-                                {
-                                    sent = false;
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
+                imtQueueGetAt(&device->imtMo, (uint16_t)index)->awaited = false; //with the modem, finished by rbPoll()
+            }
+            else
+            {
+                removeMoAt(device, (uint16_t)index); //never offered to the modem
             }
+            waiting = false;
         }
-
-        if(!started)
+        else
         {
-            imtQueueMoRemove(); //failed one of the checks, drop message
+            waitJspr(&device->jspr, (timeout * 1000UL) - (millis() - start));
         }
     }
     return sent;
 }
 
-size_t rbReceiveMessage(char ** buffer)
+size_t rbDeviceReceiveMessage(rbDevice_t * device, char ** buffer)
 {
     size_t length = 0;
 
-    if(listenForMt())
+    if(listenForMt(device))
     {
-        imt_t * imtMt = imtQueueMtGetFirst();
+        imt_t * imtMt = imtQueueGetAt(&device->imtMt, firstReadyMt(device, true));
         if(buffer != NULL && imtMt != NULL)
         {
             if(imtMt->buffer != NULL && imtMt->length > 0 && imtMt->topic >= IMT_MIN_TOPIC_ID &&
-                imtMt->topic <= IMT_MAX_TOPIC_ID) //check head is valid mt
+                imtMt->topic <= IMT_MAX_TOPIC_ID) //check mt is valid
             {
                 length = (imtMt->length - IMT_CRC_SIZE);
                 imtMt->buffer[length] = '\0'; //remove crc
@@ -494,17 +1234,17 @@ size_t rbReceiveMessage(char ** buffer)
     return length;
 }
 
-size_t rbReceiveMessageWithTopic(char ** buffer, uint16_t topic)
+size_t rbDeviceReceiveMessageWithTopic(rbDevice_t * device, char ** buffer, uint16_t topic)
 {
     size_t length = 0;
 
-    if(listenForMt())
+    if(listenForMt(device))
     {
-        imt_t * imtMt = imtQueueMtGetFirst();
+        imt_t * imtMt = imtQueueGetAt(&device->imtMt, firstReadyMt(device, true));
         if(buffer != NULL && imtMt != NULL)
         {
             if(imtMt->buffer != NULL && imtMt->length > 0 && imtMt->topic >= IMT_MIN_TOPIC_ID &&
-                imtMt->topic <= IMT_MAX_TOPIC_ID) //check head is valid mt
+                imtMt->topic <= IMT_MAX_TOPIC_ID) //check mt is valid
             {
                 length = (imtMt->length - IMT_CRC_SIZE);
                 imtMt->buffer[length] = '\0'; //remove crc
@@ -517,96 +1257,124 @@ size_t rbReceiveMessageWithTopic(char ** buffer, uint16_t topic)
     return length;
 }
 
-static bool listenForMt(void)
+static bool listenForMt(rbDevice_t * device)
 {
     bool received = false;
 
-    rbPoll();
-    imt_t * imtMt = imtQueueMtGetFirst();
-    if(imtMt != NULL)
+    pollDevice(device);
+    bool pending = false;
+    for(uint16_t i = 0; i < device->imtMt.count && !pending; i++)
+    {
+        pending = imtQueueGetAt(&device->imtMt, i)->readyToProcess; //arriving, or complete and not yet read
+    }
+    if(pending)
     {
-        if(imtMt->readyToProcess)
+        while(true)
         {
-            while(true)
+            waitJspr(&device->jspr, RB_MT_WAIT_SLICE_MS);
+            pollDevice(device);
+            if(device->mtDropped)
             {
-                rbPoll();
-                if(mtDropped)
-                {
-                    received = false;
-                    mtDropped = false;
-                    break;
-                }
-                else if(mtReceived)
-                {
-                    received = true;
-                    mtReceived = false;
-                    break;
-                }
+                received = false;
+                device->mtDropped = false;
+                break;
+            }
+            else if(device->mtReceived)
+            {
+                received = true;
+                device->mtReceived = false;
+                break;
             }
         }
     }
     return received;
 }
 
-static bool sendMoFromQueueAsync(void)
+static bool requestMo(rbDevice_t * device, const uint16_t index)
 {
-    bool started = false;
-    imt_t * imtMo = imtQueueMoGetFirst();
+    bool requested = false;
+    imt_t * imtMo = imtQueueGetAt(&device->imtMo, index);
+    const int reference = device->jspr.messageReference;
 
-    if(imtMo != NULL)
+    if(imtMo != NULL && index == device->moInFlight)
     {
-        if(appendCrc(imtMo->buffer, imtMo->length))
+        if(appendCrc(imtMo))
         {
-            if(imtMo->buffer != NULL && imtMo->length > 0 && imtMo->topic >= IMT_MIN_TOPIC_ID 
+            if(imtMo->payload != NULL && imtMo->length > 0 && imtMo->topic >= IMT_MIN_TOPIC_ID 
             && imtMo->topic <= IMT_MAX_TOPIC_ID)
             {
-                if(jsprPutMessageOriginate(imtMo->topic, imtMo->length + IMT_CRC_SIZE))
+                if(jsprPutMessageOriginate(&device->jspr, imtMo->topic, imtMo->length + IMT_CRC_SIZE))
                 {
-                    if(receiveJspr(&response, "messageOriginate"))
-                    {
-                        if(JSPR_RC_NO_ERROR == response.code)
-                        {
-                            jsprMessageOriginate_t messageOriginate;
-                            parseJsprPutMessageOriginate(response.json, &messageOriginate);
-                            imtMo->id = messageOriginate.messageId;
-                            started = true;
-                        }
-                    }
+                    imtMo->requestReference = (uint8_t)reference; //the reply carries it back
+                    device->moInFlight++;
+                    requested = true;
                 }
             }
         }
+    }
+    return requested;
+}
 
-        if(!started)
+static void pumpMo(rbDevice_t * device)
+{
+    while(device->moInFlight < moInFlightLimit(device) && device->moInFlight < device->imtMo.count)
+    {
+        if(!requestMo(device, device->moInFlight))
         {
-            imtQueueMoRemove(); //failed one of the checks, drop message
+            removeMoAt(device, device->moInFlight); //failed one of the checks, drop message
         }
     }
-    return started;
 }
 
-bool rbSendMessageAsync(uint16_t topic, const char * data, const size_t length)
+static void finishMo(rbDevice_t * device, const uint16_t index, const rbMsgStatus_t status)
+{
+    imt_t * imtMo = imtQueueGetAt(&device->imtMo, index);
+    if(imtMo->awaited)
+    {
+        device->moAwaitedSent = (status == RB_MSG_STATUS_OK);
+    }
+    reportMo(device, imtMo->id, status);
+    removeMoAt(device, index);
+    pumpMo(device);
+}
+
+static bool sendMoAsync(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length)
 {
     bool queuedToSend = false;
-    bool queued = false;
-    if(checkProvisioning(topic))
+#ifdef RB_MO_JOURNAL
+    if(device->moJournal.map != NULL)
     {
-        if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+        const rbCodec_t * codec = topicCodec(device, topic);
+        if(codec == NULL)
         {
-            queued = imtQueueMoAdd(topic, data, length);
-            if(queued)
+            queuedToSend = moJournalAppend(&device->moJournal, topic, data, length) != NULL;
+        }
+        else if(length < IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+        {
+            uint8_t * encoded = (uint8_t *)malloc(length + 1U); //journalled as sent, replayed with borrowed sends
+            if(encoded != NULL)
             {
-                if (moQueuedMessages == 0)
-                {
-                    queuedToSend = sendMoFromQueueAsync();
-                }
-                else
-                {
-                    queuedToSend = true;
-                }
-
-                if(queuedToSend)
+                const size_t encodedLength = encodeMo(codec, data, length, encoded);
+                queuedToSend = moJournalAppend(&device->moJournal, topic, (const char *)encoded, encodedLength) != NULL;
+                free(encoded);
+            }
+        }
+        feedJournal(device);
+    }
+    else
+#endif
+    {
+        if(queueMo(device, topic, data, length))
+        {
+            const uint16_t index = placeMo(device);
+            device->moQueuedMessages += 1;
+            queuedToSend = true;
+            if(device->moInFlight < moInFlightLimit(device))
+            {
+                queuedToSend = requestMo(device, index);
+                if(!queuedToSend)
                 {
-                    moQueuedMessages += 1;
+                    removeMoAt(device, index); //failed one of the checks, drop message
                 }
             }
         }
@@ -614,536 +1382,1043 @@ bool rbSendMessageAsync(uint16_t topic, const char * data, const size_t length)
     return queuedToSend;
 }
 
-size_t rbReceiveMessageAsync(char ** buffer)
+static rbTopicBatch_t * findBatch(rbDevice_t * device, const uint16_t topic)
 {
-    size_t length = 0;
-    imt_t * imtMt = imtQueueMtGetFirst();
+    rbTopicBatch_t * batch = NULL;
+    for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES && batch == NULL; i++)
+    {
+        if(device->topicBatches[i].buffer != NULL && device->topicBatches[i].topic == topic)
+        {
+            batch = &device->topicBatches[i];
+        }
+    }
+    return batch;
+}
 
-    if(imtMt != NULL)
+static size_t batchPrefixLength(size_t length)
+{
+    size_t prefix = 1U;
+    while(length >= 0x80U)
     {
-        if(imtMt->ready)
+        length >>= 7;
+        prefix++;
+    }
+    return prefix;
+}
+
+static size_t putBatchPrefix(uint8_t * out, size_t length)
+{
+    size_t written = 0;
+    while(length >= 0x80U)
+    {
+        out[written++] = (uint8_t)(length | 0x80U); //7 bits at a time, lowest first
+        length >>= 7;
+    }
+    out[written++] = (uint8_t)length;
+    return written;
+}
+
+static bool flushBatch(rbDevice_t * device, rbTopicBatch_t * batch)
+{
+    bool flushed = batch->length == 0;
+    if(!flushed)
+    {
+        flushed = sendMoAsync(device, batch->topic, (const char *)batch->buffer, batch->length);
+        if(flushed)
         {
-            if(buffer != NULL)
-            {
-                if(imtMt->buffer != NULL && imtMt->length > 0 && imtMt->topic >= IMT_MIN_TOPIC_ID &&
-                    imtMt->topic <= IMT_MAX_TOPIC_ID && imtMt->ready) //check head is valid mt
-                {
-                    length = (imtMt->length - IMT_CRC_SIZE);
-                    imtMt->buffer[length] = '\0'; //remove crc
-                    *buffer = (char*)imtMt->buffer;
-                    imtMt->readyToProcess = false; //finished processing
-                }
-            }
+            batch->length = 0;
+            batch->records = 0;
         }
     }
-    return length;
+    return flushed;
 }
 
-void rbReceiveLockAsync(void)
+static bool batchMo(rbDevice_t * device, rbTopicBatch_t * batch, const char * data, const size_t length)
 {
-    imtQueueMtLock(true);
+    const size_t framed = batchPrefixLength(length) + length;
+    if(batch->length + framed > batch->maxSize)
+    {
+        flushBatch(device, batch); //make room, the record waits for the next batch
+    }
+    const bool batched = batch->length + framed <= batch->maxSize;
+    if(batched)
+    {
+        if(batch->length == 0)
+        {
+            batch->openedAt = millis();
+        }
+        batch->length += putBatchPrefix(batch->buffer + batch->length, length);
+        memcpy(batch->buffer + batch->length, data, length);
+        batch->length += length;
+        batch->records++;
+        if(batch->length == batch->maxSize)
+        {
+            flushBatch(device, batch); //full, retried on the next poll if the queue has no room
+        }
+    }
+    return batched;
 }
 
-void rbReceiveUnlockAsync(void)
+static uint8_t * frameUnbatched(const char * data, const size_t length, size_t * framed)
 {
-    imtQueueMtLock(false);
+    uint8_t * single = NULL;
+    *framed = batchPrefixLength(length) + length;
+    if(*framed <= RB_BATCH_MAX_SIZE)
+    {
+        single = (uint8_t *)malloc(*framed);
+    }
+    if(single != NULL)
+    {
+        const size_t prefix = putBatchPrefix(single, length); //a batch of one, the receiver splits every MT on the topic
+        memcpy(single + prefix, data, length);
+    }
+    return single;
 }
 
-void rbSendLockAsync(void)
+static bool sendUnbatched(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length)
 {
-    imtQueueMoLock(true);
+    bool sent = false;
+    size_t framed;
+    uint8_t * single = frameUnbatched(data, length, &framed);
+    if(single != NULL)
+    {
+        sent = sendMoAsync(device, topic, (const char *)single, framed);
+        free(single);
+    }
+    return sent;
 }
 
-void rbSendUnlockAsync(void)
+static bool queueBlockingMo(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length)
 {
-    imtQueueMoLock(false);
+    bool queued = false;
+    rbTopicBatch_t * batch = findBatch(device, topic);
+    if(batch == NULL)
+    {
+        queued = queueMo(device, topic, data, length);
+    }
+    else if(flushBatch(device, batch)) //records batched before it go first
+    {
+        size_t framed;
+        uint8_t * single = frameUnbatched(data, length, &framed);
+        if(single != NULL)
+        {
+            queued = queueMo(device, topic, (const char *)single, framed);
+            free(single);
+        }
+    }
+    return queued;
 }
 
-bool rbAcknowledgeReceiveHeadAsync(void)
+static void flushDueBatches(rbDevice_t * device)
 {
-    bool acknowledged = false;
-    if(imtQueueMtRemove())
+    for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES; i++)
     {
-        acknowledged = true;
+        rbTopicBatch_t * batch = &device->topicBatches[i];
+        if(batch->length > 0 && (batch->length == batch->maxSize ||
+           (batch->maxAgeMs > 0 && millis() - batch->openedAt >= batch->maxAgeMs)))
+        {
+            flushBatch(device, batch);
+        }
     }
-    return acknowledged;
 }
 
-static bool checkMoQueue(void)
+static uint32_t batchWaitMs(rbDevice_t * device, const uint32_t timeoutMs)
 {
-    bool success = false;
-    if(moQueuedMessages > 0) //check if any more messages are queued
+    uint32_t wait = timeoutMs;
+    for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES; i++)
     {
-        if(sendMoFromQueueAsync()) //send the next message
+        const rbTopicBatch_t * batch = &device->topicBatches[i];
+        if(batch->length > 0 && batch->maxAgeMs > 0)
         {
-            success = true;
+            const unsigned long age = millis() - batch->openedAt;
+            const uint32_t left = (age >= batch->maxAgeMs) ? 0 : (uint32_t)(batch->maxAgeMs - age);
+            if(left < wait)
+            {
+                wait = left;
+            }
         }
     }
-    return success;
+    return wait;
 }
 
-void rbPoll(void)
+bool rbDeviceSendMessageAsync(rbDevice_t * device, uint16_t topic, const char * data, const size_t length)
 {
-    int segmentStart;
-    int segmentStartMt;
-    int segmentLength;
-    int segmentLengthMt;
-    int encodedBytes;
-    int decodedBytes;
-    bool mtQueued;
-    imt_t * imtMo = imtQueueMoGetFirst();
-    if(context.serialPeek() > 0)
+    bool queuedToSend = false;
+    if(checkProvisioning(device, topic))
     {
-        if(receiveJspr(&response, NULL))
+        if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
         {
-            //MO JSPR
-            if(imtMo != NULL)
+            rbTopicBatch_t * batch = findBatch(device, topic);
+            if(batch != NULL && batchPrefixLength(length) + length <= batch->maxSize)
             {
-                if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "messageOriginateSegment") == 0)
-                {
-                    jsprMessageOriginateSegment_t messageOriginateSegment;
-                    parseJsprUnsMessageOriginateSegment(response.json, &messageOriginateSegment);
-                    if(messageOriginateSegment.messageId == imtMo->id && 
-                    messageOriginateSegment.topic == imtMo->topic)
-                    {
-                        segmentStart = messageOriginateSegment.segmentStart;
-                        segmentLength = messageOriginateSegment.segmentLength;
-                        encodedBytes = encodeData((char*)imtMo->buffer + segmentStart, 
-                        segmentLength, (char*)base64Buffer, BASE64_TEMP_BUFFER);
-                        if(0 < encodedBytes)
-                        {
-                            jsprMessageOriginate_t messageOriginate;
-                            messageOriginate.messageId = imtMo->id;
-                            messageOriginate.topic = imtMo->topic;
-                            jsprPutMessageOriginateSegment(&messageOriginate, segmentLength, 
-                            segmentStart, (char*)base64Buffer);
-                        }
-                    }
-                }
-                if(JSPR_RC_NO_ERROR != response.code && JSPR_RC_UNSOLICITED_MESSAGE != response.code && strcmp(response.target, "messageOriginateSegment") == 0)
-                {
-                    jsprMessageOriginateSegment_t messageOriginateSegment;
-                    if(parseJsprUnsMessageOriginateSegment(response.json, &messageOriginateSegment))
-                    {
-                        if(imtMo->id == messageOriginateSegment.messageId)
-                        {
-                    
-                            if(rbCallbacks && rbCallbacks->moMessageComplete)
-                            {
-                                rbCallbacks->moMessageComplete(imtMo->id, RB_MSG_STATUS_FAIL);
-                            }
-                            else
-                            {
-                                moDropped = true;
-                            }
-                            imtQueueMoRemove(); //drop message
-                            checkMoQueue();
-                        }
-                    }
-                }
-                if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "messageOriginateStatus") == 0)
-                {
-                    jsprMessageOriginateStatus_t messageOriginateStatus;
-                    if(parseJsprUnsMessageOriginateStatus(response.json, &messageOriginateStatus))
-                    {
-                        if(imtMo->id == messageOriginateStatus.messageId)
-                        {
-                            if(messageOriginateStatus.finalMoStatus == MO_ACK_RECEIVED_MOS)
-                            {
-                                if(rbCallbacks && rbCallbacks->moMessageComplete)
-                                {
-                                    rbCallbacks->moMessageComplete(imtMo->id, RB_MSG_STATUS_OK);
-                                }
-                                else
-                                {
-                                    moSent = true;
-                                }
-                            }
-                            else
-                            {
-                                if(rbCallbacks && rbCallbacks->moMessageComplete)
-                                {
-                                    rbCallbacks->moMessageComplete(imtMo->id, RB_MSG_STATUS_FAIL);
-                                }
-                                else
-                                {
-                                    moDropped = true;
-                                }
-                            }
-                            imtQueueMoRemove();
-                            checkMoQueue();
-                        }
-                    }
-                }
-            }
-            //MT JSPR
-            if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "messageTerminate") == 0)
-            {
-                jsprMessageTerminate_t messageTerminate;
-                parseJsprUnsMessageTerminate(response.json, &messageTerminate);
-                mtQueued = imtQueueMtAdd(messageTerminate.topic, messageTerminate.messageId, messageTerminate.messageLengthMax);
-                imt_t * imtMt = imtQueueMtGetLast();
-                if (mtQueued) //returns -1 if que is full, no free spots to store mt
-                {
-                    if(imtMt != NULL)
-                    {
-                        imtMt->readyToProcess = true;
-                    }
-                }
-                else
-                {
-                    if(rbCallbacks && rbCallbacks->mtMessageComplete)
-                    {
-                        rbCallbacks->mtMessageComplete(messageTerminate.messageId, RB_MSG_STATUS_FAIL);
-                    }
-                }
-            }
-            if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "messageTerminateSegment") == 0)
-            {
-                imt_t * imtMt = imtQueueMtGetLast();
-                if(imtMt != NULL)
-                {
-                    if(imtMt->readyToProcess)
-                    {
-                        jsprMessageTerminateSegment_t messageTerminateSegment;
-                        parseJsprUnsMessageTerminateSegment(response.json, &messageTerminateSegment);
-                        segmentStartMt = messageTerminateSegment.segmentStart;
-                        segmentLengthMt = messageTerminateSegment.segmentLength;
-                        if(imtMt->id == messageTerminateSegment.messageId)
-                        {
-                            decodedBytes = decodeData(messageTerminateSegment.data, messageTerminateSegment.dataLength, 
-                            (char*)imtMt->buffer + segmentStartMt, segmentLengthMt);
-                            messageLengthAsync += segmentLengthMt;
-                            if(0 > decodedBytes)
-                            {
-                                if(rbCallbacks && rbCallbacks->mtMessageComplete)
-                                {
-                                    rbCallbacks->mtMessageComplete(imtMt->id, RB_MSG_STATUS_FAIL);
-                                }
-                                else
-                                {
-                                    mtDropped = true;
-                                }
-                                imtQueueMtRemove();
-                            }
-                        }
-                    }
-                }
+                queuedToSend = batchMo(device, batch, data, length);
             }
-            if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "messageTerminateStatus") == 0)
+            else if(batch == NULL)
             {
-                imt_t * imtMt = imtQueueMtGetLast();
-                if(imtMt != NULL)
-                {
-                    if(imtMt->readyToProcess)
-                    {
-                        jsprMessageTerminateStatus_t messageTerminateStatus;
-                        if(parseJsprUnsMessageTerminateStatus(response.json, &messageTerminateStatus))
-                        {
-                            if(imtMt->id == messageTerminateStatus.messageId)
-                            {
-                                if(messageTerminateStatus.finalMtStatus == COMPLETE)
-                                {
-                                    imtMt->length = messageLengthAsync;
-                                    messageLengthAsync = 0;
-                                    imtMt->ready = true;
-                                    if(rbCallbacks && rbCallbacks->mtMessageComplete)
-                                    {
-                                        rbCallbacks->mtMessageComplete(imtMt->id, RB_MSG_STATUS_OK);
-                                    }
-                                    else
-                                    {
-                                        mtReceived = true;
-                                    }
-                                }
-                                else
-                                {
-                                    if(rbCallbacks && rbCallbacks->mtMessageComplete)
-                                    {
-                                        rbCallbacks->mtMessageComplete(imtMt->id, RB_MSG_STATUS_FAIL);
-                                    }
-                                    else
-                                    {
-                                        mtDropped = true;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                queuedToSend = sendMoAsync(device, topic, data, length);
             }
-            if(JSPR_RC_UNSOLICITED_MESSAGE == response.code && strcmp(response.target, "constellationState") == 0)
+            else if(flushBatch(device, batch)) //too big to batch, goes after the records before it
             {
-                jsprConstellationState_t constellationState;
-                if(parseJsprGetSignal(response.json, &constellationState))
-                {
-                    if(rbCallbacks && rbCallbacks->constellationState)
-                    {
-                        rbCallbacks->constellationState(&constellationState);
-                    }
-                }
+                queuedToSend = sendUnbatched(device, topic, data, length);
             }
         }
     }
+    return queuedToSend;
 }
 
-int8_t rbGetSignal(void)
+bool rbDeviceSetTopicBatching(rbDevice_t * device, const uint16_t topic, const size_t maxSize, const uint32_t maxAgeMs)
 {
-    int8_t signal = -1;
-    jsprGetSignal();
-    waitForJsprMessage(&response, "constellationState", JSPR_RC_NO_ERROR, 1);
-    if(JSPR_RC_NO_ERROR == response.code && strcmp(response.target, "constellationState") == 0)
+    bool set = false;
+    rbTopicBatch_t * batch = findBatch(device, topic);
+    const size_t size = (maxSize < RB_BATCH_MAX_SIZE) ? maxSize : RB_BATCH_MAX_SIZE;
+
+    if(batch == NULL || flushBatch(device, batch)) //records already batched go out with the old settings
     {
-        jsprConstellationState_t conState;
-        if(parseJsprGetSignal(response.json, &conState))
+        if(batch != NULL)
         {
-            if(conState.signalBars >= 0 && conState.signalBars <= 5)
+            free(batch->buffer);
+            memset(batch, 0, sizeof(rbTopicBatch_t));
+        }
+        for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES && batch == NULL && size > 0; i++)
+        {
+            if(device->topicBatches[i].buffer == NULL)
             {
-                signal = conState.signalBars;
+                batch = &device->topicBatches[i];
+            }
+        }
+        set = (size == 0); //nothing more to do when removing
+        if(batch != NULL && size > 0)
+        {
+            batch->buffer = (uint8_t *)malloc(size);
+            if(batch->buffer != NULL)
+            {
+                batch->topic = topic;
+                batch->maxSize = size;
+                batch->maxAgeMs = maxAgeMs;
+                set = true;
             }
         }
     }
-    return signal;
+    return set;
 }
 
-static bool getHwInfo(jsprHwInfo_t * hwInfo)
+bool rbDeviceFlushBatches(rbDevice_t * device)
 {
-    bool populated = false;
-    jsprGetHwInfo();
-    receiveJspr(&response, "hwInfo");
-    if(JSPR_RC_NO_ERROR == response.code && strcmp(response.target, "hwInfo") == 0)
+    bool flushed = true;
+    for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES; i++)
     {
-        if(parseJsprGetHwInfo(response.json, hwInfo))
+        if(!flushBatch(device, &device->topicBatches[i]))
         {
-            populated = true;
+            flushed = false;
         }
     }
-    return populated;
+    return flushed;
 }
 
-char * rbGetImei(void)
+void rbUnbatchInit(rbUnbatch_t * unbatch, const char * data, const size_t length)
 {
-    char * imei = NULL;
-    if(getHwInfo(&hwInfo))
-    {
-        imei = hwInfo.imei;
-    }
-    return imei;
+    unbatch->data = data;
+    unbatch->length = (data != NULL) ? length : 0;
+    unbatch->offset = 0;
+    unbatch->malformed = false;
 }
 
-char * rbGetHwVersion(void)
+bool rbUnbatchNext(rbUnbatch_t * unbatch, const char ** record, size_t * length)
 {
-    char * hwVersion = NULL;
-    if(getHwInfo(&hwInfo))
+    bool found = false;
+    if(unbatch->offset < unbatch->length)
     {
-        hwVersion = hwInfo.hwVersion;
+        size_t offset = unbatch->offset;
+        size_t value = 0;
+        unsigned int shift = 0;
+        bool more = true;
+        while(more && offset < unbatch->length && shift < 28U)
+        {
+            const uint8_t byte = (uint8_t)unbatch->data[offset++];
+            value |= (size_t)(byte & 0x7FU) << shift;
+            shift += 7U;
+            more = (byte & 0x80U) != 0;
+        }
+        if(!more && value > 0 && value <= unbatch->length - offset)
+        {
+            *record = unbatch->data + offset;
+            *length = value;
+            unbatch->offset = offset + value;
+            found = true;
+        }
+        else
+        {
+            unbatch->malformed = true; //truncated or not a batch, stop here
+            unbatch->offset = unbatch->length;
+        }
     }
-    return hwVersion;
+    return found;
 }
 
-char * rbGetSerialNumber(void)
+static bool queueBorrowedMo(rbDevice_t * device, uint16_t topic, const char * data, const size_t length,
+                            rbReleaseCallback release, void * context)
 {
-    char * serialNumber = NULL;
-    if(getHwInfo(&hwInfo))
+    bool queuedToSend = false;
+    imt_t * imtMo;
+    if(checkProvisioning(device, topic))
     {
-        serialNumber = hwInfo.serialNumber;
+        if(data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+        {
+            if(makeRoomForMo(device, topicPriority(device, topic)) && 
+               imtQueueMoBorrow(&device->imtMo, topic, data, length, NULL, NULL))
+            {
+                const uint16_t index = placeMo(device);
+                device->moQueuedMessages += 1;
+                queuedToSend = true;
+                if(device->moInFlight < moInFlightLimit(device))
+                {
+                    queuedToSend = requestMo(device, index);
+                    if(!queuedToSend)
+                    {
+                        removeMoAt(device, index); //release is still unset, the buffer stays with the caller
+                    }
+                }
+
+                if(queuedToSend)
+                {
+                    imtMo = imtQueueGetAt(&device->imtMo, index);
+                    imtMo->release = release; //from here on the buffer is handed back through release
+                    imtMo->releaseContext = context;
+                }
+            }
+        }
     }
-    return serialNumber;
+    return queuedToSend;
 }
 
-int8_t rbGetBoardTemp(void)
+bool rbDeviceSendMessageBorrowedAsync(rbDevice_t * device, uint16_t topic, const char * data, const size_t length,
+                                      rbReleaseCallback release, void * context)
 {
-    int8_t boardTemp = -100; //needs to be some value that the temp can't be
-    jsprHwInfo_t hwInfo;
-    if(getHwInfo(&hwInfo))
-    {
-        boardTemp = hwInfo.boardTemp;
-    }
-    return boardTemp;
+    //a borrowed buffer can't be given the length prefix every MO on a batched topic carries
+    return findBatch(device, topic) == NULL && queueBorrowedMo(device, topic, data, length, release, context);
 }
 
-static bool getSimStatus(jsprSimStatus_t * simStatus)
+size_t rbDeviceReceiveMessageAsync(rbDevice_t * device, char ** buffer)
 {
-    bool populated = false;
-    jsprGetSimStatus();
-    receiveJspr(&response, "simStatus");
-    if(JSPR_RC_NO_ERROR == response.code && strcmp(response.target, "simStatus") == 0)
+    size_t length = 0;
+    imt_t * imtMt = imtQueueGetAt(&device->imtMt, firstReadyMt(device, false)); //completed MTs overtake ones still arriving
+
+    if(imtMt != NULL)
     {
-        if(parseJsprGetSimStatus(response.json, simStatus))
+        if(imtMt->ready)
         {
-            populated = true;
+            if(buffer != NULL)
+            {
+                if(imtMt->buffer != NULL && imtMt->length > 0 && imtMt->topic >= IMT_MIN_TOPIC_ID &&
+                    imtMt->topic <= IMT_MAX_TOPIC_ID && imtMt->ready) //check mt is valid
+                {
+                    length = (imtMt->length - IMT_CRC_SIZE);
+                    imtMt->buffer[length] = '\0'; //remove crc
+                    *buffer = (char*)imtMt->buffer;
+                    imtMt->readyToProcess = false; //finished processing
+                }
+            }
         }
     }
-    return populated;
+    return length;
 }
 
-bool rbGetCardPresent(void)
+void rbDeviceReceiveLockAsync(rbDevice_t * device)
 {
-    bool cardPresent = false;
-    if(getSimStatus(&simStatus))
-    {
-        cardPresent = simStatus.cardPresent;
-    }
-    return cardPresent;
+    imtQueueLock(&device->imtMt, true);
 }
 
-bool rbGetSimConnected(void)
+void rbDeviceReceiveUnlockAsync(rbDevice_t * device)
 {
-    bool simConnected = false;
-    if(getSimStatus(&simStatus))
-    {
-        simConnected = simStatus.simConnected;
-    }
-    return simConnected;
+    imtQueueLock(&device->imtMt, false);
 }
 
-char * rbGetIccid(void)
+void rbDeviceSendLockAsync(rbDevice_t * device)
 {
-    char * iccid = NULL;
-    if(getSimStatus(&simStatus))
+    imtQueueLock(&device->imtMo, true);
+}
+
+void rbDeviceSendUnlockAsync(rbDevice_t * device)
+{
+    imtQueueLock(&device->imtMo, false);
+}
+
+bool rbDeviceAcknowledgeReceiveHeadAsync(rbDevice_t * device)
+{
+    bool acknowledged = false;
+    const int index = firstReadyMt(device, false);
+    if(index >= 0 && imtQueueRemoveAt(&device->imtMt, (uint16_t)index))
     {
-        iccid = simStatus.iccid;
+        acknowledged = true;
     }
-    return iccid;
+    return acknowledged;
 }
 
-static bool getFirmwareInfo(jsprFirmwareInfo_t * fwInfo)
+static void handleMessageOriginate(rbDevice_t * device)
 {
-    bool populated = false;
-    jsprGetFirmware(JSPR_BOOT_SOURCE_PRIMARY);
-    receiveJspr(&response, "firmware");
-    if(JSPR_RC_NO_ERROR == response.code && strcmp(response.target, "firmware") == 0)
+    jsprMessageOriginate_t messageOriginate;
+    bool parsed;
+    int index = -1;
+    int oldest = -1;
+
+    memset(&messageOriginate, 0, sizeof(jsprMessageOriginate_t));
+    parsed = parseJsprPutMessageOriginate(device->response.json, &messageOriginate);
+    for(uint16_t i = 0; i < device->moInFlight && index < 0; i++)
     {
-        if(parseJsprFirmwareInfo(response.json, fwInfo))
+        imt_t * imtMo = imtQueueGetAt(&device->imtMo, i);
+        if(!imtMo->idSet)
         {
-            populated = true;
+            if(parsed && imtMo->requestReference == messageOriginate.requestReference)
+            {
+                index = (int)i;
+            }
+            else if(oldest < 0)
+            {
+                oldest = (int)i;
+            }
         }
     }
-    else
+    if(index < 0)
     {
-        printf("Failed\n");
+        index = oldest; //replies come back in order, an error may not carry the reference
+    }
+    if(index >= 0)
+    {
+        imt_t * imtMo = imtQueueGetAt(&device->imtMo, (uint16_t)index);
+        if(JSPR_RC_NO_ERROR == device->response.code && parsed && messageOriginate.messageIdSet)
+        {
+            imtMo->id = messageOriginate.messageId;
+            imtMo->idSet = true;
+        }
+        else
+        {
+            finishMo(device, (uint16_t)index, RB_MSG_STATUS_FAIL); //refused by the modem
+        }
     }
-    return populated;
 }
 
-char * rbGetFirmwareVersion(void)
+static void handleMessageOriginateSegment(rbDevice_t * device)
 {
-    if(getFirmwareInfo(&firmwareInfo))
+    int index;
+    imt_t * imtMo;
+    jsprMessageOriginateSegment_t messageOriginateSegment;
+
+    memset(&messageOriginateSegment, 0, sizeof(jsprMessageOriginateSegment_t));
+    if(parseJsprUnsMessageOriginateSegment(device->response.json, &messageOriginateSegment))
     {
-        snprintf(firmwareVersion, FIRMWARE_VERSION_STRING_LEN,"v%u.%u.%u",
-            firmwareInfo.versionInfo.version.major, 
-            firmwareInfo.versionInfo.version.minor,
-            firmwareInfo.versionInfo.version.patch);
+        index = findMo(device, messageOriginateSegment.messageId);
+        if(index >= 0)
+        {
+            imtMo = imtQueueGetAt(&device->imtMo, (uint16_t)index);
+            if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
+            {
+                if(messageOriginateSegment.topic == imtMo->topic)
+                {
+                    sendMoSegment(device, imtMo, messageOriginateSegment.segmentStart, messageOriginateSegment.segmentLength);
+                }
+            }
+            else if(JSPR_RC_NO_ERROR != device->response.code)
+            {
+                finishMo(device, (uint16_t)index, RB_MSG_STATUS_FAIL); //drop message
+            }
+        }
     }
-    else
+}
+
+static void handleMessageOriginateStatus(rbDevice_t * device)
+{
+    int index;
+
+    if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
     {
-        firmwareVersion[0] = '\0';
+        jsprMessageOriginateStatus_t messageOriginateStatus;
+        memset(&messageOriginateStatus, 0, sizeof(jsprMessageOriginateStatus_t));
+        if(parseJsprUnsMessageOriginateStatus(device->response.json, &messageOriginateStatus))
+        {
+            index = findMo(device, messageOriginateStatus.messageId);
+            if(index >= 0)
+            {
+                finishMo(device, (uint16_t)index, (messageOriginateStatus.finalMoStatus == MO_ACK_RECEIVED_MOS) ?
+                         RB_MSG_STATUS_OK : RB_MSG_STATUS_FAIL);
+            }
+        }
     }
+}
+
+static void handleMessageTerminate(rbDevice_t * device)
+{
+    bool mtQueued;
 
-    return firmwareVersion;
+    if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
+    {
+        jsprMessageTerminate_t messageTerminate;
+        memset(&messageTerminate, 0, sizeof(jsprMessageTerminate_t));
+        if(parseJsprUnsMessageTerminate(device->response.json, &messageTerminate) && messageTerminate.messageLengthMax > 0)
+        {
+            mtQueued = imtQueueMtAdd(&device->imtMt, messageTerminate.topic, messageTerminate.messageId, messageTerminate.messageLengthMax);
+            imt_t * imtMt = imtQueueGetLast(&device->imtMt);
+            if (mtQueued) //returns -1 if que is full, no free spots to store mt
+            {
+                if(imtMt != NULL)
+                {
+                    imtMt->readyToProcess = true;
+                }
+            }
+            else
+            {
+                reportMt(device, messageTerminate.messageId, RB_MSG_STATUS_FAIL);
+            }
+        }
+    }
 }
 
-bool rbResyncServiceConfig(void)
+static void handleMessageTerminateSegment(rbDevice_t * device)
 {
-    bool rVal = false;
-    bool isInactive = false;
-    bool wasActive = false;
-    jsprOperationalState_t state;
+    int segmentStartMt;
+    int segmentLengthMt;
+    int decodedBytes;
 
-    if(jsprGetOperationalState())
+    if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
     {
-        // Wait for 200 Operational State
-        if (waitForJsprMessage(&response, "operationalState", JSPR_RC_NO_ERROR, 1) == true)
+        jsprMessageTerminateSegment_t messageTerminateSegment;
+        memset(&messageTerminateSegment, 0, sizeof(jsprMessageTerminateSegment_t));
+        const bool parsed = parseJsprUnsMessageTerminateSegment(device->response.json, &messageTerminateSegment);
+        const int index = messageTerminateSegment.messageIdSet ? findMt(device, messageTerminateSegment.messageId) : -1;
+        if(index >= 0 && !parsed)
         {
-            parseJsprGetOperationalState(response.json, &state);
-            if (state.operationalState == INACTIVE)
+            failMt(device, (uint16_t)index, RB_MSG_STATUS_FAIL); //malformed line, the segment is lost
+        }
+        else if(index >= 0)
+        {
+            imt_t * imtMt = imtQueueGetAt(&device->imtMt, (uint16_t)index);
+            segmentStartMt = messageTerminateSegment.segmentStart;
+            segmentLengthMt = messageTerminateSegment.segmentLength;
+            decodedBytes = -1;
+            if(segmentStartMt >= 0 && segmentLengthMt > 0 && imtMt->buffer != NULL &&
+               (size_t)(segmentStartMt + segmentLengthMt) <= imtMt->capacity)
             {
-                isInactive = true;
+                decodedBytes = decodeData(messageTerminateSegment.data, messageTerminateSegment.dataLength, 
+                (char*)imtMt->buffer + segmentStartMt, segmentLengthMt);
             }
-            else if (state.operationalState == ACTIVE)
+            //recorded only once decoded in full, a short segment would count stale bytes as received
+            if(decodedBytes == segmentLengthMt &&
+               imtQueueMtSegment(&device->imtMt, imtMt, (size_t)segmentStartMt, (size_t)segmentLengthMt))
             {
-                wasActive = true;
-                putOperationalState(INACTIVE);
-                // Look for 299 Operational State, this indicates it is actually inactive
-                if (waitForJsprMessage(&response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                if((size_t)(segmentStartMt + segmentLengthMt) > imtMt->used)
                 {
-                    parseJsprGetOperationalState(response.json, &state);
-                    isInactive = state.operationalState == INACTIVE;
+                    imtMt->used = segmentStartMt + segmentLengthMt;
+                }
+                if((size_t)segmentStartMt == imtMt->crcOffset)
+                {
+                    //fold the segment into the CRC while it is still in cache
+                    imtMt->crcRunning = crc16Update(imtMt->crcRunning, imtMt->buffer + segmentStartMt, segmentLengthMt);
+                    imtMt->crcOffset += segmentLengthMt;
                 }
             }
+            else
+            {
+                failMt(device, (uint16_t)index, RB_MSG_STATUS_FAIL);
+            }
         }
     }
+}
 
-    if (isInactive == true)
+static void handleMessageTerminateStatus(rbDevice_t * device)
+{
+    if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
     {
-        if (jsprPutServiceConfig(true) == true)
+        jsprMessageTerminateStatus_t messageTerminateStatus;
+        if(parseJsprUnsMessageTerminateStatus(device->response.json, &messageTerminateStatus))
         {
-            if (waitForJsprMessage(&response, "serviceConfig", JSPR_RC_NO_ERROR, 1) == true)
+            const int index = findMt(device, messageTerminateStatus.messageId);
+            if(index >= 0)
             {
-                if (wasActive != true)
+                imt_t * imtMt = imtQueueGetAt(&device->imtMt, (uint16_t)index);
+                if(messageTerminateStatus.finalMtStatus == COMPLETE)
                 {
-                    rVal = true;
+                    imtMt->length = imtMt->used;
+                }
+                if(messageTerminateStatus.finalMtStatus != COMPLETE || imtMt->received != imtMt->used)
+                {
+                    failMt(device, (uint16_t)index, RB_MSG_STATUS_FAIL); //failed, or a segment never arrived
+                }
+                else if(!verifyMtCrc(imtMt))
+                {
+                    failMt(device, (uint16_t)index, RB_MSG_STATUS_CRC_ERROR);
+                }
+                else if(!decodeMt(device, imtMt))
+                {
+                    failMt(device, (uint16_t)index, RB_MSG_STATUS_FAIL); //unknown header or corrupt compressed data
                 }
                 else
                 {
-                    putOperationalState(ACTIVE);
-                    // Look for 299 Operational State, this indicates it is actually active again
-                    if (waitForJsprMessage(&response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                    imtMt->ready = true;
+                    if(!reportMt(device, imtMt->id, RB_MSG_STATUS_OK))
                     {
-                        parseJsprGetOperationalState(response.json, &state);
-                        rVal = (state.operationalState == ACTIVE);
+                        device->mtReceived = true;
                     }
+#ifdef RB_IO_THREAD
+                    deliverMt(device, imtMt);
+#endif
                 }
             }
         }
     }
-
-    return rVal;
 }
 
-static uint16_t calculateCrc(const uint8_t * buffer, const size_t bufferLength, const uint16_t initialCRC)
+static void handleConstellationState(rbDevice_t * device)
 {
-    uint16_t crc = (uint16_t)initialCRC;
-    uint8_t data = 0;
-    size_t tableIndex = 0;
-    if (buffer != 0)
+    if(JSPR_RC_UNSOLICITED_MESSAGE == device->response.code)
     {
-        for (size_t i = 0; i < bufferLength; i++)
+        jsprConstellationState_t constellationState;
+        if(parseJsprGetSignal(device->response.json, &constellationState))
         {
-            data = ((uint8_t *)buffer)[i];
-            tableIndex = (((crc >> 8) ^ data) & 0xFF);
-            crc = (((crc << 8) ^ CRC16Table[tableIndex]) & 0xFFFF);
+            reportConstellation(device, &constellationState);
         }
     }
-    return (crc);
 }
 
-bool rbEnd(void)
+static void handleOtherTarget(rbDevice_t * device)
 {
-    bool deinitialised = false;
-    if(context.serialDeInit())
+    for(size_t i = 0; i < RB_MAX_TARGET_HANDLERS; i++)
     {
-        deinitialised = true;
-        serialState = CLOSED;
+        const rbTargetHandlerEntry_t * entry = &device->targetHandlers[i];
+        if(entry->handler != NULL && strcmp(entry->target, device->response.target) == 0)
+        {
+            entry->handler(device->response.code, device->response.target, device->response.json, entry->context);
+        }
+    }
+}
+
+static void pollDevice(rbDevice_t * device)
+{
+    if(pollJspr(&device->jspr, &device->response))
+    {
+        switch(device->response.targetId)
+        {
+            case JSPR_TARGET_MESSAGE_ORIGINATE:
+                handleMessageOriginate(device);
+                break;
+            case JSPR_TARGET_MESSAGE_ORIGINATE_SEGMENT:
+                handleMessageOriginateSegment(device);
+                break;
+            case JSPR_TARGET_MESSAGE_ORIGINATE_STATUS:
+                handleMessageOriginateStatus(device);
+                break;
+            case JSPR_TARGET_MESSAGE_TERMINATE:
+                handleMessageTerminate(device);
+                break;
+            case JSPR_TARGET_MESSAGE_TERMINATE_SEGMENT:
+                handleMessageTerminateSegment(device);
+                break;
+            case JSPR_TARGET_MESSAGE_TERMINATE_STATUS:
+                handleMessageTerminateStatus(device);
+                break;
+            case JSPR_TARGET_CONSTELLATION_STATE:
+                handleConstellationState(device);
+                break;
+            default:
+                handleOtherTarget(device);
+                break;
+        }
+    }
+#ifdef RB_MO_JOURNAL
+    feedJournal(device);
+#endif
+}
+
+void rbDevicePoll(rbDevice_t * device)
+{
+    pollDevice(device);
+    flushDueBatches(device);
+}
+
+bool rbDeviceRegisterTargetHandler(rbDevice_t * device, const char * target, rbTargetHandler handler, void * context)
+{
+    bool registered = false;
+    rbTargetHandlerEntry_t * slot = NULL;
+
+    if(target != NULL && strlen(target) < JSPR_MAX_TARGET_LENGTH)
+    {
+        for(size_t i = 0; i < RB_MAX_TARGET_HANDLERS && slot == NULL; i++)
+        {
+            if(device->targetHandlers[i].handler != NULL && strcmp(device->targetHandlers[i].target, target) == 0)
+            {
+                slot = &device->targetHandlers[i]; //replace, or remove with a NULL handler
+            }
+        }
+        for(size_t i = 0; i < RB_MAX_TARGET_HANDLERS && slot == NULL && handler != NULL; i++)
+        {
+            if(device->targetHandlers[i].handler == NULL)
+            {
+                slot = &device->targetHandlers[i];
+            }
+        }
+        if(slot != NULL)
+        {
+            strcpy(slot->target, target);
+            slot->handler = handler;
+            slot->context = context;
+            registered = true;
+        }
+        else
+        {
+            registered = (handler == NULL); //nothing to remove
+        }
+    }
+    return registered;
+}
+
+bool rbDeviceSetTopicCodec(rbDevice_t * device, const uint16_t topic, const rbCodec_t * codec)
+{
+    bool set = false;
+    rbTopicCodecEntry_t * slot = NULL;
+
+    if(codec == NULL || codec->id != RB_CODEC_STORED)
+    {
+        for(size_t i = 0; i < RB_MAX_TOPIC_CODECS && slot == NULL; i++)
+        {
+            if(device->topicCodecs[i].codec != NULL && device->topicCodecs[i].topic == topic)
+            {
+                slot = &device->topicCodecs[i]; //replace, or remove with a NULL codec
+            }
+        }
+        for(size_t i = 0; i < RB_MAX_TOPIC_CODECS && slot == NULL && codec != NULL; i++)
+        {
+            if(device->topicCodecs[i].codec == NULL)
+            {
+                slot = &device->topicCodecs[i];
+            }
+        }
+        if(slot != NULL)
+        {
+            slot->topic = topic;
+            slot->codec = codec;
+            set = true;
+        }
+        else
+        {
+            set = (codec == NULL); //nothing to remove
+        }
+    }
+    return set;
+}
+
+uint32_t rbDeviceGetBaud(rbDevice_t * device)
+{
+    return device->context.serialBaud;
+}
+
+void rbDeviceSetReadTimeout(rbDevice_t * device, const uint32_t timeoutUs)
+{
+    device->context.serialReadTimeoutUs = timeoutUs;
+}
+
+bool rbDeviceWaitForEvent(rbDevice_t * device, const uint32_t timeoutMs)
+{
+    const bool ready = waitJspr(&device->jspr, batchWaitMs(device, timeoutMs)); //wake up for the next batch due
+    flushDueBatches(device);
+    return ready;
+}
+
+void rbDeviceWakeEvent(rbDevice_t * device)
+{
+    if(device->context.serialWake != NULL)
+    {
+        device->context.serialWake(&device->context);
+    }
+}
+
+int8_t rbDeviceGetSignal(rbDevice_t * device)
+{
+    int8_t signal = -1;
+    jsprGetSignal(&device->jspr);
+    waitForJsprMessage(&device->jspr, &device->response, "constellationState", JSPR_RC_NO_ERROR, 1);
+    if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "constellationState") == 0)
+    {
+        jsprConstellationState_t conState;
+        if(parseJsprGetSignal(device->response.json, &conState))
+        {
+            if(conState.signalBars >= 0 && conState.signalBars <= 5)
+            {
+                signal = conState.signalBars;
+            }
+        }
+    }
+    return signal;
+}
+
+static bool getHwInfo(rbDevice_t * device, jsprHwInfo_t * hwInfo)
+{
+    bool populated = false;
+    jsprGetHwInfo(&device->jspr);
+    receiveJspr(&device->jspr, &device->response, "hwInfo");
+    if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "hwInfo") == 0)
+    {
+        if(parseJsprGetHwInfo(&device->jspr, device->response.json, hwInfo))
+        {
+            populated = true;
+        }
+    }
+    return populated;
+}
+
+char * rbDeviceGetImei(rbDevice_t * device)
+{
+    char * imei = NULL;
+    if(getHwInfo(device, &device->hwInfo))
+    {
+        imei = device->hwInfo.imei;
+    }
+    return imei;
+}
+
+char * rbDeviceGetHwVersion(rbDevice_t * device)
+{
+    char * hwVersion = NULL;
+    if(getHwInfo(device, &device->hwInfo))
+    {
+        hwVersion = device->hwInfo.hwVersion;
+    }
+    return hwVersion;
+}
+
+char * rbDeviceGetSerialNumber(rbDevice_t * device)
+{
+    char * serialNumber = NULL;
+    if(getHwInfo(device, &device->hwInfo))
+    {
+        serialNumber = device->hwInfo.serialNumber;
+    }
+    return serialNumber;
+}
+
+int8_t rbDeviceGetBoardTemp(rbDevice_t * device)
+{
+    int8_t boardTemp = -100; //needs to be some value that the temp can't be
+    jsprHwInfo_t hwInfo;
+    if(getHwInfo(device, &hwInfo))
+    {
+        boardTemp = hwInfo.boardTemp;
+    }
+    return boardTemp;
+}
+
+static bool getSimStatus(rbDevice_t * device, jsprSimStatus_t * simStatus)
+{
+    bool populated = false;
+    jsprGetSimStatus(&device->jspr);
+    receiveJspr(&device->jspr, &device->response, "simStatus");
+    if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "simStatus") == 0)
+    {
+        if(parseJsprGetSimStatus(&device->jspr, device->response.json, simStatus))
+        {
+            populated = true;
+        }
+    }
+    return populated;
+}
+
+bool rbDeviceGetCardPresent(rbDevice_t * device)
+{
+    bool cardPresent = false;
+    if(getSimStatus(device, &device->simStatus))
+    {
+        cardPresent = device->simStatus.cardPresent;
+    }
+    return cardPresent;
+}
+
+bool rbDeviceGetSimConnected(rbDevice_t * device)
+{
+    bool simConnected = false;
+    if(getSimStatus(device, &device->simStatus))
+    {
+        simConnected = device->simStatus.simConnected;
+    }
+    return simConnected;
+}
+
+char * rbDeviceGetIccid(rbDevice_t * device)
+{
+    char * iccid = NULL;
+    if(getSimStatus(device, &device->simStatus))
+    {
+        iccid = device->simStatus.iccid;
+    }
+    return iccid;
+}
+
+static bool getFirmwareInfo(rbDevice_t * device, jsprFirmwareInfo_t * fwInfo)
+{
+    bool populated = false;
+    jsprGetFirmware(&device->jspr, JSPR_BOOT_SOURCE_PRIMARY);
+    receiveJspr(&device->jspr, &device->response, "firmware");
+    if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "firmware") == 0)
+    {
+        if(parseJsprFirmwareInfo(&device->jspr, device->response.json, fwInfo))
+        {
+            populated = true;
+        }
+    }
+    else
+    {
+        printf("Failed\n");
+    }
+    return populated;
+}
+
+char * rbDeviceGetFirmwareVersion(rbDevice_t * device)
+{
+    if(getFirmwareInfo(device, &device->firmwareInfo))
+    {
+        snprintf(device->firmwareVersion, FIRMWARE_VERSION_STRING_LEN,"v%u.%u.%u",
+            device->firmwareInfo.versionInfo.version.major, 
+            device->firmwareInfo.versionInfo.version.minor,
+            device->firmwareInfo.versionInfo.version.patch);
+    }
+    else
+    {
+        device->firmwareVersion[0] = '\0';
+    }
+
+    return device->firmwareVersion;
+}
+
+size_t rbDeviceGetJsonArenaHighWater(rbDevice_t * device)
+{
+    return device->jspr.jsonArenaHighWater;
+}
+
+#ifdef RB_MO_JOURNAL
+size_t rbDeviceGetMoJournalBacklog(rbDevice_t * device)
+{
+    return device->moJournal.live;
+}
+
+static void feedJournal(rbDevice_t * device)
+{
+    uint16_t topic;
+    const char * data;
+    size_t length;
+
+    while(device->imtMo.count < device->imtMo.maxLength && moJournalPeek(&device->moJournal, &topic, &data, &length))
+    {
+        if(!checkProvisioning(device, topic))
+        {
+            if(!device->messageProvisioningInfo.provisioningSet)
+            {
+                break; //provisioning unknown, tried again on the next poll
+            }
+            moJournalAdvance(&device->moJournal);
+            moJournalRetire(&device->moJournal, data); //topic isn't provisioned, can never be sent
+        }
+        else if(queueBorrowedMo(device, topic, data, length, retireJournalMo, device)) //batched topics were framed when journalled
+        {
+            moJournalAdvance(&device->moJournal);
+        }
+        else
+        {
+            break; //stays in the journal, tried again on the next poll
+        }
+    }
+}
+
+static void retireJournalMo(const char * data, void * context)
+{
+    rbDevice_t * device = (rbDevice_t *)context;
+    moJournalRetire(&device->moJournal, data); //does nothing once the journal is closed
+}
+#endif
+
+bool rbDeviceResyncServiceConfig(rbDevice_t * device)
+{
+    bool rVal = false;
+    bool isInactive = false;
+    bool wasActive = false;
+    jsprOperationalState_t state;
+
+    if(jsprGetOperationalState(&device->jspr))
+    {
+        // Wait for 200 Operational State
+        if (waitForJsprMessage(&device->jspr, &device->response, "operationalState", JSPR_RC_NO_ERROR, 1) == true)
+        {
+            parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
+            if (state.operationalState == INACTIVE)
+            {
+                isInactive = true;
+            }
+            else if (state.operationalState == ACTIVE)
+            {
+                wasActive = true;
+                putOperationalState(&device->jspr, INACTIVE);
+                // Look for 299 Operational State, this indicates it is actually inactive
+                if (waitForJsprMessage(&device->jspr, &device->response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                {
+                    parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
+                    isInactive = state.operationalState == INACTIVE;
+                }
+            }
+        }
+    }
+
+    if (isInactive == true)
+    {
+        if (jsprPutServiceConfig(&device->jspr, true) == true)
+        {
+            if (waitForJsprMessage(&device->jspr, &device->response, "serviceConfig", JSPR_RC_NO_ERROR, 1) == true)
+            {
+                if (wasActive != true)
+                {
+                    rVal = true;
+                }
+                else
+                {
+                    putOperationalState(&device->jspr, ACTIVE);
+                    // Look for 299 Operational State, this indicates it is actually active again
+                    if (waitForJsprMessage(&device->jspr, &device->response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                    {
+                        parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
+                        rVal = (state.operationalState == ACTIVE);
+                    }
+                }
+            }
+        }
+    }
+
+    return rVal;
+}
+
+bool rbDeviceEnd(rbDevice_t * device)
+{
+    bool deinitialised = false;
+    rbDeviceFlushBatches(device); //into the MO queue, and the journal when there is one
+#ifdef RB_MO_JOURNAL
+    moJournalClose(&device->moJournal); //unfinished MOs are replayed by the next rbDeviceBegin()
+#endif
+    if(device->context.serialDeInit != NULL && device->context.serialDeInit(&device->context))
+    {
+        deinitialised = true;
+        device->context.serialState = CLOSED;
     }
     return deinitialised;
 }
 
-static bool checkProvisioning(uint16_t topic)
+static bool checkProvisioning(rbDevice_t * device, uint16_t topic)
 {
     bool provisioned = false;
     int count = 0;
 
     if(topic >= IMT_MIN_TOPIC_ID && topic <= IMT_MAX_TOPIC_ID)
     {
-        if (messageProvisioningInfo.provisioningSet)
+        if (device->messageProvisioningInfo.provisioningSet)
         {
-            count = messageProvisioningInfo.topicCount;
+            count = device->messageProvisioningInfo.topicCount;
             if(count > 0)
             {
                 for (int i = 0; i < count && i < JSPR_MAX_TOPICS; i++)
                 {
-                    if(messageProvisioningInfo.provisioning[i].topicId == topic)
+                    if(device->messageProvisioningInfo.provisioning[i].topicId == topic)
                     {
                         provisioned = true;
                     }
@@ -1152,22 +2427,19 @@ static bool checkProvisioning(uint16_t topic)
         }
         else
         {
-            if(jsprGetMessageProvisioning())
+            if(jsprGetMessageProvisioning(&device->jspr))
             {
-                receiveJspr(&response, "messageProvisioning");
-                if(JSPR_RC_NO_ERROR == response.code && strcmp(response.target, "messageProvisioning") == 0)
+                receiveJspr(&device->jspr, &device->response, "messageProvisioning");
+                if(JSPR_RC_NO_ERROR == device->response.code && strcmp(device->response.target, "messageProvisioning") == 0)
                 {
                     jsprMessageProvisioning_t messageProvisioning;
-                    if(parseJsprGetMessageProvisioning(response.json, &messageProvisioning))
+                    if(parseJsprGetMessageProvisioning(&device->jspr, device->response.json, &messageProvisioning))
                     {
                         if(messageProvisioning.provisioningSet)
                         {
-                            if(rbCallbacks && rbCallbacks->messageProvisioning)
-                            {
-                                rbCallbacks->messageProvisioning(&messageProvisioning);
-                            }
+                            reportProvisioning(device, &messageProvisioning);
                         }
-                        messageProvisioningInfo = messageProvisioning;
+                        device->messageProvisioningInfo = messageProvisioning;
                         count = messageProvisioning.topicCount;
                         if(count > 0)
                         {
@@ -1195,7 +2467,7 @@ struct k_response kermitResponse;
 int kermitStatus = 0;
 unsigned char i_buf[IBUFLEN+8];
 
-bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progress, void * context)
+bool rbDeviceUpdateFirmware (rbDevice_t * device, const char * firmwareFile, updateProgressCallback progress, void * context)
 {
     const char * firmwareFileList[2] = {firmwareFile, NULL};
     unsigned char *inputBufferPtr = (unsigned char *)0; // E-Kermit doesn't like NULL
@@ -1222,19 +2494,19 @@ bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progres
         return firmwareUpdated;
     }
 
-    if(jsprGetOperationalState())
+    if(jsprGetOperationalState(&device->jspr))
     {
         // Wait for 200 Operational State
-        if (waitForJsprMessage(&response, "operationalState", JSPR_RC_NO_ERROR, 1) == true)
+        if (waitForJsprMessage(&device->jspr, &device->response, "operationalState", JSPR_RC_NO_ERROR, 1) == true)
         {
-            parseJsprGetOperationalState(response.json, &state);
+            parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
             if (state.operationalState != INACTIVE)
             {
-                putOperationalState(INACTIVE);
+                putOperationalState(&device->jspr, INACTIVE);
                 // Look for 299 Operational State, this indicates it is actually inactive
-                if (waitForJsprMessage(&response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
+                if (waitForJsprMessage(&device->jspr, &device->response, "operationalState", JSPR_RC_UNSOLICITED_MESSAGE, 1) == true)
                 {
-                    parseJsprGetOperationalState(response.json, &state);
+                    parseJsprGetOperationalState(&device->jspr, device->response.json, &state);
                     isInactive = state.operationalState == INACTIVE;
                 }
             }
@@ -1248,20 +2520,21 @@ bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progres
 
     if (isInactive == true)
     {
-        if (jsprPutFirmware(JSPR_BOOT_SOURCE_PRIMARY))
+        if (jsprPutFirmware(&device->jspr, JSPR_BOOT_SOURCE_PRIMARY))
         {
-            if(receiveJspr(&response, "firmware"))
+            if(receiveJspr(&device->jspr, &device->response, "firmware"))
             {
-                if(JSPR_RC_NO_ERROR == response.code)
+                if(JSPR_RC_NO_ERROR == device->response.code)
                 {
-                    isInKermitMode = parseJsprFirmwareInfo(response.json, &firmware);
+                    isInKermitMode = parseJsprFirmwareInfo(&device->jspr, device->response.json, &firmware);
                 }
             }
         }
     }
 
     if (isInKermitMode == true)
-    {;
+    {
+        kermit_io_set_context(&device->context);
         kermit_io_init_string();
 
         delay(1000);
@@ -1351,4 +2624,497 @@ bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progres
 
     return firmwareUpdated;
 }
-#endif
\ No newline at end of file
+#endif
+#ifdef RB_IO_THREAD
+static void deliverMt(rbDevice_t * device, imt_t * imtMt)
+{
+    if(atomic_load(&device->ioRunning))
+    {
+        rbMessage_t message;
+        message.id = imtMt->id;
+        message.topic = imtMt->topic;
+        message.length = (imtMt->length > IMT_CRC_SIZE) ? (imtMt->length - IMT_CRC_SIZE) : 0;
+        imtMt->buffer[message.length] = '\0'; //remove crc
+        message.data = (const char *)imtMt->buffer;
+        imtMt->readyToProcess = false; //handed over to the application
+        imtMt->sequence = ++device->mtDeliveries;
+        spscQueuePush(&device->mtDeliver, &message); //can't be full, it has a slot per MT queue entry
+    }
+}
+
+static void releaseMt(rbDevice_t * device)
+{
+    int index = -1;
+    for(uint16_t i = 0; i < device->imtMt.count; i++)
+    {
+        imt_t * imtMt = imtQueueGetAt(&device->imtMt, i);
+        if(imtMt->sequence != 0 && (index < 0 || imtMt->sequence < imtQueueGetAt(&device->imtMt, (uint16_t)index)->sequence))
+        {
+            index = (int)i; //MTs are taken and released in the order they were delivered
+        }
+    }
+    if(index >= 0)
+    {
+        imtQueueRemoveAt(&device->imtMt, (uint16_t)index);
+    }
+}
+
+static void discardSubmission(rbIoSubmission_t * submission, bool queued)
+{
+    if(!submission->borrowed)
+    {
+        free(submission->data);
+    }
+    else if(!queued && submission->release != NULL)
+    {
+        submission->release(submission->data, submission->releaseContext); //never reached the MO queue
+    }
+}
+
+static void * ioThreadMain(void * arg)
+{
+    rbDevice_t * device = (rbDevice_t *)arg;
+    rbIoSubmission_t submission;
+
+    while(atomic_load(&device->ioRunning))
+    {
+        while(spscQueuePop(&device->mtRelease, NULL))
+        {
+            releaseMt(device);
+        }
+        while(device->imtMo.count < device->imtMo.maxLength && spscQueuePop(&device->moSubmit, &submission))
+        {
+            bool queued;
+            if(submission.borrowed)
+            {
+                queued = rbDeviceSendMessageBorrowedAsync(device, submission.topic, submission.data, submission.length,
+                                                          submission.release, submission.releaseContext);
+            }
+            else
+            {
+                queued = rbDeviceSendMessageAsync(device, submission.topic, submission.data, submission.length);
+            }
+            if(!queued)
+            {
+                reportSubmitFailed(device, submission.topic, submission.data, submission.length);
+            }
+            discardSubmission(&submission, queued);
+        }
+        if(rbDeviceWaitForEvent(device, RB_IO_THREAD_IDLE_MS))
+        {
+            rbDevicePoll(device);
+        }
+    }
+    return NULL;
+}
+
+bool rbDeviceStartIoThread(rbDevice_t * device)
+{
+    bool started = false;
+    if(device->context.serialState == OPEN && !atomic_load(&device->ioRunning) && device->imtMt.maxLength > 0)
+    {
+        device->mtDeliverSlots = (rbMessage_t *)malloc(device->imtMt.maxLength * sizeof(rbMessage_t));
+        device->mtReleaseSlots = (uint8_t *)malloc(device->imtMt.maxLength);
+        if(device->mtDeliverSlots != NULL && device->mtReleaseSlots != NULL)
+        {
+            spscQueueInit(&device->moSubmit, device->moSubmitSlots, sizeof(rbIoSubmission_t), RB_IO_QUEUE_SIZE);
+            spscQueueInit(&device->mtDeliver, device->mtDeliverSlots, sizeof(rbMessage_t), device->imtMt.maxLength);
+            spscQueueInit(&device->mtRelease, device->mtReleaseSlots, sizeof(uint8_t), device->imtMt.maxLength);
+            device->ioMtWasLocked = device->imtMt.locked;
+            imtQueueLock(&device->imtMt, true); //delivered MTs must stay put until released
+
+            atomic_store(&device->ioRunning, true);
+            if(pthread_create(&device->ioThread, NULL, ioThreadMain, device) == 0)
+            {
+                started = true;
+            }
+            else
+            {
+                atomic_store(&device->ioRunning, false);
+                imtQueueLock(&device->imtMt, device->ioMtWasLocked);
+            }
+        }
+        if(!started)
+        {
+            freeIoSlots(device);
+        }
+    }
+    return started;
+}
+
+static void freeIoSlots(rbDevice_t * device)
+{
+    free(device->mtDeliverSlots);
+    free(device->mtReleaseSlots);
+    device->mtDeliverSlots = NULL;
+    device->mtReleaseSlots = NULL;
+}
+
+bool rbDeviceStopIoThread(rbDevice_t * device)
+{
+    bool stopped = false;
+    rbIoSubmission_t submission;
+    if(atomic_load(&device->ioRunning))
+    {
+        atomic_store(&device->ioRunning, false);
+        rbDeviceWakeEvent(device);
+        if(pthread_join(device->ioThread, NULL) == 0)
+        {
+            while(spscQueuePop(&device->moSubmit, &submission))
+            {
+                discardSubmission(&submission, false);
+            }
+            while(spscQueuePop(&device->mtRelease, NULL))
+            {
+                releaseMt(device);
+            }
+            while(spscQueuePop(&device->mtDeliver, NULL))
+            {
+                //left in the MT queue, still reachable with rbReceiveMessageAsync()
+            }
+            imtQueueLock(&device->imtMt, device->ioMtWasLocked);
+            freeIoSlots(device);
+            stopped = true;
+        }
+    }
+    return stopped;
+}
+
+bool rbDeviceSubmitMessage(rbDevice_t * device, uint16_t topic, const char * data, const size_t length)
+{
+    bool submitted = false;
+    rbIoSubmission_t submission;
+    if(atomic_load(&device->ioRunning) && data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+    {
+        submission.topic = topic;
+        submission.length = length;
+        submission.borrowed = false;
+        submission.release = NULL;
+        submission.releaseContext = NULL;
+        submission.data = (char *)malloc(length);
+        if(submission.data != NULL)
+        {
+            memcpy(submission.data, data, length);
+            submitted = spscQueuePush(&device->moSubmit, &submission);
+            if(submitted)
+            {
+                rbDeviceWakeEvent(device);
+            }
+            else
+            {
+                free(submission.data);
+            }
+        }
+    }
+    return submitted;
+}
+
+bool rbDeviceSubmitMessageBorrowed(rbDevice_t * device, uint16_t topic, const char * data, const size_t length,
+                                   rbReleaseCallback release, void * context)
+{
+    bool submitted = false;
+    rbIoSubmission_t submission;
+    if(atomic_load(&device->ioRunning) && data != NULL && length > 0 && length <= IMT_PAYLOAD_SIZE - IMT_CRC_SIZE)
+    {
+        submission.topic = topic;
+        submission.length = length;
+        submission.data = (char *)data;
+        submission.borrowed = true;
+        submission.release = release;
+        submission.releaseContext = context;
+        submitted = spscQueuePush(&device->moSubmit, &submission);
+        if(submitted)
+        {
+            rbDeviceWakeEvent(device);
+        }
+    }
+    return submitted;
+}
+
+bool rbDeviceTakeMessage(rbDevice_t * device, rbMessage_t * message)
+{
+    bool taken = false;
+    if(message != NULL)
+    {
+        taken = spscQueuePop(&device->mtDeliver, message);
+    }
+    return taken;
+}
+
+bool rbDeviceReleaseMessage(rbDevice_t * device)
+{
+    const uint8_t release = 1;
+    bool released = spscQueuePush(&device->mtRelease, &release);
+    if(released)
+    {
+        rbDeviceWakeEvent(device);
+    }
+    return released;
+}
+#endif
+
+// Single device API, kept for existing applications, everything acts on rbDefaultDevice()
+
+#ifndef ARDUINO
+bool rbBegin(const char * port)
+{
+    return rbDeviceBegin(rbDefaultDevice(), port);
+}
+#endif
+
+bool rbEnd(void)
+{
+    return rbDeviceEnd(rbDefaultDevice());
+}
+
+void rbRegisterCallbacks(const rbCallbacks_t *callbacks)
+{
+    rbDeviceRegisterCallbacks(rbDefaultDevice(), callbacks);
+}
+
+bool rbRegisterTargetHandler(const char * target, rbTargetHandler handler, void * context)
+{
+    return rbDeviceRegisterTargetHandler(rbDefaultDevice(), target, handler, context);
+}
+
+#ifndef ARDUINO
+bool rbProbeBaud(const uint32_t * rates, const size_t count, rbBaudProbe_t * results)
+{
+    return rbDeviceProbeBaud(rbDefaultDevice(), rates, count, results);
+}
+
+bool rbMeasureLatency(const uint32_t roundTrips, rbLatency_t * result)
+{
+    return rbDeviceMeasureLatency(rbDefaultDevice(), roundTrips, result);
+}
+#endif
+
+uint32_t rbGetBaud(void)
+{
+    return rbDeviceGetBaud(rbDefaultDevice());
+}
+
+void rbSetReadTimeout(const uint32_t timeoutUs)
+{
+    rbDeviceSetReadTimeout(rbDefaultDevice(), timeoutUs);
+}
+
+bool rbSetTopicCodec(const uint16_t topic, const rbCodec_t * codec)
+{
+    return rbDeviceSetTopicCodec(rbDefaultDevice(), topic, codec);
+}
+
+bool rbSendMessage(const char * data, const size_t length, const int timeout)
+{
+    return rbDeviceSendMessage(rbDefaultDevice(), data, length, timeout);
+}
+
+bool rbSendMessageCloudloop(cloudloopTopics_t topic, const char * data, const size_t length, const int timeout)
+{
+    return rbDeviceSendMessageCloudloop(rbDefaultDevice(), topic, data, length, timeout);
+}
+
+bool rbSendMessageAny(uint16_t topic, const char * data, const size_t length, const int timeout)
+{
+    return rbDeviceSendMessageAny(rbDefaultDevice(), topic, data, length, timeout);
+}
+
+size_t rbReceiveMessage(char ** buffer)
+{
+    return rbDeviceReceiveMessage(rbDefaultDevice(), buffer);
+}
+
+size_t rbReceiveMessageWithTopic(char ** buffer, uint16_t topic)
+{
+    return rbDeviceReceiveMessageWithTopic(rbDefaultDevice(), buffer, topic);
+}
+
+size_t rbReceiveMessageAsync(char ** buffer)
+{
+    return rbDeviceReceiveMessageAsync(rbDefaultDevice(), buffer);
+}
+
+bool rbAcknowledgeReceiveHeadAsync(void)
+{
+    return rbDeviceAcknowledgeReceiveHeadAsync(rbDefaultDevice());
+}
+
+void rbReceiveLockAsync(void)
+{
+    rbDeviceReceiveLockAsync(rbDefaultDevice());
+}
+
+void rbReceiveUnlockAsync(void)
+{
+    rbDeviceReceiveUnlockAsync(rbDefaultDevice());
+}
+
+void rbSendLockAsync(void)
+{
+    rbDeviceSendLockAsync(rbDefaultDevice());
+}
+
+void rbSendUnlockAsync(void)
+{
+    rbDeviceSendUnlockAsync(rbDefaultDevice());
+}
+
+bool rbSetConfig(const rbConfig_t * config)
+{
+    return rbDeviceSetConfig(rbDefaultDevice(), config);
+}
+
+bool rbSendMessageAsync(uint16_t topic, const char * data, const size_t length)
+{
+    return rbDeviceSendMessageAsync(rbDefaultDevice(), topic, data, length);
+}
+
+bool rbSetTopicBatching(const uint16_t topic, const size_t maxSize, const uint32_t maxAgeMs)
+{
+    return rbDeviceSetTopicBatching(rbDefaultDevice(), topic, maxSize, maxAgeMs);
+}
+
+bool rbFlushBatches(void)
+{
+    return rbDeviceFlushBatches(rbDefaultDevice());
+}
+
+bool rbSendMessageBorrowedAsync(uint16_t topic, const char * data, const size_t length,
+                                rbReleaseCallback release, void * context)
+{
+    return rbDeviceSendMessageBorrowedAsync(rbDefaultDevice(), topic, data, length, release, context);
+}
+
+void rbPoll(void)
+{
+    rbDevicePoll(rbDefaultDevice());
+}
+
+bool rbWaitForEvent(const uint32_t timeoutMs)
+{
+    return rbDeviceWaitForEvent(rbDefaultDevice(), timeoutMs);
+}
+
+void rbWakeEvent(void)
+{
+    rbDeviceWakeEvent(rbDefaultDevice());
+}
+
+int8_t rbGetSignal(void)
+{
+    return rbDeviceGetSignal(rbDefaultDevice());
+}
+
+char * rbGetHwVersion(void)
+{
+    return rbDeviceGetHwVersion(rbDefaultDevice());
+}
+
+char * rbGetSerialNumber(void)
+{
+    return rbDeviceGetSerialNumber(rbDefaultDevice());
+}
+
+char * rbGetImei(void)
+{
+    return rbDeviceGetImei(rbDefaultDevice());
+}
+
+int8_t rbGetBoardTemp(void)
+{
+    return rbDeviceGetBoardTemp(rbDefaultDevice());
+}
+
+bool rbGetCardPresent(void)
+{
+    return rbDeviceGetCardPresent(rbDefaultDevice());
+}
+
+bool rbGetSimConnected(void)
+{
+    return rbDeviceGetSimConnected(rbDefaultDevice());
+}
+
+char * rbGetIccid(void)
+{
+    return rbDeviceGetIccid(rbDefaultDevice());
+}
+
+char * rbGetFirmwareVersion(void)
+{
+    return rbDeviceGetFirmwareVersion(rbDefaultDevice());
+}
+
+#ifdef RB_MO_JOURNAL
+size_t rbGetMoJournalBacklog(void)
+{
+    return rbDeviceGetMoJournalBacklog(rbDefaultDevice());
+}
+#endif
+
+size_t rbGetJsonArenaHighWater(void)
+{
+    return rbDeviceGetJsonArenaHighWater(rbDefaultDevice());
+}
+
+void rbSetJsonHooks(void * (*allocate)(size_t size), void (*release)(void * block))
+{
+    jsprSetJsonHooks(allocate, release);
+}
+
+bool rbResyncServiceConfig(void)
+{
+    return rbDeviceResyncServiceConfig(rbDefaultDevice());
+}
+
+#ifdef RB_IO_THREAD
+bool rbStartIoThread(void)
+{
+    return rbDeviceStartIoThread(rbDefaultDevice());
+}
+
+bool rbStopIoThread(void)
+{
+    return rbDeviceStopIoThread(rbDefaultDevice());
+}
+
+bool rbSubmitMessage(uint16_t topic, const char * data, const size_t length)
+{
+    return rbDeviceSubmitMessage(rbDefaultDevice(), topic, data, length);
+}
+
+bool rbSubmitMessageBorrowed(uint16_t topic, const char * data, const size_t length,
+                             rbReleaseCallback release, void * context)
+{
+    return rbDeviceSubmitMessageBorrowed(rbDefaultDevice(), topic, data, length, release, context);
+}
+
+bool rbTakeMessage(rbMessage_t * message)
+{
+    return rbDeviceTakeMessage(rbDefaultDevice(), message);
+}
+
+bool rbReleaseMessage(void)
+{
+    return rbDeviceReleaseMessage(rbDefaultDevice());
+}
+#endif
+
+#if defined(KERMIT)
+bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progress, void * context)
+{
+    return rbDeviceUpdateFirmware(rbDefaultDevice(), firmwareFile, progress, context);
+}
+#endif
+
+#ifdef RB_GPIO
+bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout)
+{
+    return rbDeviceBeginGpio(rbDefaultDevice(), port, gpioInfo, timeout);
+}
+
+bool rbEndGpio(const rbGpioTable_t * gpioInfo)
+{
+    return rbDeviceEndGpio(rbDefaultDevice(), gpioInfo);
+}
+#endif
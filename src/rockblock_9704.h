@@ -44,7 +44,12 @@ typedef enum
     /**
      * @brief Message failed to be processed.
      */
-    RB_MSG_STATUS_FAIL = -1
+    RB_MSG_STATUS_FAIL = -1,
+
+    /**
+     * @brief MT arrived in full but did not match its IMT CRC, it has been discarded.
+     */
+    RB_MSG_STATUS_CRC_ERROR = -2
 }rbMsgStatus_t;
 
 /**
@@ -77,7 +82,8 @@ typedef struct
      * and been received successfully.
      * 
      * @param id Unique Identifier of the message.
-     * @param status Enum indicating result of processing (-1 for failure & 1 for success).
+     * @param status Enum indicating result of processing (-1 for failure, -2 for a CRC
+     * mismatch & 1 for success).
      */
     void (*mtMessageComplete)(const uint16_t id, const rbMsgStatus_t status);
 
@@ -87,8 +93,294 @@ typedef struct
      * @param state Pointer to the updated constellation state structure.
      */
     void (*constellationState)(const jsprConstellationState_t *state);
+
+    /**
+     * @brief Callback for a message handed to rbSubmitMessage() or rbSubmitMessageBorrowed()
+     * that the I/O thread could not queue (e.g. topic not provisioned), it never gets an id.
+     * 
+     * @param topic Topic the message was submitted on.
+     * @param data The submitted payload, only valid until the callback returns.
+     * @param length Length of the payload.
+     */
+    void (*moSubmitFailed)(const uint16_t topic, const char * data, const size_t length);
 } rbCallbacks_t;
 
+/**
+ * @brief Handler for a JSPR target that rbPoll() does not process itself,
+ * see rbRegisterTargetHandler().
+ *
+ * @param code JSPR result code of the line, eg 299 for unsolicited messages.
+ * @param target Name of the target.
+ * @param json JSON body of the line, only valid until the handler returns.
+ * @param context User pointer given when the handler was registered.
+ */
+typedef void (*rbTargetHandler)(const uint32_t code, const char * target, const char * json, void * context);
+
+/**
+ * @def RB_MAX_TARGET_HANDLERS
+ * @brief Number of target handlers each device can hold.
+ */
+#ifndef RB_MAX_TARGET_HANDLERS
+    #define RB_MAX_TARGET_HANDLERS 4U
+#endif
+
+/**
+ * @def RB_MAX_TOPIC_BATCHES
+ * @brief Number of topics per device that can batch MOs.
+ */
+#ifndef RB_MAX_TOPIC_BATCHES
+    #define RB_MAX_TOPIC_BATCHES 4U
+#endif
+
+/**
+ * @brief Walks the records of a batched MT, see rbUnbatchInit().
+ */
+typedef struct
+{
+    const char * data;          /**< The MT payload */
+    size_t length;              /**< Its length */
+    size_t offset;              /**< Where the next record's length prefix starts */
+    bool malformed;             /**< Set if a record ran past the end, no more are returned */
+} rbUnbatch_t;
+
+/**
+ * @def RB_CODEC_STORED
+ * @brief Header byte of a payload sent uncompressed on a topic with a codec.
+ */
+#define RB_CODEC_STORED 0U
+
+/**
+ * @def RB_CODEC_LZ
+ * @brief Header byte of payloads compressed by rbCodecLz.
+ */
+#define RB_CODEC_LZ 1U
+
+/**
+ * @def RB_MAX_TOPIC_CODECS
+ * @brief Number of topics per device that can have a codec.
+ */
+#ifndef RB_MAX_TOPIC_CODECS
+    #define RB_MAX_TOPIC_CODECS 4U
+#endif
+
+/**
+ * @brief Payload compression for a topic, see rbSetTopicCodec().
+ *
+ * Every MO on the topic gets a one byte header, the codec's id or
+ * RB_CODEC_STORED when compressing did not make it smaller. MTs on the topic
+ * are decompressed by that header before they are handed to the application,
+ * so both ends need the same codec and dictionary.
+ */
+typedef struct rbCodec rbCodec_t;
+
+struct rbCodec
+{
+    uint8_t id;                 /**< Header byte of compressed payloads, 1 to 255 */
+    size_t (*compress)(const rbCodec_t * codec, const uint8_t * in, size_t inLength,
+                       uint8_t * out, size_t outCapacity);                          /**< Compressed length, 0 if it doesn't fit in outCapacity */
+    size_t (*decompressedLength)(const rbCodec_t * codec, const uint8_t * in,
+                                 size_t inLength);                                  /**< Length decompress() will produce, 0 if malformed */
+    size_t (*decompress)(const rbCodec_t * codec, const uint8_t * in, size_t inLength,
+                         uint8_t * out, size_t outCapacity);                        /**< Decompressed length, 0 if malformed or it doesn't fit */
+    const uint8_t * dictionary; /**< Sample data both ends share, may be NULL */
+    size_t dictionaryLength;    /**< Length of the dictionary */
+    void * context;             /**< User pointer for custom codecs */
+};
+
+/**
+ * @brief Built-in LZ77 codec (lz_codec.h), fast enough for every message on a small MCU.
+ *
+ * Copy it and set dictionary to prime both ends with typical payloads, this
+ * is what makes messages of a few hundred bytes compress well.
+ */
+extern const rbCodec_t rbCodecLz;
+
+/**
+ * @def RB_IO_THREAD
+ * @brief Defined when the optional I/O thread (rbStartIoThread()) is available.
+ *
+ * Only Linux and macOS are supported, define RB_NO_IO_THREAD to leave it out.
+ */
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(RB_NO_IO_THREAD)
+    #define RB_IO_THREAD
+#endif
+
+/**
+ * @def RB_MO_JOURNAL
+ * @brief Defined when MOs can be kept in an on-disk outbox (rbConfig_t.moJournalPath).
+ *
+ * Only Linux and macOS are supported, define RB_NO_MO_JOURNAL to leave it out.
+ */
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(RB_NO_MO_JOURNAL)
+    #define RB_MO_JOURNAL
+#endif
+
+/**
+ * @def RB_MO_JOURNAL_SIZE
+ * @brief Default size in bytes of the MO outbox file.
+ */
+#ifndef RB_MO_JOURNAL_SIZE
+    #define RB_MO_JOURNAL_SIZE (4U * 1024U * 1024U)
+#endif
+
+/**
+ * @def RB_IO_QUEUE_SIZE
+ * @brief Number of MOs that can wait to be picked up by the I/O thread.
+ */
+#ifndef RB_IO_QUEUE_SIZE
+    #define RB_IO_QUEUE_SIZE 8U
+#endif
+
+/**
+ * @brief A mobile-terminated (MT) message delivered by the I/O thread.
+ */
+typedef struct
+{
+    uint16_t id;            /**< Message ID assigned by the modem */
+    uint16_t topic;         /**< Message topic ID */
+    const char * data;      /**< Payload, valid until rbReleaseMessage() */
+    size_t length;          /**< Payload length in bytes, without the IMT CRC */
+} rbMessage_t;
+
+/**
+ * @brief Memory hooks for queue storage, see rbConfig_t.
+ */
+typedef struct
+{
+    void * (*alloc)(size_t size, void * context);               /**< Return a block of at least size bytes, NULL on failure */
+    void (*free)(void * block, size_t size, void * context);    /**< Give back a block, size is the one it was allocated with */
+    void * context;                                             /**< User pointer passed to both hooks */
+} rbAllocator_t;
+
+/**
+ * @def RB_MO_IN_FLIGHT
+ * @brief Default number of asynchronous MOs the modem is working on at once.
+ *
+ * Raising it (or rbConfig_t.moInFlight) lets the next messageOriginate go out
+ * while earlier messages are still transferring, capped at the MO queue size.
+ */
+#ifndef RB_MO_IN_FLIGHT
+    #define RB_MO_IN_FLIGHT 1U
+#endif
+
+/**
+ * @brief Which queued MO gives way when an unlocked MO queue is full.
+ */
+typedef enum
+{
+    RB_MO_EVICT_LOWEST_PRIORITY = 0,    /**< Oldest waiting MO of the least urgent topic, a new MO less urgent than all of them is refused */
+    RB_MO_EVICT_OLDEST                  /**< First waiting MO in the queue, the oldest when topics share a priority */
+} rbMoEviction_t;
+
+/**
+ * @brief Runtime settings applied by the next rbBegin(), zeroed fields keep their default.
+ */
+typedef struct
+{
+    uint16_t moQueueSize;       /**< Number of MOs that can be queued, default IMT_QUEUE_SIZE */
+    uint16_t mtQueueSize;       /**< Number of MTs that can be queued, default IMT_QUEUE_SIZE */
+    rbAllocator_t allocator;    /**< Queue memory, alloc and free NULL use the built-in size classed pool */
+    bool secureWipe;            /**< Zero whole payload blocks on removal, always on when built with IMT_SECURE_WIPE */
+    uint16_t moInFlight;        /**< Asynchronous MOs offered to the modem at once, default RB_MO_IN_FLIGHT */
+    rbMoEviction_t moEviction;  /**< MO dropped when the unlocked MO queue is full, default RB_MO_EVICT_LOWEST_PRIORITY */
+    const char * moJournalPath; /**< File keeping asynchronous MOs until they complete, NULL keeps them in RAM only (RB_MO_JOURNAL) */
+    size_t moJournalSize;       /**< Size of the journal file in bytes, default RB_MO_JOURNAL_SIZE */
+    bool probeBaud;             /**< Run rbProbeBaud() over RB_BAUD_PROBE_RATES once the API is set, not on Arduino */
+    bool lowLatency;            /**< Open the port with the low-latency tty profile, setLowLatencyLinux(), Linux and macOS only */
+} rbConfig_t;
+
+/**
+ * @brief Opaque handle to a single RockBLOCK 9704 modem.
+ * 
+ * Every rbDevice* function acts on the modem behind the given handle, so one process
+ * can drive several modems on different serial ports. The functions without a device
+ * argument act on rbDefaultDevice().
+ */
+typedef struct rbDevice rbDevice_t;
+
+/**
+ * @brief Device aware variant of rbCallbacks_t, registered with rbDeviceRegisterDeviceCallbacks().
+ * 
+ * Each callback is given the device the event came from and the context pointer given
+ * at registration, so one set of callbacks can serve several modems.
+ */
+typedef struct
+{
+    /**
+     * @brief Callback for message provisioning info once its been obtained.
+     * 
+     * @param device Pointer to the device.
+     * @param messageProvisioning Pointer to the provisioning info structure.
+     * @param context User pointer given when the callbacks were registered.
+     */
+    void (*messageProvisioning)(rbDevice_t * device, const jsprMessageProvisioning_t *messageProvisioning, void * context);
+
+    /**
+     * @brief Callback for when a mobile-originated (MO) message has finished processing.
+     * 
+     * @param device Pointer to the device.
+     * @param id Unique Identifier of the message.
+     * @param status Enum indicating result of processing (-1 for failure & 1 for success).
+     * @param context User pointer given when the callbacks were registered.
+     */
+    void (*moMessageComplete)(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status, void * context);
+
+    /**
+     * @brief Callback for when a mobile-terminated (MT) message has finished processing.
+     * 
+     * @param device Pointer to the device.
+     * @param id Unique Identifier of the message.
+     * @param status Enum indicating result of processing (-1 for failure, -2 for a CRC
+     * mismatch & 1 for success).
+     * @param context User pointer given when the callbacks were registered.
+     */
+    void (*mtMessageComplete)(rbDevice_t * device, const uint16_t id, const rbMsgStatus_t status, void * context);
+
+    /**
+     * @brief Callback for the constellationState (signal) has been updated.
+     * 
+     * @param device Pointer to the device.
+     * @param state Pointer to the updated constellation state structure.
+     * @param context User pointer given when the callbacks were registered.
+     */
+    void (*constellationState)(rbDevice_t * device, const jsprConstellationState_t *state, void * context);
+
+    /**
+     * @brief Callback for a submitted message the I/O thread could not queue, it never gets an id.
+     * 
+     * @param device Pointer to the device.
+     * @param topic Topic the message was submitted on.
+     * @param data The submitted payload, only valid until the callback returns.
+     * @param length Length of the payload.
+     * @param context User pointer given when the callbacks were registered.
+     */
+    void (*moSubmitFailed)(rbDevice_t * device, const uint16_t topic, const char * data, const size_t length, void * context);
+} rbDeviceCallbacks_t;
+
+/**
+ * @brief Allocate and initialise a new device handle, no port is opened.
+ * 
+ * @return pointer to the new device or NULL if out of memory.
+ * 
+ * * @note Each device holds its own MO and MT queues, built by rbDeviceBegin() from the
+ * settings given to rbDeviceSetConfig().
+ */
+rbDevice_t * rbDeviceCreate(void);
+
+/**
+ * @brief Close the port of a device if open and free it.
+ * 
+ * @param device pointer to the device, may be NULL.
+ */
+void rbDeviceDestroy(rbDevice_t * device);
+
+/**
+ * @brief Get the device used by the single device API (rbBegin(), rbPoll()...).
+ * 
+ * @return pointer to the statically allocated default device.
+ */
+rbDevice_t * rbDefaultDevice(void);
+
 /**
  * @brief Registers a set of user-defined callbacks with the library.
  * 
@@ -99,6 +391,88 @@ typedef struct
  */
 void rbRegisterCallbacks(const rbCallbacks_t *callbacks);
 
+/**
+ * @brief Device variant of rbRegisterCallbacks().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceRegisterCallbacks(rbDevice_t * device, const rbCallbacks_t *callbacks);
+
+/**
+ * @brief Registers a set of device aware callbacks, called alongside any registered
+ * with rbDeviceRegisterCallbacks().
+ * 
+ * @param device pointer to the device.
+ * @param callbacks Pointer to the callbacks, it must stay valid while registered. NULL removes them.
+ * @param context User pointer handed to every callback.
+ */
+void rbDeviceRegisterDeviceCallbacks(rbDevice_t * device, const rbDeviceCallbacks_t *callbacks, void * context);
+
+/**
+ * @brief Registers a handler for a JSPR target the library does not process.
+ * 
+ * rbPoll() resolves every line to a known target and dispatches on it, lines
+ * for any other target are passed to the handler registered for that name.
+ * Registering a name again replaces its handler, a NULL handler removes it.
+ * 
+ * @param target Name of the target, eg "gnssData".
+ * @param handler Function to call, NULL to remove.
+ * @param context User pointer passed back to the handler.
+ * @return true on success, false if the name is too long or all
+ * RB_MAX_TARGET_HANDLERS slots are taken.
+ */
+bool rbRegisterTargetHandler(const char * target, rbTargetHandler handler, void * context);
+
+/**
+ * @brief Device variant of rbRegisterTargetHandler().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceRegisterTargetHandler(rbDevice_t * device, const char * target, rbTargetHandler handler, void * context);
+
+/**
+ * @brief Compress MOs and decompress MTs on a topic.
+ * 
+ * Copied sends (rbSendMessage*(), rbSendMessageAsync(), rbSubmitMessage()
+ * and the MO journal) are compressed into the MO queue. Borrowed buffers are
+ * sent as they are, so they must already carry the header. MTs whose header
+ * doesn't match the codec fail with RB_MSG_STATUS_FAIL.
+ * 
+ * @param topic Topic ID.
+ * @param codec Codec to use, must stay valid while set. NULL removes it.
+ * @return true on success, false if the id is RB_CODEC_STORED or all
+ * RB_MAX_TOPIC_CODECS slots are taken.
+ * 
+ * @note The header takes one byte, so the largest payload on the topic is one byte shorter.
+ */
+bool rbSetTopicCodec(const uint16_t topic, const rbCodec_t * codec);
+
+/**
+ * @brief Device variant of rbSetTopicCodec().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSetTopicCodec(rbDevice_t * device, const uint16_t topic, const rbCodec_t * codec);
+
+/**
+ * @brief Store runtime settings, they take effect on the next rbBegin().
+ * 
+ * Queue depths are chosen here instead of at compile time. Payload memory is taken per
+ * message, sized to that message, so deep queues of small messages only cost a few kB
+ * while a full IMT_PAYLOAD_SIZE message still fits.
+ * 
+ * @param config pointer to the settings, copied. NULL restores the defaults.
+ * @return bool false if the settings are invalid.
+ */
+bool rbSetConfig(const rbConfig_t * config);
+
+/**
+ * @brief Device variant of rbSetConfig().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSetConfig(rbDevice_t * device, const rbConfig_t * config);
+
 /**
  * @brief Temporary buffer size used for Base64 encoding/decoding of IMT messages.
  */
@@ -111,6 +485,68 @@ void rbRegisterCallbacks(const rbCallbacks_t *callbacks);
  */
 #define RB9704_BAUD 230400U
 
+/**
+ * @def RB_BAUD_PROBE_RATES
+ * @brief Rates rbProbeBaud() tries when given none.
+ */
+#define RB_BAUD_PROBE_RATES { 921600U, 460800U, RB9704_BAUD }
+
+/**
+ * @def RB_BAUD_PROBE_MAX_RATES
+ * @brief Most rates one probe can try and report.
+ */
+#define RB_BAUD_PROBE_MAX_RATES 8U
+
+/**
+ * @def RB_BAUD_PROBE_ROUND_TRIPS
+ * @brief GET apiVersion round trips run at each rate.
+ */
+#ifndef RB_BAUD_PROBE_ROUND_TRIPS
+    #define RB_BAUD_PROBE_ROUND_TRIPS 32U
+#endif
+
+/**
+ * @def RB_BAUD_PROBE_BURST
+ * @brief Requests sent back to back before waiting for their replies, keeps the link busy.
+ */
+#define RB_BAUD_PROBE_BURST 4U
+
+/**
+ * @def RB_BAUD_PROBE_TIMEOUT_MS
+ * @brief Longest wait for the replies of one burst before the rate fails.
+ */
+#define RB_BAUD_PROBE_TIMEOUT_MS 500U
+
+/**
+ * @brief Outcome of one rate tried by rbProbeBaud().
+ */
+typedef struct
+{
+    uint32_t baud;              /**< Rate tried */
+    bool passed;                /**< Every reply came back intact and in time */
+    uint32_t roundTrips;        /**< Replies received */
+    uint32_t bytesPerSecond;    /**< Bytes moved in both directions per second, 0 if it failed */
+} rbBaudProbe_t;
+
+/**
+ * @def RB_LATENCY_ROUND_TRIPS
+ * @brief Round trips rbMeasureLatency() is usually run with.
+ */
+#ifndef RB_LATENCY_ROUND_TRIPS
+    #define RB_LATENCY_ROUND_TRIPS 50U
+#endif
+
+/**
+ * @brief GET apiVersion round trip times measured by rbMeasureLatency().
+ */
+typedef struct
+{
+    uint32_t roundTrips;        /**< Replies received */
+    uint32_t minUs;             /**< Fastest round trip in microseconds */
+    uint32_t avgUs;             /**< Mean round trip in microseconds */
+    uint32_t maxUs;             /**< Slowest round trip in microseconds */
+} rbLatency_t;
+
 /**
  * @def SERIAL_CONTEXT_SETUP_FUNC
  * @brief Platform-specific macro to define the serial context setup function.
@@ -186,6 +622,15 @@ typedef enum
      */
     bool rbBegin(Stream &port);
 
+    /**
+     * @brief Device variant of rbBegin(). (ARDUINO VERSION)
+     * 
+     * @param device pointer to the device.
+     * @param port reference to serial object.
+     * @return bool depicting success or failure.
+     */
+    bool rbDeviceBegin(rbDevice_t * device, Stream &port);
+
     // Redefine extern C
     extern "C" {
 #else
@@ -202,6 +647,15 @@ typedef enum
      * @return bool depicting success or failure.
      */
     bool rbBegin(const char * port);
+
+    /**
+     * @brief Device variant of rbBegin().
+     * 
+     * @param device pointer to the device.
+     * @param port pointer to port name.
+     * @return bool depicting success or failure.
+     */
+    bool rbDeviceBegin(rbDevice_t * device, const char * port);
 #endif
 
 /**
@@ -211,9 +665,108 @@ typedef enum
  */
 bool rbEnd(void);
 
+/**
+ * @brief Device variant of rbEnd().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceEnd(rbDevice_t * device);
+
+#ifndef ARDUINO
+/**
+ * @brief Find the fastest serial rate the link to the modem sustains.
+ * 
+ * The port is reopened at each rate and RB_BAUD_PROBE_ROUND_TRIPS GET apiVersion
+ * requests are sent in bursts of RB_BAUD_PROBE_BURST. A rate passes when every
+ * reply parses and arrives within RB_BAUD_PROBE_TIMEOUT_MS of its burst. The port
+ * is left at the highest rate that passed, or at the rate it had before if none did.
+ * 
+ * The modem UART itself runs at RB9704_BAUD, so higher rates only pass where the
+ * link in between carries them, eg. a USB bridge. Run it once per board and keep
+ * the result, or set rbConfig_t.probeBaud.
+ * 
+ * @param rates Rates to try, NULL for RB_BAUD_PROBE_RATES.
+ * @param count Number of rates, at most RB_BAUD_PROBE_MAX_RATES are tried.
+ * @param results One entry per rate tried, may be NULL.
+ * @return true if a rate passed.
+ * 
+ * @note Only call it while no messages are in flight, the port is closed and reopened.
+ */
+bool rbProbeBaud(const uint32_t * rates, const size_t count, rbBaudProbe_t * results);
+
+/**
+ * @brief Device variant of rbProbeBaud().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceProbeBaud(rbDevice_t * device, const uint32_t * rates, const size_t count, rbBaudProbe_t * results);
+
+/**
+ * @brief Time GET apiVersion round trips, one request in flight at a time.
+ * 
+ * Run it before and after changing the serial setup, eg. rbConfig_t.lowLatency,
+ * to see what the change does to command turnaround. USB-serial adapters
+ * holding received bytes for their latency timer show up as round trips of
+ * 16ms or more. A reply that is garbled or takes longer than
+ * RB_BAUD_PROBE_TIMEOUT_MS ends the run.
+ * 
+ * @param roundTrips Number of round trips, eg. RB_LATENCY_ROUND_TRIPS.
+ * @param result Round trip times, over the replies received.
+ * @return true if every round trip completed.
+ * 
+ * @note Only call it while no messages are in flight.
+ */
+bool rbMeasureLatency(const uint32_t roundTrips, rbLatency_t * result);
+
+/**
+ * @brief Device variant of rbMeasureLatency().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceMeasureLatency(rbDevice_t * device, const uint32_t roundTrips, rbLatency_t * result);
+#endif
+
+/**
+ * @brief Get the serial rate the port is running at, eg. after rbProbeBaud().
+ * 
+ * @return Baud rate.
+ */
+uint32_t rbGetBaud(void);
+
+/**
+ * @brief Device variant of rbGetBaud().
+ * 
+ * @param device pointer to the device.
+ */
+uint32_t rbDeviceGetBaud(rbDevice_t * device);
+
+/**
+ * @brief Set how long a serial read waits for data when none is buffered.
+ * 
+ * Defaults to SERIAL_READ_TIMEOUT_US (500ms, 1s on Arduino). The asynchronous poll path never
+ * waits on a read, a short timeout (0 to a few ms) bounds anything else that
+ * reads the port, eg. clearing leftover data or a custom serial loop.
+ * Synchronous commands still wait up to JSPR_RESPONSE_IDLE_MS of silence for
+ * their reply. Windows and Arduino round it up to whole milliseconds.
+ * 
+ * @param timeoutUs Timeout in microseconds, 0 returns at once.
+ */
+void rbSetReadTimeout(const uint32_t timeoutUs);
+
+/**
+ * @brief Device variant of rbSetReadTimeout().
+ * 
+ * @param device pointer to the device.
+ * @param timeoutUs Timeout in microseconds, 0 returns at once.
+ */
+void rbDeviceSetReadTimeout(rbDevice_t * device, const uint32_t timeoutUs);
+
 /**
  * @brief Send a mobile originated message from the modem on the default topic (244).
  * 
+ * If the timeout passes after the modem has taken the message, it stays queued and is
+ * finished by rbPoll(), which reports it through the moMessageComplete callback.
+ * 
  * @param data pointer to data (message).
  * @param length size_t of data length. (Max 100kB).
  * @param timeout in seconds.
@@ -221,6 +774,13 @@ bool rbEnd(void);
  */
 bool rbSendMessage(const char * data, const size_t length, const int timeout);
 
+/**
+ * @brief Device variant of rbSendMessage().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSendMessage(rbDevice_t * device, const char * data, const size_t length, const int timeout);
+
 /**
  * @brief Send a mobile originated message from the modem on a cloudloop topic of choice.
  * 
@@ -232,6 +792,13 @@ bool rbSendMessage(const char * data, const size_t length, const int timeout);
  */
 bool rbSendMessageCloudloop(cloudloopTopics_t topic, const char * data, const size_t length, const int timeout);
 
+/**
+ * @brief Device variant of rbSendMessageCloudloop().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSendMessageCloudloop(rbDevice_t * device, cloudloopTopics_t topic, const char * data, const size_t length, const int timeout);
+
 /**
  * @brief Send a mobile originated message from the modem on any topic.
  * 
@@ -243,6 +810,13 @@ bool rbSendMessageCloudloop(cloudloopTopics_t topic, const char * data, const si
  */
 bool rbSendMessageAny(uint16_t topic, const char * data, const size_t length, const int timeout);
 
+/**
+ * @brief Device variant of rbSendMessageAny().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSendMessageAny(rbDevice_t * device, uint16_t topic, const char * data, const size_t length, const int timeout);
+
 /**
  * @brief Listen for a mobile terminated message from the modem.
  * 
@@ -253,7 +827,14 @@ bool rbSendMessageAny(uint16_t topic, const char * data, const size_t length, co
  * it may be reused to store another MT. It must be copied if the application 
  * code needs to preserve it for a period of time.
  */
-size_t rbReceiveMessage(char ** buffer);
+size_t rbReceiveMessage(char ** buffer);
+
+/**
+ * @brief Device variant of rbReceiveMessage().
+ * 
+ * @param device pointer to the device.
+ */
+size_t rbDeviceReceiveMessage(rbDevice_t * device, char ** buffer);
 
 /**
  * @brief Listen for a mobile terminated message from the modem.
@@ -269,7 +850,14 @@ size_t rbReceiveMessage(char ** buffer);
 size_t rbReceiveMessageWithTopic(char ** buffer, uint16_t topic);
 
 /**
- * @brief Check if a valid message exists, stored at the head of the receiving queue.
+ * @brief Device variant of rbReceiveMessageWithTopic().
+ * 
+ * @param device pointer to the device.
+ */
+size_t rbDeviceReceiveMessageWithTopic(rbDevice_t * device, char ** buffer, uint16_t topic);
+
+/**
+ * @brief Check if a valid message exists, the oldest complete one in the receiving queue.
  * 
  * @param buffer pointer to buffer of the stored MT messages.
  * @return size_t the length of the buffer minus the IMT CRC.
@@ -281,17 +869,31 @@ size_t rbReceiveMessageWithTopic(char ** buffer, uint16_t topic);
 size_t rbReceiveMessageAsync(char ** buffer);
 
 /**
- * @brief Acknowledge the head of the receiving queue by discarding it.
+ * @brief Device variant of rbReceiveMessageAsync().
+ * 
+ * @param device pointer to the device.
+ */
+size_t rbDeviceReceiveMessageAsync(rbDevice_t * device, char ** buffer);
+
+/**
+ * @brief Acknowledge the message returned by rbReceiveMessageAsync() by discarding it.
  * 
  * @return bool depicting success or failure.
  * 
- * * @note This function will clear the head of the receiving queue 
+ * * @note This function will clear the oldest complete message in the receiving queue 
  * to make space for other incoming messages, new messages will always 
  * be brought to the head of the queue whilst old ones will be automatically
  * discarded if they reach the end of the queue to make space.
  */
 bool rbAcknowledgeReceiveHeadAsync(void);
 
+/**
+ * @brief Device variant of rbAcknowledgeReceiveHeadAsync().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceAcknowledgeReceiveHeadAsync(rbDevice_t * device);
+
 /**
  * @brief Locks the receiving queue so that old messages aren't discarded 
  * when incoming ones arrive.
@@ -301,6 +903,13 @@ bool rbAcknowledgeReceiveHeadAsync(void);
  */
 void rbReceiveLockAsync(void);
 
+/**
+ * @brief Device variant of rbReceiveLockAsync().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceReceiveLockAsync(rbDevice_t * device);
+
 /**
  * @brief Unlocks the receiving queue so that old messages are discarded 
  * to make space for incoming ones.
@@ -310,6 +919,13 @@ void rbReceiveLockAsync(void);
  */
 void rbReceiveUnlockAsync(void);
 
+/**
+ * @brief Device variant of rbReceiveUnlockAsync().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceReceiveUnlockAsync(rbDevice_t * device);
+
 /**
  * @brief Locks the sending queue so that old messages aren't discarded 
  * when incoming ones arrive.
@@ -319,12 +935,26 @@ void rbReceiveUnlockAsync(void);
  */
 void rbSendLockAsync(void);
 
+/**
+ * @brief Device variant of rbSendLockAsync().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceSendLockAsync(rbDevice_t * device);
+
 /**
  * @brief Unlocks the sending queue so that old messages are discarded 
  * to make space for incoming ones.
  */
 void rbSendUnlockAsync(void);
 
+/**
+ * @brief Device variant of rbSendUnlockAsync().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceSendUnlockAsync(rbDevice_t * device);
+
 /**
  * @brief Queue a message to be sent.
  * 
@@ -339,14 +969,277 @@ void rbSendUnlockAsync(void);
  */
 bool rbSendMessageAsync(uint16_t topic, const char * data, const size_t length);
 
+/**
+ * @brief Device variant of rbSendMessageAsync().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSendMessageAsync(rbDevice_t * device, uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Called once the library no longer needs a buffer lent with rbSendMessageBorrowedAsync().
+ * 
+ * @param data pointer that was lent.
+ * @param context user pointer given with the buffer.
+ */
+typedef void (*rbReleaseCallback)(const char * data, void * context);
+
+/**
+ * @brief Queue a message to be sent without copying it.
+ * 
+ * @param topic uint16_t topic.
+ * @param data pointer to data (message), must stay valid and unchanged until release is called.
+ * @param length size_t of data length. (Max 100kB).
+ * @param release called once the message has completed, failed or been discarded, may be NULL.
+ * @param context user pointer passed to release.
+ * 
+ * @return bool depicting success or failure.
+ * 
+ * @note The CRC and every segment are read straight from data. When false is
+ *  returned the buffer was not taken and release will not be called. Topics batched
+ *  with rbSetTopicBatching() are refused, the buffer can't carry a length prefix.
+ */
+bool rbSendMessageBorrowedAsync(uint16_t topic, const char * data, const size_t length,
+                                rbReleaseCallback release, void * context);
+
+/**
+ * @brief Device variant of rbSendMessageBorrowedAsync().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSendMessageBorrowedAsync(rbDevice_t * device, uint16_t topic, const char * data, const size_t length,
+                                      rbReleaseCallback release, void * context);
+
+/**
+ * @brief Pack small asynchronous MOs on a topic into one message.
+ * 
+ * rbSendMessageAsync() (and rbSubmitMessage()) on the topic then add the record to a batch
+ * instead of queuing it, each record behind its length as a little endian base 128 varint
+ * (one byte up to 127 bytes). The batch is queued as a single MO once the next record
+ * doesn't fit in maxSize, maxAgeMs after its first record, or on rbFlushBatches().
+ * A record bigger than maxSize is framed the same way and sent on its own after the
+ * batch. The blocking rbSendMessage*() calls flush the batch and frame their message the
+ * same way too. Borrowed sends (rbSendMessageBorrowedAsync(), rbSubmitMessageBorrowed())
+ * and fragment transfers are refused on the topic, so every MO on it can be split by the receiver.
+ * 
+ * Split received batches with rbUnbatchInit() and rbUnbatchNext(). Compression
+ * set with rbSetTopicCodec() is applied to the whole batch.
+ * 
+ * @param topic Topic ID.
+ * @param maxSize Largest batch payload in bytes, capped to one message. 0 stops batching the topic.
+ * @param maxAgeMs Longest a record waits in milliseconds, 0 waits until the batch is full or flushed.
+ * @return false if records already batched can't be queued, memory for the batch can't be
+ * allocated or all RB_MAX_TOPIC_BATCHES slots are taken.
+ * 
+ * @note Age is checked by rbPoll() and rbWaitForEvent(), which also wakes up in time for
+ * it. Batched records are in RAM only until queued, moMessageComplete reports the batch.
+ */
+bool rbSetTopicBatching(const uint16_t topic, const size_t maxSize, const uint32_t maxAgeMs);
+
+/**
+ * @brief Device variant of rbSetTopicBatching().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSetTopicBatching(rbDevice_t * device, const uint16_t topic, const size_t maxSize, const uint32_t maxAgeMs);
+
+/**
+ * @brief Queue every batch that has records, eg. before a satellite pass or shutting down.
+ * 
+ * @return false if a batch couldn't be queued, it is tried again by the next rbPoll().
+ */
+bool rbFlushBatches(void);
+
+/**
+ * @brief Device variant of rbFlushBatches().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceFlushBatches(rbDevice_t * device);
+
+/**
+ * @brief Start splitting a batched MT into its records.
+ * 
+ * @param unbatch Pointer to the iterator.
+ * @param data MT payload, eg. from rbReceiveMessageAsync(), must stay valid while iterating.
+ * @param length MT length.
+ */
+void rbUnbatchInit(rbUnbatch_t * unbatch, const char * data, const size_t length);
+
+/**
+ * @brief Get the next record of a batched MT.
+ * 
+ * @param unbatch Pointer to the iterator.
+ * @param record Set to the record, it points into the MT.
+ * @param length Set to the record length.
+ * @return false once there are no more records, check unbatch->malformed for a truncated batch.
+ */
+bool rbUnbatchNext(rbUnbatch_t * unbatch, const char ** record, size_t * length);
+
 /**
  * @brief Polling function that handles all incoming communication from the modem.
  * 
  * * @note This function is used in a asynchronous approach and will need to be 
- * called very frequently as it is non-blocking. 
+ * called very frequently as it is non-blocking. Use rbWaitForEvent() between
+ * calls to sleep until there is something to handle.
  */
 void rbPoll(void);
 
+/**
+ * @brief Device variant of rbPoll().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDevicePoll(rbDevice_t * device);
+
+/**
+ * @brief Sleep until the modem has sent a message for rbPoll() to handle or the timeout elapses.
+ * 
+ * On Linux the calling thread sleeps on the serial port with epoll (poll on macOS), so an
+ * application can loop on rbWaitForEvent() and rbPoll() without spinning a core.
+ * Platforms without a way to sleep on the port fall back to polling every millisecond.
+ * 
+ * @param timeoutMs maximum time to wait in milliseconds, 0 to only check.
+ * @return true if a message is ready to be handled by rbPoll(), false on timeout or wake-up.
+ */
+bool rbWaitForEvent(const uint32_t timeoutMs);
+
+/**
+ * @brief Device variant of rbWaitForEvent().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceWaitForEvent(rbDevice_t * device, const uint32_t timeoutMs);
+
+/**
+ * @brief Wake a thread blocked in rbWaitForEvent() early.
+ * 
+ * * @note Safe to call from another thread or a signal handler on Linux and macOS.
+ */
+void rbWakeEvent(void);
+
+/**
+ * @brief Device variant of rbWakeEvent().
+ * 
+ * @param device pointer to the device.
+ */
+void rbDeviceWakeEvent(rbDevice_t * device);
+
+#ifdef RB_IO_THREAD
+/**
+ * @brief Start a thread that owns the serial port and runs rbPoll() for the device.
+ * 
+ * Once started, the application hands MOs over with rbSubmitMessage() and collects MTs with
+ * rbTakeMessage(), neither of which touch the serial port, block or race the poll loop.
+ * Callbacks registered with rbRegisterCallbacks() or rbDeviceRegisterDeviceCallbacks() are called
+ * from the I/O thread.
+ * 
+ * * @note rbBegin() must have succeeded first. While the thread is running only rbSubmitMessage(),
+ * rbTakeMessage(), rbReleaseMessage(), rbWakeEvent() and rbStopIoThread() may be called for the device.
+ * The MT queue is locked while the thread runs so delivered messages are never overwritten.
+ * 
+ * @return bool depicting success or failure.
+ */
+bool rbStartIoThread(void);
+
+/**
+ * @brief Device variant of rbStartIoThread().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceStartIoThread(rbDevice_t * device);
+
+/**
+ * @brief Stop the I/O thread and wait for it to exit, MOs not yet picked up are discarded.
+ * 
+ * @return bool depicting success or failure.
+ */
+bool rbStopIoThread(void);
+
+/**
+ * @brief Device variant of rbStopIoThread().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceStopIoThread(rbDevice_t * device);
+
+/**
+ * @brief Hand a message to the I/O thread to be sent, never blocks.
+ * 
+ * The payload is copied so the caller's buffer can be reused straight away. The outcome is
+ * reported through the moMessageComplete callback, or through moSubmitFailed if the message
+ * could not be queued with the modem at all (e.g. topic not provisioned).
+ * 
+ * @param topic uint16_t topic.
+ * @param data pointer to data (message).
+ * @param length size_t of data length. (Max 100kB).
+ * @return bool false if the submission queue is full or out of memory.
+ */
+bool rbSubmitMessage(uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Device variant of rbSubmitMessage().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSubmitMessage(rbDevice_t * device, uint16_t topic, const char * data, const size_t length);
+
+/**
+ * @brief Hand an MO over to the I/O thread without copying it, see rbSendMessageBorrowedAsync().
+ * 
+ * @param topic uint16_t topic.
+ * @param data pointer to data (message), must stay valid and unchanged until release is called.
+ * @param length size_t of data length. (Max 100kB).
+ * @param release called from the I/O thread once the buffer is no longer used, may be NULL.
+ * If the message could not be queued it is called after moSubmitFailed.
+ * @param context user pointer passed to release.
+ * @return bool false if the submission queue is full, release will not be called.
+ * @note Topics batched with rbSetTopicBatching() are refused through moSubmitFailed.
+ */
+bool rbSubmitMessageBorrowed(uint16_t topic, const char * data, const size_t length,
+                             rbReleaseCallback release, void * context);
+
+/**
+ * @brief Device variant of rbSubmitMessageBorrowed().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceSubmitMessageBorrowed(rbDevice_t * device, uint16_t topic, const char * data, const size_t length,
+                                   rbReleaseCallback release, void * context);
+
+/**
+ * @brief Collect the oldest MT delivered by the I/O thread, never blocks.
+ * 
+ * @param message pointer to structure to populate with the message.
+ * @return bool true if a message was taken, false if none is waiting.
+ * 
+ * * @note Every message taken must be handed back with rbReleaseMessage(), in order, to free
+ * its slot in the MT queue.
+ */
+bool rbTakeMessage(rbMessage_t * message);
+
+/**
+ * @brief Device variant of rbTakeMessage().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceTakeMessage(rbDevice_t * device, rbMessage_t * message);
+
+/**
+ * @brief Hand the oldest taken MT back to the I/O thread, its data must not be used afterwards.
+ * 
+ * @return bool depicting success or failure.
+ */
+bool rbReleaseMessage(void);
+
+/**
+ * @brief Device variant of rbReleaseMessage().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceReleaseMessage(rbDevice_t * device);
+#endif
+
 /**
  * @brief Get the current signal strength from the modem.
  *
@@ -361,6 +1254,13 @@ void rbPoll(void);
  */
 int8_t rbGetSignal(void);
 
+/**
+ * @brief Device variant of rbGetSignal().
+ * 
+ * @param device pointer to the device.
+ */
+int8_t rbDeviceGetSignal(rbDevice_t * device);
+
 /**
  * @brief Get the hardware version.
  * 
@@ -368,6 +1268,13 @@ int8_t rbGetSignal(void);
  */
 char * rbGetHwVersion(void);
 
+/**
+ * @brief Device variant of rbGetHwVersion().
+ * 
+ * @param device pointer to the device.
+ */
+char * rbDeviceGetHwVersion(rbDevice_t * device);
+
 /**
  * @brief Get the serial number.
  * 
@@ -375,6 +1282,13 @@ char * rbGetHwVersion(void);
  */
 char * rbGetSerialNumber(void);
 
+/**
+ * @brief Device variant of rbGetSerialNumber().
+ * 
+ * @param device pointer to the device.
+ */
+char * rbDeviceGetSerialNumber(rbDevice_t * device);
+
 /**
  * @brief Get the imei.
  * 
@@ -382,6 +1296,13 @@ char * rbGetSerialNumber(void);
  */
 char * rbGetImei(void);
 
+/**
+ * @brief Device variant of rbGetImei().
+ * 
+ * @param device pointer to the device.
+ */
+char * rbDeviceGetImei(rbDevice_t * device);
+
 /**
  * @brief Get the board temperature.
  * 
@@ -389,6 +1310,13 @@ char * rbGetImei(void);
  */
 int8_t rbGetBoardTemp(void);
 
+/**
+ * @brief Device variant of rbGetBoardTemp().
+ * 
+ * @param device pointer to the device.
+ */
+int8_t rbDeviceGetBoardTemp(rbDevice_t * device);
+
 /**
  * @brief Check if SIM presence is currently asserted.
  * 
@@ -398,6 +1326,13 @@ int8_t rbGetBoardTemp(void);
  */
 bool rbGetCardPresent(void);
 
+/**
+ * @brief Device variant of rbGetCardPresent().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceGetCardPresent(rbDevice_t * device);
+
 /**
  * @brief Check if SIM card is present, communicating properly with,
  * and has presented no errors in SIM transactions with the
@@ -409,6 +1344,13 @@ bool rbGetCardPresent(void);
  */
 bool rbGetSimConnected(void);
 
+/**
+ * @brief Device variant of rbGetSimConnected().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceGetSimConnected(rbDevice_t * device);
+
 /**
  * @brief Get the iccid.
  * 
@@ -416,6 +1358,13 @@ bool rbGetSimConnected(void);
  */
 char * rbGetIccid(void);
 
+/**
+ * @brief Device variant of rbGetIccid().
+ * 
+ * @param device pointer to the device.
+ */
+char * rbDeviceGetIccid(rbDevice_t * device);
+
 /**
  * @brief Get the Iridium modem firmware version as vX.Y.X
  * with X being the major number, Y being the minor number and X
@@ -425,6 +1374,63 @@ char * rbGetIccid(void);
  */
 char *  rbGetFirmwareVersion(void);
 
+/**
+ * @brief Device variant of rbGetFirmwareVersion().
+ * 
+ * @param device pointer to the device.
+ */
+char *  rbDeviceGetFirmwareVersion(rbDevice_t * device);
+
+/**
+ * @brief Get the most memory a single JSPR response has needed from the
+ * device's JSON arena.
+ *
+ * Responses that are parsed with cJSON are built in a fixed arena of
+ * JSPR_JSON_ARENA_SIZE bytes rather than on the heap, this is the
+ * high-water mark of that arena since the device was created.
+ *
+ * @return peak arena use in bytes.
+ */
+size_t rbGetJsonArenaHighWater(void);
+
+/**
+ * @brief Device variant of rbGetJsonArenaHighWater().
+ * 
+ * @param device pointer to the device.
+ */
+size_t rbDeviceGetJsonArenaHighWater(rbDevice_t * device);
+
+/**
+ * @brief Set the allocator cJSON falls back on outside the JSON arena.
+ *
+ * The library installs its own cJSON hooks once, the first time a device is
+ * initialised. An application that uses cJSON with its own allocator passes it
+ * here instead of calling cJSON_InitHooks(), so the two can coexist.
+ *
+ * @param allocate malloc() replacement, NULL restores malloc() and free().
+ * @param release free() replacement matching allocate.
+ */
+void rbSetJsonHooks(void * (*allocate)(size_t size), void (*release)(void * block));
+
+#ifdef RB_MO_JOURNAL
+/**
+ * @brief Get the number of MOs in the outbox journal that haven't completed.
+ *
+ * This includes MOs still waiting for space in the MO queue and those
+ * replayed by rbBegin() after a restart.
+ *
+ * @return MOs in the journal, 0 if no journal is configured.
+ */
+size_t rbGetMoJournalBacklog(void);
+
+/**
+ * @brief Device variant of rbGetMoJournalBacklog().
+ * 
+ * @param device pointer to the device.
+ */
+size_t rbDeviceGetMoJournalBacklog(rbDevice_t * device);
+#endif
+
 /**
  * @brief Requests a resynchronisation of the service configuration.
  * 
@@ -443,6 +1449,13 @@ char *  rbGetFirmwareVersion(void);
  */
 bool rbResyncServiceConfig(void);
 
+/**
+ * @brief Device variant of rbResyncServiceConfig().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceResyncServiceConfig(rbDevice_t * device);
+
 #if defined(KERMIT)
 /**
  * @brief A callback definition for the kermit transfer
@@ -466,6 +1479,13 @@ typedef void(*updateProgressCallback)(void * context, const unsigned long sofar,
  * * @note This is only defined if KERMIT was defined during the build.
  */
 bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progress, void * context);
+
+/**
+ * @brief Device variant of rbUpdateFirmware().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceUpdateFirmware (rbDevice_t * device, const char * firmwareFile, updateProgressCallback progress, void * context);
 #endif
 
 #ifdef RB_GPIO
@@ -489,6 +1509,13 @@ bool rbUpdateFirmware (const char * firmwareFile, updateProgressCallback progres
  */
 bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout);
 
+/**
+ * @brief Device variant of rbBeginGpio().
+ * 
+ * @param device pointer to the device.
+ */
+bool rbDeviceBeginGpio(rbDevice_t * device, char * port, const rbGpioTable_t * gpioInfo, const int timeout);
+
 /**
  * @brief Drives user defined pin (power enable) high and another
  * user defined pin (iridium enable) low to deinitialise the RB9704
@@ -498,37 +1525,14 @@ bool rbBeginGpio(char * port, const rbGpioTable_t * gpioInfo, const int timeout)
  * @return bool depicting success or failure.
  */
 bool rbEndGpio(const rbGpioTable_t * gpioInfo);
-#endif
-
-/**
- * @brief Calculate CRC for a buffer.
- *
- * @param buffer Pointer to the data buffer.
- * @param bufferLength Length of the buffer in bytes.
- * @param initialCRC Initial CRC value to start from.
- * @return Calculated CRC as an uint16_t.
- */
-static uint16_t calculateCrc(const uint8_t * buffer, const size_t bufferLength, const uint16_t initialCRC);
-
-/**
- * @brief Append CRC to the end of a buffer.
- *
- * @param buffer Pointer to the buffer to append CRC to.
- * @param length Length of the buffer in bytes.
- * @return true on success, false on failure.
- */
-static bool appendCrc(uint8_t * buffer, size_t length);
 
 /**
- * @brief Encode binary data to base64 format.
- *
- * @param srcBuffer Pointer to source binary data.
- * @param srcLength Length of source data in bytes.
- * @param destBuffer Pointer to destination buffer for base64 string.
- * @param destLength Length of destination buffer.
- * @return Number of bytes written to destBuffer.
+ * @brief Device variant of rbEndGpio().
+ * 
+ * @param device pointer to the device.
  */
-static size_t encodeData(const char * srcBuffer, const size_t srcLength, char * destBuffer, const size_t destLength);
+bool rbDeviceEndGpio(rbDevice_t * device, const rbGpioTable_t * gpioInfo);
+#endif
 
 /**
  * @brief Decode base64 data back into binary.
@@ -544,82 +1548,77 @@ static size_t decodeData(const char * srcBuffer, const size_t srcLength, char *
 /**
  * @brief Clear any stale data leftover in serial buffers.
  *
+ * @param device Pointer to the device.
  */
-void clearLeftoverData(void);
+void clearLeftoverData(rbDevice_t * device);
 
 /**
  * @brief Set the modem API version.
  *
+ * @param device Pointer to the device.
  * @return true if successful, false otherwise.
  */
-bool setApi(void);
+bool setApi(rbDevice_t * device);
 
 /**
  * @brief Initialise SIM card configuration.
  *
+ * @param device Pointer to the device.
  * @return true if SIM setup succeeded, false otherwise.
  */
-bool setSim(void);
+bool setSim(rbDevice_t * device);
 
 /**
  * @brief Set operational state for the modem.
  *
+ * @param device Pointer to the device.
  * @return true if successful, false otherwise.
  */
-bool setState(void);
+bool setState(rbDevice_t * device);
 
 /**
  * @brief Check if the given topic is provisioned.
  *
+ * @param device Pointer to the device.
  * @param topic Topic ID to check.
  * @return true if the topic is provisioned, false otherwise.
  */
-static bool checkProvisioning(uint16_t topic);
+static bool checkProvisioning(rbDevice_t * device, uint16_t topic);
 
 /**
  * @brief Send a queued message using mobile originated (MO) transmission.
  *
+ * @param device Pointer to the device.
  * @param timeout Timeout duration in seconds.
  * @return true if message was sent successfully, false otherwise.
  */
-static bool sendMoFromQueue(const int timeout);
+static bool sendMoFromQueue(rbDevice_t * device, const int timeout);
 
 /**
  * @brief Listen for an incoming mobile terminated (MT) message.
  *
+ * @param device Pointer to the device.
  * @return true if a message was received, false otherwise.
  */
-static bool listenForMt(void);
+static bool listenForMt(rbDevice_t * device);
 
 /**
  * @brief Retrieve hardware information from the modem.
  *
+ * @param device Pointer to the device.
  * @param hwInfo Pointer to structure to populate with hardware info.
  * @return true on success, false on failure.
  */
-static bool getHwInfo(jsprHwInfo_t * hwInfo);
+static bool getHwInfo(rbDevice_t * device, jsprHwInfo_t * hwInfo);
 
 /**
  * @brief Get current SIM card status.
  *
+ * @param device Pointer to the device.
  * @param simStatus Pointer to structure to populate with SIM status.
  * @return true on success, false on failure.
  */
-static bool getSimStatus(jsprSimStatus_t * simStatus);
-
-/**
- * @brief Send a the modem a request to queue a message.
- *
- * @return true if request was sent successfully, false otherwise.
- */
-static bool sendMoFromQueueAsync(void);
-
-/**
- * @brief Checks if any more messages have been queued, if so, send them.
- *
- * @return true on success, false on failure.
- */
-static bool checkMoQueue(void);
+static bool getSimStatus(rbDevice_t * device, jsprSimStatus_t * simStatus);
 
 
 #ifdef __cplusplus
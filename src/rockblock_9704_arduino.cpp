@@ -1,30 +1,30 @@
 #ifdef ARDUINO
 #include "rockblock_9704.h"
+#include "rockblock_9704_device.h"
 #include "imt_queue.h"
 
-extern int messageReference;
-extern serialContext context;
-extern enum serialState serialState;
-
-bool rbBegin(Stream &port)
+bool rbDeviceBegin(rbDevice_t * device, Stream &port)
 {
     bool began = false;
-    if(SERIAL_CONTEXT_SETUP_FUNC(port, RB9704_BAUD))
+    if(SERIAL_CONTEXT_SETUP_FUNC(&device->context, port, RB9704_BAUD))
     {
-        if(context.serialInit != NULL)
+        if(device->context.serialInit != NULL)
         {
-            if(context.serialInit())
+            if(device->context.serialInit(&device->context))
             {
-                clearLeftoverData();
-                serialState = OPEN;
-                if(setApi())
+                clearLeftoverData(device);
+                resetJspr(&device->jspr);
+                device->context.serialState = OPEN;
+                if(setApi(device))
                 {
-                    if(setSim())
+                    if(setSim(device))
                     {
-                        if(setState())
+                        if(setState(device))
                         {
-                            imtQueueInit(); //initialise (clean) the queue
-                            began = true;
+                            if(setupQueues(device)) //build (or clean) the queues
+                            {
+                                began = true;
+                            }
                         }
                     }
                 }
@@ -34,4 +34,9 @@ bool rbBegin(Stream &port)
     return began;
 }
 
-#endif
\ No newline at end of file
+bool rbBegin(Stream &port)
+{
+    return rbDeviceBegin(rbDefaultDevice(), port);
+}
+
+#endif
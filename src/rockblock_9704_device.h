@@ -0,0 +1,141 @@
+#ifndef ROCKBLOCK_9704_DEVICE_H
+#define ROCKBLOCK_9704_DEVICE_H
+
+/**
+ * @file rockblock_9704_device.h
+ * @brief Internal layout of rbDevice_t, applications should only use the
+ * opaque handle declared in rockblock_9704.h.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rockblock_9704.h"
+#include "imt_queue.h"
+#include "imt_pool.h"
+#ifdef RB_MO_JOURNAL
+#include "mo_journal.h"
+#endif
+#ifdef RB_IO_THREAD
+#include "spsc_queue.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#define FIRMWARE_VERSION_STRING_LEN 13U
+
+#ifdef RB_IO_THREAD
+/**
+ * @brief An MO handed to the I/O thread, data is either a heap copy owned by the
+ * queue or a buffer lent by the application.
+ */
+typedef struct
+{
+    uint16_t topic;
+    size_t length;
+    char * data;
+    bool borrowed;
+    rbReleaseCallback release;
+    void * releaseContext;
+} rbIoSubmission_t;
+#endif
+
+/**
+ * @brief An application handler for a JSPR target, see rbDeviceRegisterTargetHandler().
+ */
+typedef struct
+{
+    char target[JSPR_MAX_TARGET_LENGTH];
+    rbTargetHandler handler;                            /**< NULL when the slot is free */
+    void * context;
+} rbTargetHandlerEntry_t;
+
+/**
+ * @brief A codec set for a topic, see rbDeviceSetTopicCodec().
+ */
+typedef struct
+{
+    uint16_t topic;
+    const rbCodec_t * codec;                            /**< NULL when the slot is free */
+} rbTopicCodecEntry_t;
+
+/**
+ * @brief Records waiting to go out as one MO, see rbDeviceSetTopicBatching().
+ */
+typedef struct
+{
+    uint16_t topic;
+    uint8_t * buffer;                                   /**< maxSize bytes, NULL when the slot is free */
+    size_t maxSize;                                     /**< Largest batch payload */
+    uint32_t maxAgeMs;                                  /**< Flush this long after the first record, 0 never */
+    size_t length;                                      /**< Bytes batched so far, length prefixes included */
+    uint16_t records;                                   /**< Records batched so far */
+    unsigned long openedAt;                             /**< millis() when the first record was batched */
+} rbTopicBatch_t;
+
+/**
+ * @brief Everything needed to talk to one RockBLOCK 9704 modem.
+ */
+struct rbDevice
+{
+    serialContext context;                              /**< Serial port and backend state */
+    jsprContext_t jspr;                                 /**< JSPR receive window and command buffer */
+    jsprResponse_t response;                            /**< Last framed JSPR line */
+    imt_queue_t imtMo;                                  /**< Outgoing (MO) message queue */
+    imt_queue_t imtMt;                                  /**< Incoming (MT) message queue */
+    char firmwareVersion[FIRMWARE_VERSION_STRING_LEN];  /**< Last reported firmware version string */
+    jsprHwInfo_t hwInfo;                                /**< Last reported hardware info */
+    jsprSimStatus_t simStatus;                          /**< Last reported SIM status */
+    jsprFirmwareInfo_t firmwareInfo;                    /**< Last reported firmware info */
+    jsprMessageProvisioning_t messageProvisioningInfo;  /**< Cached topic provisioning */
+    uint16_t moQueuedMessages;                          /**< MOs handed to the modem or waiting */
+    uint16_t moInFlight;                                /**< MOs at the head of the queue offered to the modem */
+    bool moAwaitedSent;                                 /**< Set when the MO a blocking send waits on succeeds */
+    bool mtDropped;                                     /**< Set when an MT fails without a callback registered */
+    bool mtReceived;                                    /**< Set when an MT completes without a callback registered */
+    const rbCallbacks_t * callbacks;                    /**< User callbacks, may be NULL */
+    const rbDeviceCallbacks_t * deviceCallbacks;        /**< Device aware user callbacks, may be NULL */
+    void * callbacksContext;                            /**< User pointer handed to deviceCallbacks */
+    rbTargetHandlerEntry_t targetHandlers[RB_MAX_TARGET_HANDLERS]; /**< Handlers for targets rbDevicePoll() doesn't process */
+    rbTopicCodecEntry_t topicCodecs[RB_MAX_TOPIC_CODECS]; /**< Compression applied per topic */
+    rbTopicBatch_t topicBatches[RB_MAX_TOPIC_BATCHES];  /**< Small MOs packed together per topic */
+    rbConfig_t config;                                  /**< Settings applied by the next rbDeviceBegin() */
+    imt_pool_t pool;                                    /**< Default backing store for both queues */
+#ifdef RB_MO_JOURNAL
+    mo_journal_t moJournal;                             /**< On-disk outbox feeding the MO queue, open when configured */
+#endif
+#ifdef RB_IO_THREAD
+    pthread_t ioThread;                                 /**< Thread running rbDevicePoll() when started */
+    atomic_bool ioRunning;                              /**< Cleared to ask the I/O thread to exit */
+    bool ioMtWasLocked;                                 /**< MT queue lock to restore when the thread stops */
+    spsc_queue_t moSubmit;                              /**< Application -> I/O thread, MOs to send */
+    rbIoSubmission_t moSubmitSlots[RB_IO_QUEUE_SIZE];
+    spsc_queue_t mtDeliver;                             /**< I/O thread -> application, completed MTs */
+    rbMessage_t * mtDeliverSlots;                       /**< One per MT queue entry, allocated on start */
+    spsc_queue_t mtRelease;                             /**< Application -> I/O thread, MTs finished with */
+    uint8_t * mtReleaseSlots;                           /**< One per MT queue entry, allocated on start */
+    uint32_t mtDeliveries;                              /**< MTs handed to the application, orders their release */
+#endif
+};
+
+/**
+ * @brief Reset a device to its power-on defaults, no port is attached.
+ *
+ * @param device Pointer to the device.
+ */
+void rbDeviceInit(rbDevice_t * device);
+
+/**
+ * @brief (Re)build the MO and MT queues from the device settings, called once the modem is set up.
+ *
+ * @param device Pointer to the device.
+ * @return true if both queues were built.
+ */
+bool setupQueues(rbDevice_t * device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
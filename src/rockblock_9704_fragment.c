@@ -0,0 +1,326 @@
+#include "rockblock_9704_fragment.h"
+#include "rockblock_9704_device.h"
+#include <stdlib.h>
+
+#define FRAGMENT_VERSION 1U
+#define MANIFEST_MAGIC "RBFM"
+#define MANIFEST_HEADER_SIZE 28U
+
+static void putUint32(uint8_t * out, const uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+static uint32_t getUint32(const uint8_t * in)
+{
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | (uint32_t)in[3];
+}
+
+static void putUint64(uint8_t * out, const uint64_t value)
+{
+    putUint32(out, (uint32_t)(value >> 32));
+    putUint32(out + 4, (uint32_t)value);
+}
+
+static uint64_t getUint64(const uint8_t * in)
+{
+    return ((uint64_t)getUint32(in) << 32) | (uint64_t)getUint32(in + 4);
+}
+
+static uint32_t fragmentCount(const uint64_t size, const uint32_t chunkSize)
+{
+    return (uint32_t)((size + chunkSize - 1U) / chunkSize);
+}
+
+static size_t fragmentLength(const uint64_t size, const uint32_t chunkSize, const uint32_t index)
+{
+    const uint64_t left = size - ((uint64_t)index * chunkSize);
+    return (left < chunkSize) ? (size_t)left : (size_t)chunkSize;
+}
+
+static bool moRoom(rbDevice_t * device)
+{
+    bool room = device->imtMo.count < device->imtMo.maxLength;
+#ifdef RB_MO_JOURNAL
+    room = room || device->moJournal.map != NULL; //waits in the journal, an append fails once it is full
+#endif
+    return room;
+}
+
+static bool topicBatched(rbDevice_t * device, const uint16_t topic)
+{
+    bool batched = false;
+    for(size_t i = 0; i < RB_MAX_TOPIC_BATCHES && !batched; i++)
+    {
+        batched = device->topicBatches[i].buffer != NULL && device->topicBatches[i].topic == topic;
+    }
+    return batched;
+}
+
+bool rbFragmentSenderInit(rbFragmentSender_t * sender, rbDevice_t * device, const uint16_t topic,
+                          const uint32_t transferId, const uint64_t size, const uint32_t chunkSize,
+                          rbFragmentRead read, void * context)
+{
+    bool initialised = false;
+    memset(sender, 0, sizeof(rbFragmentSender_t));
+    sender->chunkSize = (chunkSize == 0 || chunkSize > RB_FRAGMENT_MAX_CHUNK) ? (uint32_t)RB_FRAGMENT_MAX_CHUNK : chunkSize;
+    //a batched topic would put a length prefix in front of every fragment
+    if(device != NULL && read != NULL && size > 0 && ((size + sender->chunkSize - 1U) / sender->chunkSize) <= UINT32_MAX &&
+       !topicBatched(device, topic))
+    {
+        sender->buffer = (char *)malloc(RB_FRAGMENT_HEADER_SIZE + sender->chunkSize);
+        if(sender->buffer != NULL)
+        {
+            sender->device = device;
+            sender->topic = topic;
+            sender->transferId = transferId;
+            sender->size = size;
+            sender->count = fragmentCount(size, sender->chunkSize);
+            sender->read = read;
+            sender->context = context;
+            initialised = true;
+        }
+    }
+    return initialised;
+}
+
+bool rbFragmentSendOne(rbFragmentSender_t * sender, const uint32_t index)
+{
+    bool sent = false;
+    if(sender->buffer != NULL && index < sender->count)
+    {
+        uint8_t * header = (uint8_t *)sender->buffer;
+        const size_t length = fragmentLength(sender->size, sender->chunkSize, index);
+        header[0] = 'R';
+        header[1] = 'F';
+        header[2] = FRAGMENT_VERSION;
+        header[3] = 0;
+        putUint32(header + 4, sender->transferId);
+        putUint32(header + 8, index);
+        putUint32(header + 12, sender->chunkSize);
+        putUint64(header + 16, sender->size);
+        if(sender->read((uint64_t)index * sender->chunkSize, sender->buffer + RB_FRAGMENT_HEADER_SIZE, length, sender->context) == length)
+        {
+            sent = rbDeviceSendMessageAsync(sender->device, sender->topic, sender->buffer, RB_FRAGMENT_HEADER_SIZE + length); //copied into the MO queue
+        }
+    }
+    return sent;
+}
+
+uint32_t rbFragmentSenderPump(rbFragmentSender_t * sender)
+{
+    uint32_t queued = 0;
+    while(sender->next < sender->count && moRoom(sender->device))
+    {
+        if(!rbFragmentSendOne(sender, sender->next))
+        {
+            break; //tried again on the next pump
+        }
+        sender->next++;
+        queued++;
+    }
+    return queued;
+}
+
+bool rbFragmentSenderDone(const rbFragmentSender_t * sender)
+{
+    return sender->next >= sender->count;
+}
+
+void rbFragmentSenderFree(rbFragmentSender_t * sender)
+{
+    free(sender->buffer);
+    sender->buffer = NULL;
+}
+
+void rbFragmentReceiverInit(rbFragmentReceiver_t * receiver, rbFragmentWrite write, void * context, const uint64_t maxSize)
+{
+    memset(receiver, 0, sizeof(rbFragmentReceiver_t));
+    receiver->write = write;
+    receiver->context = context;
+    receiver->maxSize = (maxSize > 0) ? maxSize : RB_FRAGMENT_MAX_TRANSFER;
+}
+
+static bool startTransfer(rbFragmentReceiver_t * receiver, const uint32_t transferId, const uint32_t chunkSize, const uint64_t size)
+{
+    bool started = false;
+    //both come off the wire, bound them before the manifest is sized from them
+    if(chunkSize > 0 && chunkSize <= RB_FRAGMENT_MAX_CHUNK && size > 0 && size <= receiver->maxSize &&
+       ((size + chunkSize - 1U) / chunkSize) <= UINT32_MAX)
+    {
+        const uint32_t count = fragmentCount(size, chunkSize);
+        receiver->manifest = (uint8_t *)calloc((count + 7U) / 8U, 1U);
+        if(receiver->manifest != NULL)
+        {
+            receiver->transferId = transferId;
+            receiver->chunkSize = chunkSize;
+            receiver->size = size;
+            receiver->count = count;
+            receiver->received = 0;
+            started = true;
+        }
+    }
+    return started;
+}
+
+rbFragmentResult_t rbFragmentReceive(rbFragmentReceiver_t * receiver, const char * data, const size_t length)
+{
+    rbFragmentResult_t result = RB_FRAGMENT_INVALID;
+    const uint8_t * header = (const uint8_t *)data;
+
+    if(data != NULL && length >= RB_FRAGMENT_HEADER_SIZE && header[0] == 'R' && header[1] == 'F' && header[2] == FRAGMENT_VERSION)
+    {
+        const uint32_t transferId = getUint32(header + 4);
+        const uint32_t index = getUint32(header + 8);
+        const uint32_t chunkSize = getUint32(header + 12);
+        const uint64_t size = getUint64(header + 16);
+
+        if(receiver->manifest != NULL && (transferId != receiver->transferId || chunkSize != receiver->chunkSize || size != receiver->size))
+        {
+            result = RB_FRAGMENT_OTHER_TRANSFER;
+        }
+        else if(receiver->manifest != NULL || startTransfer(receiver, transferId, chunkSize, size))
+        {
+            if(index < receiver->count && length - RB_FRAGMENT_HEADER_SIZE == fragmentLength(size, chunkSize, index))
+            {
+                if(receiver->manifest[index / 8U] & (uint8_t)(1U << (index % 8U)))
+                {
+                    result = RB_FRAGMENT_DUPLICATE;
+                }
+                else if(receiver->write((uint64_t)index * chunkSize, data + RB_FRAGMENT_HEADER_SIZE,
+                                        length - RB_FRAGMENT_HEADER_SIZE, receiver->context))
+                {
+                    receiver->manifest[index / 8U] |= (uint8_t)(1U << (index % 8U));
+                    receiver->received++;
+                    result = (receiver->received == receiver->count) ? RB_FRAGMENT_COMPLETE : RB_FRAGMENT_STORED;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+uint32_t rbFragmentNextMissing(const rbFragmentReceiver_t * receiver, const uint32_t from)
+{
+    uint32_t index = from;
+    while(index < receiver->count && (receiver->manifest[index / 8U] & (uint8_t)(1U << (index % 8U))))
+    {
+        index++;
+    }
+    return (index < receiver->count) ? index : receiver->count;
+}
+
+void rbFragmentReceiverFree(rbFragmentReceiver_t * receiver)
+{
+    free(receiver->manifest);
+    receiver->manifest = NULL;
+    receiver->count = 0;
+    receiver->received = 0;
+}
+
+#ifndef ARDUINO
+#if defined(_WIN32)
+    #define fragmentSeek _fseeki64
+    #define fragmentTell _ftelli64
+#else
+    #define fragmentSeek fseeko
+    #define fragmentTell ftello
+#endif
+
+static size_t readFile(const uint64_t offset, char * buffer, const size_t length, void * context)
+{
+    size_t read = 0;
+    FILE * file = (FILE *)context;
+    if(fragmentSeek(file, offset, SEEK_SET) == 0)
+    {
+        read = fread(buffer, 1U, length, file);
+    }
+    return read;
+}
+
+static bool writeFile(const uint64_t offset, const char * data, const size_t length, void * context)
+{
+    bool written = false;
+    FILE * file = (FILE *)context;
+    if(fragmentSeek(file, offset, SEEK_SET) == 0)
+    {
+        written = fwrite(data, 1U, length, file) == length && fflush(file) == 0;
+    }
+    return written;
+}
+
+bool rbFragmentSenderInitFile(rbFragmentSender_t * sender, rbDevice_t * device, const uint16_t topic,
+                              const uint32_t transferId, FILE * file, const uint32_t chunkSize)
+{
+    bool initialised = false;
+    memset(sender, 0, sizeof(rbFragmentSender_t));
+    if(file != NULL && fragmentSeek(file, 0, SEEK_END) == 0)
+    {
+        const int64_t size = (int64_t)fragmentTell(file);
+        if(size > 0)
+        {
+            initialised = rbFragmentSenderInit(sender, device, topic, transferId, (uint64_t)size, chunkSize, readFile, file);
+        }
+    }
+    return initialised;
+}
+
+void rbFragmentReceiverInitFile(rbFragmentReceiver_t * receiver, FILE * file, const uint64_t maxSize)
+{
+    rbFragmentReceiverInit(receiver, writeFile, file, maxSize);
+}
+
+bool rbFragmentManifestSave(const rbFragmentReceiver_t * receiver, FILE * file)
+{
+    bool saved = false;
+    uint8_t header[MANIFEST_HEADER_SIZE];
+    if(receiver->manifest != NULL && file != NULL)
+    {
+        memcpy(header, MANIFEST_MAGIC, 4U);
+        putUint32(header + 4, receiver->transferId);
+        putUint32(header + 8, receiver->chunkSize);
+        putUint64(header + 12, receiver->size);
+        putUint32(header + 20, receiver->count);
+        putUint32(header + 24, receiver->received);
+        const size_t mapSize = (receiver->count + 7U) / 8U;
+        saved = fwrite(header, 1U, MANIFEST_HEADER_SIZE, file) == MANIFEST_HEADER_SIZE &&
+                fwrite(receiver->manifest, 1U, mapSize, file) == mapSize && fflush(file) == 0;
+    }
+    return saved;
+}
+
+bool rbFragmentManifestLoad(rbFragmentReceiver_t * receiver, FILE * file)
+{
+    bool loaded = false;
+    uint8_t header[MANIFEST_HEADER_SIZE];
+    if(file != NULL && fread(header, 1U, MANIFEST_HEADER_SIZE, file) == MANIFEST_HEADER_SIZE && memcmp(header, MANIFEST_MAGIC, 4U) == 0)
+    {
+        rbFragmentReceiverFree(receiver);
+        if(startTransfer(receiver, getUint32(header + 4), getUint32(header + 8), getUint64(header + 12)) &&
+           receiver->count == getUint32(header + 20))
+        {
+            const size_t mapSize = (receiver->count + 7U) / 8U;
+            if(fread(receiver->manifest, 1U, mapSize, file) == mapSize)
+            {
+                receiver->received = 0;
+                for(uint32_t i = 0; i < receiver->count; i++) //recount rather than trust the header
+                {
+                    if(receiver->manifest[i / 8U] & (uint8_t)(1U << (i % 8U)))
+                    {
+                        receiver->received++;
+                    }
+                }
+                loaded = true;
+            }
+        }
+        if(!loaded)
+        {
+            rbFragmentReceiverFree(receiver);
+        }
+    }
+    return loaded;
+}
+#endif
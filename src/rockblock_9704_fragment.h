@@ -0,0 +1,256 @@
+#ifndef ROCKBLOCK_9704_FRAGMENT_H
+#define ROCKBLOCK_9704_FRAGMENT_H
+
+/**
+ * @file rockblock_9704_fragment.h
+ * @brief Send and receive payloads larger than IMT_PAYLOAD_SIZE as a run of
+ * numbered messages on one topic.
+ *
+ * Every fragment starts with an RB_FRAGMENT_HEADER_SIZE byte header (big endian):
+ * 'R' 'F', version, reserved, transfer id (4), fragment index (4), chunk size (4)
+ * and the size of the whole transfer (8). Fragment n carries bytes
+ * [n * chunk size, (n + 1) * chunk size) of the transfer, so fragments can be
+ * written straight to their place in the output in any order.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rockblock_9704.h"
+#include "imt_queue.h"
+
+/**
+ * @def RB_FRAGMENT_HEADER_SIZE
+ * @brief Bytes in front of the data of every fragment.
+ */
+#define RB_FRAGMENT_HEADER_SIZE 24U
+
+/**
+ * @def RB_FRAGMENT_MAX_CHUNK
+ * @brief Largest chunk a fragment can carry, the header, IMT CRC and the one byte
+ * header of a topic codec still fit in one message.
+ */
+#define RB_FRAGMENT_MAX_CHUNK ((IMT_PAYLOAD_SIZE) - IMT_CRC_SIZE - RB_FRAGMENT_HEADER_SIZE - 1U)
+
+/**
+ * @def RB_FRAGMENT_MAX_TRANSFER
+ * @brief Largest transfer a receiver accepts unless it is given its own limit,
+ * it also bounds the manifest to one bit per byte of it.
+ */
+#ifndef RB_FRAGMENT_MAX_TRANSFER
+    #define RB_FRAGMENT_MAX_TRANSFER (16UL * 1024UL * 1024UL)
+#endif
+
+/**
+ * @brief Read part of a transfer for the sender.
+ *
+ * @param offset Byte offset in the transfer.
+ * @param buffer Where to put the bytes.
+ * @param length Number of bytes wanted.
+ * @param context User pointer given to the sender.
+ * @return Number of bytes read, anything short of length fails the fragment.
+ */
+typedef size_t (*rbFragmentRead)(const uint64_t offset, char * buffer, const size_t length, void * context);
+
+/**
+ * @brief Write part of a transfer for the receiver.
+ *
+ * @param offset Byte offset in the transfer.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @param context User pointer given to the receiver.
+ * @return false if the bytes could not be stored, the fragment is not marked received.
+ */
+typedef bool (*rbFragmentWrite)(const uint64_t offset, const char * data, const size_t length, void * context);
+
+/**
+ * @brief Outgoing transfer, only ever holds one fragment in memory.
+ */
+typedef struct
+{
+    rbDevice_t * device;        /**< Device the fragments are sent with */
+    uint16_t topic;             /**< Topic of every fragment */
+    uint32_t transferId;        /**< Identifies the transfer to the receiver */
+    uint64_t size;              /**< Bytes in the transfer */
+    uint32_t chunkSize;         /**< Data bytes per fragment, the last one may be shorter */
+    uint32_t count;             /**< Fragments in the transfer */
+    uint32_t next;              /**< Next fragment rbFragmentSenderPump() queues, set it to resume */
+    rbFragmentRead read;        /**< Source of the transfer */
+    void * context;             /**< User pointer passed to read */
+    char * buffer;              /**< One fragment, header included */
+} rbFragmentSender_t;
+
+/**
+ * @brief Incoming transfer and its manifest of the fragments received.
+ */
+typedef struct
+{
+    uint32_t transferId;        /**< Transfer being received, taken from the first fragment */
+    uint64_t size;              /**< Bytes in the transfer */
+    uint32_t chunkSize;         /**< Data bytes per fragment */
+    uint32_t count;             /**< Fragments in the transfer, 0 until the first one arrives */
+    uint32_t received;          /**< Fragments stored so far */
+    uint8_t * manifest;         /**< One bit per fragment, set once it has been stored */
+    uint64_t maxSize;           /**< Largest transfer accepted, anything bigger is invalid */
+    rbFragmentWrite write;      /**< Destination of the transfer */
+    void * context;             /**< User pointer passed to write */
+} rbFragmentReceiver_t;
+
+/**
+ * @brief Result of handing an MT to rbFragmentReceive().
+ */
+typedef enum
+{
+    RB_FRAGMENT_INVALID = -1,   /**< Not a fragment, malformed, or it couldn't be stored */
+    RB_FRAGMENT_STORED,         /**< New fragment stored */
+    RB_FRAGMENT_DUPLICATE,      /**< Fragment was already stored */
+    RB_FRAGMENT_COMPLETE,       /**< Fragment stored and the transfer is whole */
+    RB_FRAGMENT_OTHER_TRANSFER  /**< Fragment of a different transfer, nothing was stored */
+} rbFragmentResult_t;
+
+/**
+ * @brief Start an outgoing transfer.
+ *
+ * @param sender Pointer to the sender.
+ * @param device Device to send with, rbDefaultDevice() for the functions without a handle.
+ * @param topic Topic every fragment is sent on.
+ * @param transferId Identifies the transfer to the receiver.
+ * @param size Bytes in the transfer.
+ * @param chunkSize Data bytes per fragment, 0 or anything above RB_FRAGMENT_MAX_CHUNK uses RB_FRAGMENT_MAX_CHUNK.
+ * @param read Called for each fragment's data.
+ * @param context User pointer passed to read.
+ * @return false if size is 0, the topic is batched (rbSetTopicBatching()) or the fragment
+ * buffer can't be allocated.
+ */
+bool rbFragmentSenderInit(rbFragmentSender_t * sender, rbDevice_t * device, const uint16_t topic,
+                          const uint32_t transferId, const uint64_t size, const uint32_t chunkSize,
+                          rbFragmentRead read, void * context);
+
+/**
+ * @brief Queue fragments with rbDeviceSendMessageAsync() while the MO queue has room.
+ *
+ * Call it from the poll loop until rbFragmentSenderDone(), fragments that
+ * can't be queued are tried again on the next call.
+ *
+ * @param sender Pointer to the sender.
+ * @return Number of fragments queued by this call.
+ */
+uint32_t rbFragmentSenderPump(rbFragmentSender_t * sender);
+
+/**
+ * @brief Queue a single fragment again, eg. one the receiver's manifest is missing.
+ *
+ * @param sender Pointer to the sender.
+ * @param index Fragment to queue.
+ * @return false if index is out of range or it couldn't be read or queued.
+ */
+bool rbFragmentSendOne(rbFragmentSender_t * sender, const uint32_t index);
+
+/**
+ * @brief Check whether every fragment has been queued.
+ *
+ * @param sender Pointer to the sender.
+ * @return true once the last fragment is queued.
+ */
+bool rbFragmentSenderDone(const rbFragmentSender_t * sender);
+
+/**
+ * @brief Free the sender's fragment buffer.
+ *
+ * @param sender Pointer to the sender.
+ */
+void rbFragmentSenderFree(rbFragmentSender_t * sender);
+
+/**
+ * @brief Get ready to receive a transfer.
+ *
+ * The size and chunk size come from the fragments themselves, so a transfer
+ * larger than maxSize, or with chunks that can't fit in one message, is refused
+ * before its manifest is allocated.
+ *
+ * @param receiver Pointer to the receiver.
+ * @param write Called with each new fragment's data.
+ * @param context User pointer passed to write.
+ * @param maxSize Largest transfer accepted, 0 uses RB_FRAGMENT_MAX_TRANSFER.
+ */
+void rbFragmentReceiverInit(rbFragmentReceiver_t * receiver, rbFragmentWrite write, void * context, const uint64_t maxSize);
+
+/**
+ * @brief Store an MT if it is a fragment of the transfer being received.
+ *
+ * The first fragment fixes the transfer, later ones must match its id,
+ * chunk size and size.
+ *
+ * @param receiver Pointer to the receiver.
+ * @param data MT payload, eg. from rbReceiveMessageAsync().
+ * @param length MT length.
+ * @return What was done with the MT.
+ */
+rbFragmentResult_t rbFragmentReceive(rbFragmentReceiver_t * receiver, const char * data, const size_t length);
+
+/**
+ * @brief Find the next fragment that hasn't been received.
+ *
+ * @param receiver Pointer to the receiver.
+ * @param from First index to look at.
+ * @return Index of the missing fragment, count if there are none from there on.
+ */
+uint32_t rbFragmentNextMissing(const rbFragmentReceiver_t * receiver, const uint32_t from);
+
+/**
+ * @brief Free the receiver's manifest.
+ *
+ * @param receiver Pointer to the receiver.
+ */
+void rbFragmentReceiverFree(rbFragmentReceiver_t * receiver);
+
+#ifndef ARDUINO
+/**
+ * @brief Start an outgoing transfer read from a file.
+ *
+ * @param sender Pointer to the sender.
+ * @param device Device to send with.
+ * @param topic Topic every fragment is sent on.
+ * @param transferId Identifies the transfer to the receiver.
+ * @param file File opened for binary reading, it must stay open until the transfer is done.
+ * @param chunkSize Data bytes per fragment, 0 uses RB_FRAGMENT_MAX_CHUNK.
+ * @return false if the file is empty or can't be sized, or the topic is batched.
+ */
+bool rbFragmentSenderInitFile(rbFragmentSender_t * sender, rbDevice_t * device, const uint16_t topic,
+                              const uint32_t transferId, FILE * file, const uint32_t chunkSize);
+
+/**
+ * @brief Get ready to receive a transfer into a file.
+ *
+ * @param receiver Pointer to the receiver.
+ * @param file File opened for binary update ("r+b" or "w+b"), fragments are written at their offset.
+ * @param maxSize Largest transfer accepted, 0 uses RB_FRAGMENT_MAX_TRANSFER.
+ */
+void rbFragmentReceiverInitFile(rbFragmentReceiver_t * receiver, FILE * file, const uint64_t maxSize);
+
+/**
+ * @brief Save the receiver's manifest so the transfer can be resumed after a restart.
+ *
+ * @param receiver Pointer to the receiver.
+ * @param file File opened for binary writing.
+ * @return false if nothing has been received yet or the write fails.
+ */
+bool rbFragmentManifestSave(const rbFragmentReceiver_t * receiver, FILE * file);
+
+/**
+ * @brief Load a manifest written by rbFragmentManifestSave(), fragments already
+ * received are then reported as duplicates.
+ *
+ * @param receiver Pointer to an initialised receiver.
+ * @param file File opened for binary reading.
+ * @return false if the manifest is not valid.
+ */
+bool rbFragmentManifestLoad(rbFragmentReceiver_t * receiver, FILE * file);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,15 +1,13 @@
 #include "serial.h"
+#include <string.h>
 
-//Serial Variables
-int serialConnection;
-enum serialState serialState = CLOSED;
-serialContext context =
+void serialInitContext(serialContext * context)
 {
-    NULL, // serialInit
-    NULL, // serialDeInit
-    NULL, // serialRead
-    NULL, // serialWrite
-    NULL, // serialPeek
-    "",
-    230400
-};
\ No newline at end of file
+    if (context != NULL)
+    {
+        memset(context, 0, sizeof(serialContext));
+        context->serialBaud = 230400;
+        context->serialReadTimeoutUs = SERIAL_READ_TIMEOUT_US;
+        context->serialState = CLOSED;
+    }
+}
@@ -8,6 +8,7 @@ extern "C" {
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #if defined(_WIN32)
 #include <io.h>
@@ -18,32 +19,73 @@ extern "C" {
 
 #define SERIAL_PORT_LENGTH 50U // Should be more than enough, don't want to use PATH_MAX as it will be wasteful
 
-// Callback functions which will link to the serial interface
-typedef bool(*serialInitFunc)();
-typedef bool(*serialDeInitFunc)();
-typedef int(*serialReadFunc)(char * bytes, const uint16_t length);
-typedef int(*serialWriteFunc)(const char * data, const uint16_t length);
-typedef int(*serialPeekFunc)(void);
+/**
+ * @def SERIAL_READ_TIMEOUT_US
+ * @brief Default for serialContext::serialReadTimeoutUs, 1s on Arduino to match the Stream timeout it used before.
+ */
+#ifndef SERIAL_READ_TIMEOUT_US
+    #ifdef ARDUINO
+        #define SERIAL_READ_TIMEOUT_US 1000000U
+    #else
+        #define SERIAL_READ_TIMEOUT_US 500000U
+    #endif
+#endif
+
+typedef struct serialContext serialContext;
 
+/**
+ * @brief One piece of a scatter-gather write, see serialWritevFunc.
+ */
 typedef struct
+{
+    const char * data;
+    size_t length;
+} serialSpan_t;
+
+// Callback functions which will link to the serial interface, each is handed the context of the port it acts on
+typedef bool(*serialInitFunc)(serialContext * context);
+typedef bool(*serialDeInitFunc)(serialContext * context);
+typedef int(*serialReadFunc)(serialContext * context, char * bytes, const uint16_t length);
+typedef int(*serialWriteFunc)(serialContext * context, const char * data, const uint16_t length);
+typedef int(*serialWritevFunc)(serialContext * context, const serialSpan_t * spans, const size_t count);
+typedef int(*serialPeekFunc)(serialContext * context);
+typedef int(*serialWaitFunc)(serialContext * context, const uint32_t timeoutMs);
+typedef void(*serialWakeFunc)(serialContext * context);
+typedef void(*serialReleaseFunc)(serialContext * context);
+
+enum serialState
+{
+    CLOSED,
+    OPEN,
+};
+
+struct serialContext
 {
     serialInitFunc           serialInit;
     serialDeInitFunc         serialDeInit;
     serialReadFunc           serialRead;
     serialWriteFunc          serialWrite;
+    serialWritevFunc         serialWritev;  // Optional, write all spans in order as one call, returns the total written or -1
     serialPeekFunc           serialPeek;
+    serialWaitFunc           serialWait;    // Optional, block until readable (>0), timeout or wake (0) or error (-1)
+    serialWakeFunc           serialWake;    // Optional, interrupt a pending serialWait
+    serialReleaseFunc        serialRelease; // Optional, free anything the backend allocated for this port
     char                     serialPort[SERIAL_PORT_LENGTH];
     uint32_t                 serialBaud;
-} serialContext;
-
-enum serialState
-{
-    CLOSED,
-    OPEN,
+    uint32_t                 serialReadTimeoutUs; // Longest serialRead waits for the first byte when none is buffered, 0 never waits
+    enum serialState         serialState;
+    void *                   serialHandle;  // Backend owned state of this port
 };
 
+/**
+ * @brief Reset a serial context to its defaults, with no backend attached.
+ *
+ * @param context Pointer to the context to initialise.
+ */
+void serialInitContext(serialContext * context);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
@@ -2,55 +2,51 @@
 #include "serial_arduino.h"
 #include "../../serial.h"
 
-//Serial Variables
-extern int serialConnection;
-extern enum serialState serialState;
-Stream *serialPortArduino;
-extern serialContext context;
+#define STREAM_OF(context) ((Stream *)(context)->serialHandle)
 
-bool openPortArduino()
+bool openPortArduino(serialContext * context)
 {
-    serialState = OPEN;
-    serialPortArduino->setTimeout(1000);
+    context->serialState = OPEN;
     return true;
 }
 
-bool closePortArduino()
+bool closePortArduino(serialContext * context)
 {
-    serialState = CLOSED;
+    context->serialState = CLOSED;
     return true;
 }
 
-int readArduino(char * bytes, const uint16_t length)
+int readArduino(serialContext * context, char * bytes, const uint16_t length)
 {
-    return (int)serialPortArduino->readBytes(bytes, length);
+    STREAM_OF(context)->setTimeout((context->serialReadTimeoutUs + 999U) / 1000U); // Rounded up, Stream counts in ms
+    return (int)STREAM_OF(context)->readBytes(bytes, length);
 }
 
-int writeArduino(const char * data, const uint16_t length)
+int writeArduino(serialContext * context, const char * data, const uint16_t length)
 {
-    return (int)serialPortArduino->write(data, length);
+    return (int)STREAM_OF(context)->write(data, length);
 }
 
-int peekArduino(void)
+int peekArduino(serialContext * context)
 {
-    return (int)serialPortArduino->available();
+    return (int)STREAM_OF(context)->available();
 }
 
-bool setContextArduino(Stream &port, const uint32_t baud)
+bool setContextArduino(serialContext * context, Stream &port, const uint32_t baud)
 {
 bool set = false;
 
-    serialPortArduino = &port;
-    context.serialBaud = baud;
-    context.serialInit = openPortArduino;
-    context.serialDeInit = closePortArduino;
-    context.serialRead = readArduino;
-    context.serialWrite = writeArduino;
-    context.serialPeek = peekArduino;
+    context->serialHandle = &port;
+    context->serialBaud = baud;
+    context->serialInit = openPortArduino;
+    context->serialDeInit = closePortArduino;
+    context->serialRead = readArduino;
+    context->serialWrite = writeArduino;
+    context->serialPeek = peekArduino;
 
-    if(context.serialInit()) //Open and close the port to test
+    if(context->serialInit(context)) //Open and close the port to test
     {
-        if(context.serialDeInit())
+        if(context->serialDeInit(context))
         {
             set = true;
         }
@@ -10,54 +10,65 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "../../serial.h"
 
 /**
  * @brief Opens the Arduino serial port.
  *
+ * @param context The serial context.
  * @return true if the port was opened successfully, false otherwise.
  */
-bool openPortArduino(void);
+bool openPortArduino(serialContext * context);
 
 /**
  * @brief Closes the currently open Arduino serial port.
  *
+ * @param context The serial context.
  * @return true if the port was closed successfully, false otherwise.
  */
-bool closePortArduino(void);
+bool closePortArduino(serialContext * context);
 
 /**
  * @brief Reads data from the Arduino serial interface.
  *
+ * Waits up to serialContext::serialReadTimeoutUs (rounded up to whole ms) for each byte.
+ *
+ * @param context The serial context.
  * @param bytes Buffer to store the received data.
  * @param length Maximum number of bytes to read.
  * @return Number of bytes actually read.
  */
-int readArduino(char * bytes, const uint16_t length);
+int readArduino(serialContext * context, char * bytes, const uint16_t length);
 
 /**
  * @brief Writes data to the Arduino serial interface.
  *
+ * @param context The serial context.
  * @param data Pointer to the data to send.
  * @param length Number of bytes to write.
  * @return Number of bytes actually written.
  */
-int writeArduino(const char * data, const uint16_t length);
+int writeArduino(serialContext * context, const char * data, const uint16_t length);
 
 /**
  * @brief Peeks at the number of bytes available in the receive buffer.
  *
+ * @param context The serial context.
  * @return Number of bytes available to read.
  */
-int peekArduino(void);
+int peekArduino(serialContext * context);
 
 /**
  * @brief Sets the communication context for Arduino serial connection.
  *
+ * The Stream is kept in serialContext::serialHandle.
+ *
+ * @param context The serial context to populate.
  * @param port String of the Arduino serial port i.e. Serial1 Serial2
  * @param baud The baud rate for communication (e.g., 9600, 115200), should be 230400 for JSPR.
  * @return true if the context was set successfully, false otherwise.
  */
-bool setContextArduino(Stream &port, const uint32_t baud);
+bool setContextArduino(serialContext * context, Stream &port, const uint32_t baud);
 
 #ifdef __cplusplus
 }
@@ -2,31 +2,308 @@
 #include "serial_linux.h"
 #include "serial.h"
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/select.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/serial.h>
+#endif
+
+#define PORT(context) ((serialLinuxPort_t *)(context)->serialHandle)
+#define FD(context) (PORT(context)->fd)
+
+static void rxRingReset(serialLinuxPort_t * port)
+{
+    port->rxHead = 0;
+    port->rxCount = 0;
+}
+
+static size_t rxRingDrain(serialLinuxPort_t * port, char * bytes, const size_t length)
+{
+    size_t copied = 0;
+    while (copied < length && port->rxCount > 0)
+    {
+        size_t chunk = SERIAL_LINUX_RX_BUFFER_SIZE - port->rxHead;
+        if (chunk > port->rxCount)
+        {
+            chunk = port->rxCount;
+        }
+        if (chunk > length - copied)
+        {
+            chunk = length - copied;
+        }
+        memcpy(&bytes[copied], &port->rxRing[port->rxHead], chunk);
+        port->rxHead = (port->rxHead + chunk) % SERIAL_LINUX_RX_BUFFER_SIZE;
+        port->rxCount -= chunk;
+        copied += chunk;
+    }
+    if (port->rxCount == 0)
+    {
+        port->rxHead = 0; // Keep the free space contiguous so the next fill is a single iovec
+    }
+    return copied;
+}
+
+static int rxRingFill(serialLinuxPort_t * port)
+{
+    struct iovec iov[2];
+    int iovCount = 0;
+    size_t tail = (port->rxHead + port->rxCount) % SERIAL_LINUX_RX_BUFFER_SIZE;
+    size_t space = SERIAL_LINUX_RX_BUFFER_SIZE - port->rxCount;
+    ssize_t result;
+
+    if (space == 0)
+    {
+        return 0;
+    }
+
+    iov[0].iov_base = &port->rxRing[tail];
+    iov[0].iov_len = (tail >= port->rxHead) ? (SERIAL_LINUX_RX_BUFFER_SIZE - tail) : (port->rxHead - tail);
+    if (iov[0].iov_len > space)
+    {
+        iov[0].iov_len = space;
+    }
+    iovCount++;
+    if (iov[0].iov_len < space)
+    {
+        iov[1].iov_base = &port->rxRing[0];
+        iov[1].iov_len = space - iov[0].iov_len;
+        iovCount++;
+    }
+
+    result = readv(port->fd, iov, iovCount);
+    port->stats.readCalls++;
+    if (result < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return 0;
+        }
+        fprintf(stderr, "Error: Could not read from serial port\r\n");
+        return -1;
+    }
+    port->rxCount += (size_t)result;
+    port->stats.bytesRead += (uint64_t)result;
+    return (int)result;
+}
+
+static bool openEvents(serialLinuxPort_t * port)
+{
+#if defined(__linux__)
+    struct epoll_event event;
+    port->eventPoll = epoll_create1(EPOLL_CLOEXEC);
+    port->eventWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (port->eventPoll < 0 || port->eventWake < 0)
+    {
+        return false;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = port->fd;
+    if (epoll_ctl(port->eventPoll, EPOLL_CTL_ADD, port->fd, &event) != 0)
+    {
+        return false;
+    }
+    event.data.fd = port->eventWake;
+    if (epoll_ctl(port->eventPoll, EPOLL_CTL_ADD, port->eventWake, &event) != 0)
+    {
+        return false;
+    }
+#else
+    if (pipe(port->eventWakePipe) != 0)
+    {
+        return false;
+    }
+    fcntl(port->eventWakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(port->eventWakePipe[1], F_SETFL, O_NONBLOCK);
+#endif
+    return true;
+}
+
+static void closeEvents(serialLinuxPort_t * port)
+{
+#if defined(__linux__)
+    if (port->eventPoll >= 0)
+    {
+        close(port->eventPoll);
+        port->eventPoll = -1;
+    }
+    if (port->eventWake >= 0)
+    {
+        close(port->eventWake);
+        port->eventWake = -1;
+    }
+#else
+    for (int i = 0; i < 2; i++)
+    {
+        if (port->eventWakePipe[i] >= 0)
+        {
+            close(port->eventWakePipe[i]);
+            port->eventWakePipe[i] = -1;
+        }
+    }
+#endif
+}
+
+static int rxRingWait(serialLinuxPort_t * port, struct timeval * timeout)
+{
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(port->fd, &read_fds);
+    port->stats.selectCalls++;
+    return select(port->fd + 1, &read_fds, NULL, NULL, timeout);
+}
+
+#if defined(__linux__)
+static bool latencyTimerPath(const char * serialPort, char * path, const size_t size)
+{
+    char resolved[PATH_MAX];
+    const char * name;
+    if (realpath(serialPort, resolved) == NULL) // Follow /dev/serial/by-id and similar links to the tty
+    {
+        return false;
+    }
+    name = strrchr(resolved, '/');
+    name = (name != NULL) ? name + 1 : resolved;
+    return snprintf(path, size, "/sys/bus/usb-serial/devices/%s/latency_timer", name) < (int)size;
+}
+
+static int readLatencyTimer(const char * path)
+{
+    int value = -1;
+    FILE * file = fopen(path, "r");
+    if (file != NULL)
+    {
+        if (fscanf(file, "%d", &value) != 1)
+        {
+            value = -1;
+        }
+        fclose(file);
+    }
+    return value;
+}
 
-//Serial Variables
-extern int serialConnection;
-extern enum serialState serialState;
-extern serialContext context;
+static bool writeLatencyTimer(const char * path, const int value)
+{
+    bool written = false;
+    FILE * file = fopen(path, "w");
+    if (file != NULL)
+    {
+        written = fprintf(file, "%d", value) > 0;
+        written = (fclose(file) == 0) && written;
+    }
+    return written;
+}
+#endif
 
-bool setContextLinux(const char * port, const uint32_t baud)
+// Best effort, anything the port or driver doesn't support is left as it was
+static void applyLowLatency(serialContext * context)
+{
+#if defined(__linux__)
+    serialLinuxPort_t * port = PORT(context);
+    struct serial_struct serial;
+    char path[PATH_MAX];
+
+    if (ioctl(port->fd, TIOCGSERIAL, &serial) == 0)
+    {
+        if (serial.flags & ASYNC_LOW_LATENCY)
+        {
+            port->lowLatencyApplied |= SERIAL_LINUX_LOW_LATENCY_ASYNC;
+        }
+        else
+        {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            if (ioctl(port->fd, TIOCSSERIAL, &serial) == 0)
+            {
+                port->lowLatencyApplied |= SERIAL_LINUX_LOW_LATENCY_ASYNC;
+                port->asyncLowLatencyRestore = true;
+            }
+        }
+    }
+    if (latencyTimerPath(context->serialPort, path, sizeof(path)) && access(path, W_OK) == 0)
+    {
+        const int previous = readLatencyTimer(path);
+        if (previous == (int)SERIAL_LINUX_LATENCY_TIMER_MS)
+        {
+            port->lowLatencyApplied |= SERIAL_LINUX_LOW_LATENCY_TIMER;
+        }
+        else if (previous >= 0 && writeLatencyTimer(path, (int)SERIAL_LINUX_LATENCY_TIMER_MS))
+        {
+            port->lowLatencyApplied |= SERIAL_LINUX_LOW_LATENCY_TIMER;
+            port->latencyTimerRestore = previous;
+        }
+    }
+#else
+    (void)context;
+#endif
+}
+
+static void restoreLowLatency(serialContext * context)
+{
+#if defined(__linux__)
+    serialLinuxPort_t * port = PORT(context);
+    struct serial_struct serial;
+    char path[PATH_MAX];
+
+    if (port->asyncLowLatencyRestore && ioctl(port->fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags &= ~ASYNC_LOW_LATENCY;
+        (void)ioctl(port->fd, TIOCSSERIAL, &serial);
+    }
+    if (port->latencyTimerRestore >= 0 && latencyTimerPath(context->serialPort, path, sizeof(path)))
+    {
+        (void)writeLatencyTimer(path, port->latencyTimerRestore);
+    }
+#endif
+    PORT(context)->asyncLowLatencyRestore = false;
+    PORT(context)->latencyTimerRestore = -1;
+    PORT(context)->lowLatencyApplied = 0;
+}
+
+bool setContextLinux(serialContext * context, const char * port, const uint32_t baud)
 {
     bool set = false;
-    strncpy(context.serialPort, port, SERIAL_PORT_LENGTH);
-    context.serialBaud = baud;
-    context.serialInit = openPortLinux;
-    context.serialDeInit = closePortLinux;
-    context.serialRead = readLinux;
-    context.serialWrite = writeLinux;
-    context.serialPeek = peekLinux;
+    if(context->serialHandle == NULL)
+    {
+        context->serialHandle = calloc(1, sizeof(serialLinuxPort_t));
+        if(context->serialHandle == NULL)
+        {
+            return false;
+        }
+        PORT(context)->fd = -1;
+        PORT(context)->latencyTimerRestore = -1;
+#if defined(__linux__)
+        PORT(context)->eventPoll = -1;
+        PORT(context)->eventWake = -1;
+#else
+        PORT(context)->eventWakePipe[0] = -1;
+        PORT(context)->eventWakePipe[1] = -1;
+#endif
+    }
+    strncpy(context->serialPort, port, SERIAL_PORT_LENGTH);
+    context->serialBaud = baud;
+    context->serialInit = openPortLinux;
+    context->serialDeInit = closePortLinux;
+    context->serialRead = readLinux;
+    context->serialWrite = writeLinux;
+    context->serialWritev = writevLinux;
+    context->serialPeek = peekLinux;
+    context->serialWait = waitLinux;
+    context->serialWake = wakeLinux;
+    context->serialRelease = releaseLinux;
 
-    if(context.serialInit()) //Open and close the port to test
+    if(context->serialInit(context)) //Open and close the port to test
     {
-        if(context.serialDeInit())
+        if(context->serialDeInit(context))
         {
             set = true;
         }
@@ -34,20 +311,42 @@ bool setContextLinux(const char * port, const uint32_t baud)
     return set;
 }
 
-bool openPortLinux(void)
+void releaseLinux(serialContext * context)
 {
-    if(serialState != OPEN)
+    if(context->serialHandle != NULL)
     {
-        serialConnection = open(context.serialPort, O_RDWR | O_NOCTTY | O_SYNC | O_NONBLOCK);
-        if(0 > serialConnection)
+        if(context->serialState == OPEN)
+        {
+            closePortLinux(context);
+        }
+        free(context->serialHandle);
+        context->serialHandle = NULL;
+    }
+}
+
+bool openPortLinux(serialContext * context)
+{
+    if(context->serialState != OPEN)
+    {
+        rxRingReset(PORT(context));
+        FD(context) = open(context->serialPort, O_RDWR | O_NOCTTY | O_SYNC | O_NONBLOCK);
+        if(0 > FD(context))
         {
             return false;
         }
-        if(!configurePortLinux())
+        if(!configurePortLinux(context))
         {
             return false;
         }
-        serialState = OPEN;
+        if(!openEvents(PORT(context)))
+        {
+            fprintf(stderr, "Error: Could not set up serial events\r\n");
+            restoreLowLatency(context);
+            closeEvents(PORT(context));
+            close(FD(context));
+            return false;
+        }
+        context->serialState = OPEN;
         return true;
     }
     else
@@ -57,12 +356,16 @@ bool openPortLinux(void)
     }
 }
 
-bool closePortLinux(void)
+bool closePortLinux(serialContext * context)
 {
-    if(serialState != CLOSED)
+    if(context->serialState != CLOSED)
     {
-        close(serialConnection);
-        serialState = CLOSED;
+        restoreLowLatency(context);
+        closeEvents(PORT(context));
+        close(FD(context));
+        FD(context) = -1;
+        rxRingReset(PORT(context));
+        context->serialState = CLOSED;
         return true;
     }
     else
@@ -72,20 +375,20 @@ bool closePortLinux(void)
     }
 }
 
-bool configurePortLinux()
+bool configurePortLinux(serialContext * context)
 {
 struct termios options;
 
-    if(tcgetattr(serialConnection, &options) != 0) 
+    if(tcgetattr(FD(context), &options) != 0) 
     {
         fprintf(stderr, "Error: Could not get port attributes\r\n");
-        close(serialConnection);
+        close(FD(context));
         return false;
     }
     else
     {
-        cfsetispeed(&options, getBaudRate(context.serialBaud));
-        cfsetospeed(&options, getBaudRate(context.serialBaud));
+        cfsetispeed(&options, getBaudRate(context->serialBaud));
+        cfsetospeed(&options, getBaudRate(context->serialBaud));
 
         options.c_cflag &= ~CSIZE;          // Clear the character size mask
         options.c_cflag |= CS8;             // Set 8 data bits
@@ -97,13 +400,25 @@ struct termios options;
         // Disable canonical mode (input is not processed line-by-line)
         options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
 
+        if (PORT(context)->lowLatency)
+        {
+            // Reads return whatever has arrived rather than waiting for a count or inter-byte timer
+            options.c_cc[VMIN] = 0;
+            options.c_cc[VTIME] = 0;
+        }
+
         // Set the serial port options
-        if (tcsetattr(serialConnection, TCSANOW, &options) != 0) 
+        if (tcsetattr(FD(context), TCSANOW, &options) != 0) 
         {
             fprintf(stderr, "Error: Could not set port attributes\r\n");
-            close(serialConnection);
+            close(FD(context));
             return false;
         }
+        if (PORT(context)->lowLatency)
+        {
+            PORT(context)->lowLatencyApplied = SERIAL_LINUX_LOW_LATENCY_TERMIOS;
+            applyLowLatency(context);
+        }
     }
     return true;
 }
@@ -143,40 +458,42 @@ uint32_t getBaudRate(const uint32_t baudRate)
     }
 }
 
-int readLinux(char *bytes, const uint16_t length)
+int readLinux(serialContext * context, char *bytes, const uint16_t length)
 {
-    if (serialState == OPEN)
+    if (context->serialState == OPEN)
     {
-        int bytesRead = 0;
-        char ch;
+        serialLinuxPort_t * port = PORT(context);
+        size_t bytesRead = rxRingDrain(port, bytes, length);
 
-        struct timeval timeout = {0, 500000};
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        FD_SET(serialConnection, &read_fds);
-        int ready = select(serialConnection + 1, &read_fds, NULL, NULL, &timeout);
-        if (ready < 0)
-        {
-            fprintf(stderr, "Error: Failed while waiting for data\r\n");
-            return -1;
-        }
-        if (ready == 0) // Timeout, no data available
-        {
-            return -1;
-        }
-        while (bytesRead < length)
+        if (bytesRead < length)
         {
-            int result = read(serialConnection, &ch, 1);
-            if (result < 0)
+            if (rxRingFill(port) < 0)
             {
-                fprintf(stderr, "Error: Could not read from serial port\r\n");
                 return -1;
             }
-            bytes[bytesRead] = ch;
-            bytesRead++;
+            if (port->rxCount == 0 && bytesRead == 0)
+            {
+                struct timeval timeout = {(time_t)(context->serialReadTimeoutUs / 1000000U), (suseconds_t)(context->serialReadTimeoutUs % 1000000U)};
+                int ready = rxRingWait(port, &timeout);
+                if (ready < 0)
+                {
+                    fprintf(stderr, "Error: Failed while waiting for data\r\n");
+                    return -1;
+                }
+                if (ready == 0) // Timeout, no data available
+                {
+                    return -1;
+                }
+                if (rxRingFill(port) < 0)
+                {
+                    return -1;
+                }
+            }
+            bytesRead += rxRingDrain(port, &bytes[bytesRead], length - bytesRead);
         }
-        bytes[bytesRead] = '\0';
-        return bytesRead;
+
+        port->stats.bytesDelivered += bytesRead;
+        return (bytesRead > 0) ? (int)bytesRead : -1;
     }
     else
     {
@@ -185,58 +502,242 @@ int readLinux(char *bytes, const uint16_t length)
     }
 }
 
-int writeLinux(const char * data, const uint16_t length)
+static uint64_t monotonicUs(void)
 {
-    int rc = -1;
-    bool retry = false;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000U + (uint64_t)now.tv_nsec / 1000U;
+}
+
+static bool txWait(serialLinuxPort_t * port)
+{
+    struct pollfd fds;
+    int ready;
+    const uint64_t start = monotonicUs();
+
+    fds.fd = port->fd;
+    fds.events = POLLOUT;
+    fds.revents = 0;
+    do
+    {
+        ready = poll(&fds, 1, (int)SERIAL_LINUX_WRITE_TIMEOUT_MS);
+    } while (ready < 0 && errno == EINTR);
+    port->stats.writeBlocks++;
+    port->stats.writeBlockedUs += monotonicUs() - start;
+    if (ready == 0)
+    {
+        errno = ETIMEDOUT;
+    }
+    return ready > 0 && (fds.revents & POLLOUT);
+}
+
+int writevLinux(serialContext * context, const serialSpan_t * spans, const size_t count)
+{
+    struct iovec iov[SERIAL_LINUX_MAX_SPANS];
+    int iovCount = 0;
+    size_t length = 0;
     size_t bytesSent = 0;
-    size_t toSend = length;
-    if(serialState == OPEN)
+    bool failed = false;
+
+    if (context->serialState != OPEN)
+    {
+        fprintf(stderr, "Error: port not open, can't write\r\n");
+        return -1;
+    }
+    if (count > SERIAL_LINUX_MAX_SPANS)
     {
-        do
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (spans[i].length > 0)
         {
-            retry = false;
-            toSend = length - bytesSent;
-            rc = write(serialConnection, &data[bytesSent], toSend);
-            if(rc > 0)
-            {
-                bytesSent += rc;
-            }
-            else
-            {
-                retry = (errno == EAGAIN) ? true : false;
-            }
+            iov[iovCount].iov_base = (void *)spans[i].data;
+            iov[iovCount].iov_len = spans[i].length;
+            length += spans[i].length;
+            iovCount++;
+        }
+    }
+    if (length > INT32_MAX)
+    {
+        return -1;
+    }
 
+    serialLinuxPort_t * port = PORT(context);
+    struct iovec * next = iov;
+    while (!failed && bytesSent < length)
+    {
+        ssize_t rc = writev(port->fd, next, iovCount);
+        port->stats.writeCalls++;
+        if (rc > 0)
+        {
+            bytesSent += (size_t)rc;
+            port->stats.bytesWritten += (uint64_t)rc;
             if (bytesSent < length)
             {
-                retry = true;
+                port->stats.partialWrites++;
+                while ((size_t)rc >= next->iov_len) // Skip what went out, the rest carries on mid-span
+                {
+                    rc -= (ssize_t)next->iov_len;
+                    next++;
+                    iovCount--;
+                }
+                next->iov_base = (char *)next->iov_base + rc;
+                next->iov_len -= (size_t)rc;
             }
-            
-        } while (retry == true);
-
-        if (rc < 0)
+        }
+        else if (rc < 0 && errno == EINTR)
         {
-            fprintf(stderr, "Error: Could not write to serial port %s\r\n", (char*)strerror(errno));
+            // Interrupted before anything was written, try again
+        }
+        else if (rc == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            failed = !txWait(port); // Output buffer full, sleep until the port drains
+        }
+        else
+        {
+            failed = true;
         }
     }
-    else
+
+    if (failed)
     {
-        fprintf(stderr, "Error: port not open, can't write\r\n");
+        fprintf(stderr, "Error: Could not write to serial port %s\r\n", (char*)strerror(errno));
+        return -1;
     }
+    return (int)bytesSent;
+}
 
-    return rc;
+int writeLinux(serialContext * context, const char * data, const uint16_t length)
+{
+    const serialSpan_t span = { data, length };
+    return writevLinux(context, &span, 1);
 }
 
-int peekLinux(void)
+int peekLinux(serialContext * context)
 {
     int bytes = 0;
-    if (serialConnection > 0)
+    if (context->serialHandle != NULL && FD(context) > 0)
     {
-        if (ioctl(serialConnection, FIONREAD, &bytes) != 0)
+        if (ioctl(FD(context), FIONREAD, &bytes) != 0)
         {
             bytes = -1;
         }
+        else
+        {
+            bytes += (int)PORT(context)->rxCount;
+        }
     }
     return bytes;
 }
+
+int waitLinux(serialContext * context, const uint32_t timeoutMs)
+{
+    serialLinuxPort_t * port = PORT(context);
+    int readable = 0;
+    int ready;
+
+    if (context->serialState != OPEN)
+    {
+        return -1;
+    }
+    if (port->rxCount > 0)
+    {
+        return 1;
+    }
+
+    port->stats.waitCalls++;
+#if defined(__linux__)
+    struct epoll_event events[2];
+    ready = epoll_wait(port->eventPoll, events, 2, (timeoutMs > INT32_MAX) ? -1 : (int)timeoutMs);
+    for (int i = 0; i < ready; i++)
+    {
+        if (events[i].data.fd == port->eventWake)
+        {
+            uint64_t wakes;
+            (void)read(port->eventWake, &wakes, sizeof(wakes));
+        }
+        else
+        {
+            readable = 1;
+        }
+    }
+#else
+    struct pollfd fds[2];
+    fds[0].fd = port->fd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = port->eventWakePipe[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    ready = poll(fds, 2, (timeoutMs > INT32_MAX) ? -1 : (int)timeoutMs);
+    if (ready > 0)
+    {
+        if (fds[1].revents & POLLIN)
+        {
+            char wakes[16];
+            while (read(port->eventWakePipe[0], wakes, sizeof(wakes)) > 0)
+            {
+            }
+        }
+        readable = (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) ? 1 : 0;
+    }
+#endif
+    if (ready < 0)
+    {
+        readable = (errno == EINTR) ? 0 : -1;
+    }
+    return readable;
+}
+
+void wakeLinux(serialContext * context)
+{
+    serialLinuxPort_t * port = PORT(context);
+    if (port == NULL)
+    {
+        return;
+    }
+#if defined(__linux__)
+    const uint64_t wake = 1;
+    if (port->eventWake >= 0)
+    {
+        (void)write(port->eventWake, &wake, sizeof(wake));
+    }
+#else
+    const char wake = 1;
+    if (port->eventWakePipe[1] >= 0)
+    {
+        (void)write(port->eventWakePipe[1], &wake, sizeof(wake));
+    }
+#endif
+}
+
+void setLowLatencyLinux(serialContext * context, const bool enable)
+{
+    if (context->serialHandle != NULL)
+    {
+        PORT(context)->lowLatency = enable;
+    }
+}
+
+uint8_t getLowLatencyLinux(serialContext * context)
+{
+    return (context->serialHandle != NULL) ? PORT(context)->lowLatencyApplied : 0;
+}
+
+void getSerialStatsLinux(serialContext * context, serialLinuxStats_t * stats)
+{
+    if (stats != NULL && context->serialHandle != NULL)
+    {
+        *stats = PORT(context)->stats;
+    }
+}
+
+void resetSerialStatsLinux(serialContext * context)
+{
+    if (context->serialHandle != NULL)
+    {
+        memset(&PORT(context)->stats, 0, sizeof(serialLinuxStats_t));
+    }
+}
 #endif
\ No newline at end of file
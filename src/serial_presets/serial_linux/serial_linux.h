@@ -8,6 +8,8 @@ extern "C" {
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "serial.h"
 
 #if defined(_WIN32)
 #include <io.h>
@@ -16,60 +18,244 @@ extern "C" {
 #include <unistd.h>
 #endif
 
+/**
+ * @def SERIAL_LINUX_RX_BUFFER_SIZE
+ * @brief Size of the user-space receive ring buffer, filled from the port in
+ * bulk so that small reads are served from memory rather than one syscall each.
+ */
+#ifndef SERIAL_LINUX_RX_BUFFER_SIZE
+    #define SERIAL_LINUX_RX_BUFFER_SIZE 4096U
+#endif
+
+/**
+ * @def SERIAL_LINUX_WRITE_TIMEOUT_MS
+ * @brief Longest a write waits for the port to take more data before it fails.
+ */
+#ifndef SERIAL_LINUX_WRITE_TIMEOUT_MS
+    #define SERIAL_LINUX_WRITE_TIMEOUT_MS 2000U
+#endif
+
+/**
+ * @def SERIAL_LINUX_MAX_SPANS
+ * @brief Most spans writevLinux() takes in one call.
+ */
+#define SERIAL_LINUX_MAX_SPANS 8U
+
+/**
+ * @def SERIAL_LINUX_LATENCY_TIMER_MS
+ * @brief USB-serial latency timer the low-latency profile asks for, most adapters default to 16ms.
+ */
+#ifndef SERIAL_LINUX_LATENCY_TIMER_MS
+    #define SERIAL_LINUX_LATENCY_TIMER_MS 1U
+#endif
+
+/**
+ * @def SERIAL_LINUX_LOW_LATENCY_TERMIOS
+ * @brief Low-latency profile flag, VMIN/VTIME were set so reads return whatever has arrived.
+ */
+#define SERIAL_LINUX_LOW_LATENCY_TERMIOS 0x01U
+
+/**
+ * @def SERIAL_LINUX_LOW_LATENCY_ASYNC
+ * @brief Low-latency profile flag, the driver took ASYNC_LOW_LATENCY (Linux only).
+ */
+#define SERIAL_LINUX_LOW_LATENCY_ASYNC 0x02U
+
+/**
+ * @def SERIAL_LINUX_LOW_LATENCY_TIMER
+ * @brief Low-latency profile flag, the adapter's latency_timer was lowered (Linux only).
+ */
+#define SERIAL_LINUX_LOW_LATENCY_TIMER 0x04U
+
+/**
+ * @struct serialLinuxStats_t
+ * @brief Receive and transmit path counters for the Linux serial backend.
+ */
+typedef struct
+{
+    uint32_t readCalls;         /**< Number of read syscalls issued on the port */
+    uint32_t selectCalls;       /**< Number of select syscalls issued while waiting for data */
+    uint32_t waitCalls;         /**< Number of epoll/poll syscalls issued by waitLinux */
+    uint64_t bytesRead;         /**< Bytes pulled from the port into the ring buffer */
+    uint64_t bytesDelivered;    /**< Bytes handed out to callers of readLinux */
+    uint32_t writeCalls;        /**< Number of writev syscalls issued on the port */
+    uint32_t partialWrites;     /**< Writes the port took only part of */
+    uint32_t writeBlocks;       /**< Times a write waited for POLLOUT because the output buffer was full */
+    uint64_t writeBlockedUs;    /**< Microseconds spent waiting for POLLOUT */
+    uint64_t bytesWritten;      /**< Bytes the port accepted */
+} serialLinuxStats_t;
+
+/**
+ * @struct serialLinuxPort_t
+ * @brief Per-port state of the Linux serial backend, owned by serialContext::serialHandle.
+ */
+typedef struct
+{
+    int fd;                                         /**< File descriptor of the open port, -1 when closed */
+    char rxRing[SERIAL_LINUX_RX_BUFFER_SIZE];       /**< Receive ring buffer */
+    size_t rxHead;                                  /**< Index of the oldest buffered byte */
+    size_t rxCount;                                 /**< Number of buffered bytes */
+    serialLinuxStats_t stats;                       /**< Receive and transmit path counters */
+    bool lowLatency;                                /**< Apply the low-latency profile when the port is opened */
+    uint8_t lowLatencyApplied;                      /**< SERIAL_LINUX_LOW_LATENCY_* flags the last open managed to apply */
+    int latencyTimerRestore;                        /**< latency_timer to put back on close, -1 if untouched */
+    bool asyncLowLatencyRestore;                    /**< Clear ASYNC_LOW_LATENCY on close, it was set by the profile */
+#if defined(__linux__)
+    int eventPoll;                                  /**< epoll instance watching the port and wake eventfd */
+    int eventWake;                                  /**< eventfd used by wakeLinux() */
+#else
+    int eventWakePipe[2];                           /**< Self-pipe used by wakeLinux() */
+#endif
+} serialLinuxPort_t;
+
 /**
  * @brief Sets the serial communication context for a Linux system.
  *
+ * Allocates the per-port state on first use, it is freed by releaseLinux().
+ *
+ * @param context The serial context to populate.
  * @param port The name of the serial port (e.g., "/dev/ttyUSB0").
  * @param baud The baud rate for communication.
  * @return true if the context was set successfully, false otherwise.
  */
-bool setContextLinux(const char * port, const uint32_t baud);
+bool setContextLinux(serialContext * context, const char * port, const uint32_t baud);
+
+/**
+ * @brief Closes the port if needed and frees the per-port state of a context.
+ *
+ * @param context The serial context to release.
+ */
+void releaseLinux(serialContext * context);
 
 /**
  * @brief Opens the previously configured serial port.
  *
+ * @param context The serial context.
  * @return true if the port was opened successfully, false otherwise.
  */
-bool openPortLinux(void);
+bool openPortLinux(serialContext * context);
 
 /**
  * @brief Closes the currently open serial port.
  *
+ * @param context The serial context.
  * @return true if the port was closed successfully, false otherwise.
  */
-bool closePortLinux(void);
+bool closePortLinux(serialContext * context);
 
 /**
  * @brief Configures the open serial port with the desired settings.
  *
+ * @param context The serial context.
  * @return true if configuration was successful, false otherwise.
  */
-bool configurePortLinux(void);
+bool configurePortLinux(serialContext * context);
+
+/**
+ * @brief Opt in to the low-latency tty profile, applied the next time the port is opened.
+ *
+ * The profile sets VMIN/VTIME to 0 so a read returns whatever has arrived, asks
+ * the driver for ASYNC_LOW_LATENCY through TIOCSSERIAL and, for USB-serial
+ * adapters (FTDI, CP210x, ...), writes SERIAL_LINUX_LATENCY_TIMER_MS to
+ * /sys/bus/usb-serial/devices/<tty>/latency_timer when it is writable. Each step
+ * is skipped quietly when the port doesn't support it, the latency timer and
+ * ASYNC_LOW_LATENCY are put back when the port is closed. macOS only gets the
+ * termios step.
+ *
+ * @param context The serial context, set up with setContextLinux().
+ * @param enable true to apply the profile.
+ */
+void setLowLatencyLinux(serialContext * context, const bool enable);
+
+/**
+ * @brief Find out which parts of the low-latency profile the open port took.
+ *
+ * @param context The serial context.
+ * @return SERIAL_LINUX_LOW_LATENCY_* flags, 0 if the profile is off or nothing applied.
+ */
+uint8_t getLowLatencyLinux(serialContext * context);
 
 /**
  * @brief Writes data to the serial port.
  *
+ * When the output buffer is full the call sleeps in poll() for POLLOUT rather
+ * than retrying, for up to SERIAL_LINUX_WRITE_TIMEOUT_MS at a time.
+ *
+ * @param context The serial context.
  * @param data Pointer to the data to send.
  * @param length Number of bytes to write.
- * @return Number of bytes actually written, or -1 on failure.
+ * @return Number of bytes written, which is length, or -1 on failure.
  */
-int writeLinux(const char * data, const uint16_t length);
+int writeLinux(serialContext * context, const char * data, const uint16_t length);
+
+/**
+ * @brief Writes several buffers to the serial port with writev(), in order and
+ * without copying them together first.
+ *
+ * Partial writes carry on from where the port stopped, waiting for POLLOUT as
+ * writeLinux() does.
+ *
+ * @param context The serial context.
+ * @param spans The buffers to send.
+ * @param count Number of spans, at most SERIAL_LINUX_MAX_SPANS.
+ * @return Total number of bytes written, or -1 on failure.
+ */
+int writevLinux(serialContext * context, const serialSpan_t * spans, const size_t count);
 
 /**
  * @brief Reads data from the serial port.
  *
+ * Data is served from the receive ring buffer, which is topped up with a single
+ * non-blocking read of everything the port has available. If nothing is buffered
+ * the call waits up to serialContext::serialReadTimeoutUs for data to arrive.
+ *
+ * @param context The serial context.
  * @param bytes Buffer to store the received data.
  * @param length Maximum number of bytes to read.
- * @return Number of bytes actually read, or -1 on failure.
+ * @return Number of bytes actually read, or -1 on failure or timeout.
  */
-int readLinux(char * bytes, const uint16_t length);
+int readLinux(serialContext * context, char * bytes, const uint16_t length);
 
 /**
  * @brief Peeks at the number of bytes available in the receive buffer.
  *
- * @return Number of bytes available to read, or -1 on error.
+ * @param context The serial context.
+ * @return Number of bytes available to read (buffered plus pending in the port), or -1 on error.
+ */
+int peekLinux(serialContext * context);
+
+/**
+ * @brief Sleeps until the serial port is readable, wakeLinux() is called or the timeout elapses.
+ *
+ * Uses epoll with an eventfd on Linux and poll with a pipe on macOS.
+ *
+ * @param context The serial context.
+ * @param timeoutMs Maximum time to wait in milliseconds.
+ * @return 1 if data is available, 0 on timeout or wake-up, or -1 on error.
+ */
+int waitLinux(serialContext * context, const uint32_t timeoutMs);
+
+/**
+ * @brief Wakes a pending waitLinux() call, safe to use from another thread or a signal handler.
+ *
+ * @param context The serial context.
+ */
+void wakeLinux(serialContext * context);
+
+/**
+ * @brief Get the receive and transmit path counters of the Linux serial backend.
+ *
+ * @param context The serial context.
+ * @param stats Pointer to structure to populate with the counters.
+ */
+void getSerialStatsLinux(serialContext * context, serialLinuxStats_t * stats);
+
+/**
+ * @brief Reset the receive and transmit path counters of the Linux serial backend.
+ *
+ * @param context The serial context.
  */
-int peekLinux(void);
+void resetSerialStatsLinux(serialContext * context);
 
 /**
  * @brief Maps a standard baud rate to the corresponding Linux system constant.
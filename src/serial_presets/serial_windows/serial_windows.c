@@ -5,25 +5,22 @@
 #include <stdio.h>
 #include <stdbool.h>
 
-// Serial Variables
-extern HANDLE serialConnection;
-extern enum serialState serialState;
-extern serialContext context;
+#define HANDLE_OF(context) ((HANDLE)(context)->serialHandle)
 
-bool setContextWindows(const char * port, const uint32_t baud)
+bool setContextWindows(serialContext * context, const char * port, const uint32_t baud)
 {
     bool set = false;
-    snprintf(context.serialPort, SERIAL_PORT_LENGTH, "\\\\.\\%s", port);
-    context.serialBaud = baud;
-    context.serialInit = openPortWindows;
-    context.serialDeInit = closePortWindows;
-    context.serialRead = readWindows;
-    context.serialWrite = writeWindows;
-    context.serialPeek = peekWindows;
+    snprintf(context->serialPort, SERIAL_PORT_LENGTH, "\\\\.\\%s", port);
+    context->serialBaud = baud;
+    context->serialInit = openPortWindows;
+    context->serialDeInit = closePortWindows;
+    context->serialRead = readWindows;
+    context->serialWrite = writeWindows;
+    context->serialPeek = peekWindows;
 
-    if (context.serialInit()) // Open and close the port to test
+    if (context->serialInit(context)) // Open and close the port to test
     {
-        if (context.serialDeInit())
+        if (context->serialDeInit(context))
         {
             set = true;
         }
@@ -31,17 +28,18 @@ bool setContextWindows(const char * port, const uint32_t baud)
     return set;
 }
 
-bool openPortWindows(void)
+bool openPortWindows(serialContext * context)
 {
     bool opened = false;
-    if (serialState != OPEN)
+    if (context->serialState != OPEN)
     {
-        serialConnection = CreateFileA(context.serialPort, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-        if (serialConnection != INVALID_HANDLE_VALUE)
+        HANDLE handle = CreateFileA(context->serialPort, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (handle != INVALID_HANDLE_VALUE)
         {
-            if (configurePortWindows())
+            context->serialHandle = handle;
+            if (configurePortWindows(context))
             {
-                serialState = OPEN;
+                context->serialState = OPEN;
                 opened = true;
             }
         }
@@ -53,66 +51,80 @@ bool openPortWindows(void)
     return opened;
 }
 
-bool closePortWindows(void)
+bool closePortWindows(serialContext * context)
 {
     bool closed = false;
-    if (serialState != CLOSED)
+    if (context->serialState != CLOSED)
     {
-        CloseHandle(serialConnection);
-        serialState = CLOSED;
+        CloseHandle(HANDLE_OF(context));
+        context->serialHandle = NULL;
+        context->serialState = CLOSED;
         closed = true;
     }
     return closed;
 }
 
-bool configurePortWindows(void)
+// ReadFile returns as soon as a byte is buffered, otherwise waits up to the context's read timeout for one
+static bool setReadTimeout(serialContext * context)
+{
+    bool set = false;
+    COMMTIMEOUTS cto;
+    if (GetCommTimeouts(HANDLE_OF(context), &cto))
+    {
+        const DWORD timeoutMs = (DWORD)((context->serialReadTimeoutUs + 999U) / 1000U); // Rounded up, Windows counts in ms
+        const DWORD multiplier = (timeoutMs > 0) ? MAXDWORD : 0;
+        set = true;
+        if (cto.ReadIntervalTimeout != MAXDWORD || cto.ReadTotalTimeoutMultiplier != multiplier || cto.ReadTotalTimeoutConstant != timeoutMs)
+        {
+            cto.ReadIntervalTimeout = MAXDWORD;
+            cto.ReadTotalTimeoutMultiplier = multiplier;
+            cto.ReadTotalTimeoutConstant = timeoutMs;
+            set = SetCommTimeouts(HANDLE_OF(context), &cto) ? true : false;
+        }
+    }
+    return set;
+}
+
+bool configurePortWindows(serialContext * context)
 {
     bool configured = false;
     DCB dcbSerialParams = {0};
     dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
-    if (GetCommState(serialConnection, &dcbSerialParams))
+    if (GetCommState(HANDLE_OF(context), &dcbSerialParams))
     {
-        dcbSerialParams.BaudRate = context.serialBaud;
+        dcbSerialParams.BaudRate = context->serialBaud;
         dcbSerialParams.ByteSize = 8;
         dcbSerialParams.Parity = NOPARITY;
         dcbSerialParams.StopBits = ONESTOPBIT;
 
-        if (SetCommState(serialConnection, &dcbSerialParams))
+        if (SetCommState(HANDLE_OF(context), &dcbSerialParams))
         {
-            COMMTIMEOUTS cto;
-            if(GetCommTimeouts(serialConnection, &cto))
-            {
-                cto.ReadIntervalTimeout = 0;
-                cto.ReadTotalTimeoutConstant = 500;
-                cto.ReadTotalTimeoutMultiplier = 0;
-                if(SetCommTimeouts(serialConnection, &cto))
-                {
-                    configured = true;
-                }
-            }
+            configured = setReadTimeout(context);
         }
         else
         {
             fprintf(stderr, "Error: Could not set port attributes\r\n");
-            CloseHandle(serialConnection);
+            CloseHandle(HANDLE_OF(context));
+            context->serialHandle = NULL;
         }
     }
     else
     {
         fprintf(stderr, "Error: Could not get port attributes\r\n");
-        CloseHandle(serialConnection);
+        CloseHandle(HANDLE_OF(context));
+        context->serialHandle = NULL;
     }
 
     return configured;
 }
 
-int readWindows(char* bytes, const uint16_t length)
+int readWindows(serialContext * context, char* bytes, const uint16_t length)
 {
     DWORD bytesRead = -1;
 
-    if (serialState == OPEN)
+    if (context->serialState == OPEN && setReadTimeout(context)) // Picks up a changed serialReadTimeoutUs
     {
-        if (ReadFile(serialConnection, bytes, length, &bytesRead, NULL) != true)
+        if (ReadFile(HANDLE_OF(context), bytes, length, &bytesRead, NULL) != true)
         {
             bytesRead = -1;
         }
@@ -121,12 +133,12 @@ int readWindows(char* bytes, const uint16_t length)
     return bytesRead;
 }
 
-int writeWindows(const char* data, const uint16_t length)
+int writeWindows(serialContext * context, const char* data, const uint16_t length)
 {
     DWORD bytesWritten = -1;
-    if (serialState == OPEN)
+    if (context->serialState == OPEN)
     {
-        if (WriteFile(serialConnection, data, length, &bytesWritten, NULL) != true)
+        if (WriteFile(HANDLE_OF(context), data, length, &bytesWritten, NULL) != true)
         {
             bytesWritten = -1;
         }
@@ -136,11 +148,11 @@ int writeWindows(const char* data, const uint16_t length)
     return bytesWritten;
 }
 
-int peekWindows(void)
+int peekWindows(serialContext * context)
 {
     COMSTAT status;
     DWORD errors;
-    if (ClearCommError(serialConnection, &errors, &status))
+    if (context->serialHandle != NULL && ClearCommError(HANDLE_OF(context), &errors, &status))
     {
         return status.cbInQue;
     }
@@ -7,61 +7,74 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "serial.h"
 
 /**
  * @brief Sets the serial communication context for a Windows system.
  *
+ * The Windows HANDLE of the open port is kept in serialContext::serialHandle.
+ *
+ * @param context The serial context to populate.
  * @param port The name of the serial port (e.g., "COM1").
  * @param baud The baud rate for communication.
  * @return true if the context was set successfully, false otherwise.
  */
-bool setContextWindows(const char * port, const uint32_t baud);
+bool setContextWindows(serialContext * context, const char * port, const uint32_t baud);
 
 /**
  * @brief Opens the previously configured serial port.
  *
+ * @param context The serial context.
  * @return true if the port was opened successfully, false otherwise.
  */
-bool openPortWindows(void);
+bool openPortWindows(serialContext * context);
 
 /**
  * @brief Closes the currently open serial port.
  *
+ * @param context The serial context.
  * @return true if the port was closed successfully, false otherwise.
  */
-bool closePortWindows(void);
+bool closePortWindows(serialContext * context);
 
 /**
  * @brief Configures the open serial port with the desired settings.
  *
+ * @param context The serial context.
  * @return true if configuration was successful, false otherwise.
  */
-bool configurePortWindows(void);
+bool configurePortWindows(serialContext * context);
 
 /**
  * @brief Writes data to the serial port.
  *
+ * @param context The serial context.
  * @param data Pointer to the data to send.
  * @param length Number of bytes to write.
  * @return Number of bytes actually written, or -1 on failure.
  */
-int writeWindows(const char * data, const uint16_t length);
+int writeWindows(serialContext * context, const char * data, const uint16_t length);
 
 /**
  * @brief Reads data from the serial port.
  *
+ * Returns what is buffered straight away, otherwise waits up to
+ * serialContext::serialReadTimeoutUs (rounded up to whole ms) for data to arrive.
+ *
+ * @param context The serial context.
  * @param bytes Buffer to store the received data.
  * @param length Maximum number of bytes to read.
  * @return Number of bytes actually read, or -1 on failure.
  */
-int readWindows(char * bytes, const uint16_t length);
+int readWindows(serialContext * context, char * bytes, const uint16_t length);
 
 /**
  * @brief Peeks at the number of bytes available in the receive buffer.
  *
+ * @param context The serial context.
  * @return Number of bytes available to read, or -1 on error.
  */
-int peekWindows(void);
+int peekWindows(serialContext * context);
 
 /**
  * @brief Converts a given baud rate enumeration or value to the corresponding system value.
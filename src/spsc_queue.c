@@ -0,0 +1,66 @@
+#if defined(__linux__) || defined(__APPLE__)
+#include "spsc_queue.h"
+#include <string.h>
+
+void spscQueueInit(spsc_queue_t * queue, void * storage, const size_t itemSize, const size_t capacity)
+{
+    queue->slots = (uint8_t *)storage;
+    queue->itemSize = itemSize;
+    queue->capacity = capacity;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+bool spscQueuePush(spsc_queue_t * queue, const void * item)
+{
+    bool pushed = false;
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if ((tail - head) < queue->capacity)
+    {
+        memcpy(&queue->slots[(tail % queue->capacity) * queue->itemSize], item, queue->itemSize);
+        atomic_store_explicit(&queue->tail, tail + 1U, memory_order_release); // Publish the item
+        pushed = true;
+    }
+    return pushed;
+}
+
+bool spscQueuePeek(spsc_queue_t * queue, void * item)
+{
+    bool peeked = false;
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head != tail)
+    {
+        memcpy(item, &queue->slots[(head % queue->capacity) * queue->itemSize], queue->itemSize);
+        peeked = true;
+    }
+    return peeked;
+}
+
+bool spscQueuePop(spsc_queue_t * queue, void * item)
+{
+    bool popped = false;
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head != tail)
+    {
+        if (item != NULL)
+        {
+            memcpy(item, &queue->slots[(head % queue->capacity) * queue->itemSize], queue->itemSize);
+        }
+        atomic_store_explicit(&queue->head, head + 1U, memory_order_release); // Hand the slot back
+        popped = true;
+    }
+    return popped;
+}
+
+size_t spscQueueCount(spsc_queue_t * queue)
+{
+    return atomic_load_explicit(&queue->tail, memory_order_acquire) -
+           atomic_load_explicit(&queue->head, memory_order_acquire);
+}
+#endif
@@ -0,0 +1,83 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @struct spsc_queue_t
+ * @brief Lock-free single-producer/single-consumer ring of fixed size items.
+ *
+ * Exactly one thread may push and exactly one other thread may pop. head and
+ * tail are free running counters, the producer only writes tail and the
+ * consumer only writes head, so no lock is needed between the two.
+ */
+typedef struct
+{
+    uint8_t * slots;            /**< Caller supplied storage, capacity * itemSize bytes */
+    size_t itemSize;            /**< Size of a single item in bytes */
+    size_t capacity;            /**< Number of items the ring can hold */
+    atomic_size_t head;         /**< Number of items popped so far, written by the consumer */
+    atomic_size_t tail;         /**< Number of items pushed so far, written by the producer */
+} spsc_queue_t;
+
+/**
+ * @brief Initialise a queue over caller supplied storage.
+ *
+ * @param queue Pointer to the queue.
+ * @param storage Storage for capacity items of itemSize bytes each.
+ * @param itemSize Size of a single item in bytes.
+ * @param capacity Number of items the ring can hold.
+ */
+void spscQueueInit(spsc_queue_t * queue, void * storage, const size_t itemSize, const size_t capacity);
+
+/**
+ * @brief Copy an item into the queue, producer side only.
+ *
+ * @param queue Pointer to the queue.
+ * @param item Pointer to the item to copy in.
+ * @return true if queued, false if the queue is full.
+ */
+bool spscQueuePush(spsc_queue_t * queue, const void * item);
+
+/**
+ * @brief Copy the oldest item out without removing it, consumer side only.
+ *
+ * @param queue Pointer to the queue.
+ * @param item Pointer to storage for the item.
+ * @return true if an item was copied, false if the queue is empty.
+ */
+bool spscQueuePeek(spsc_queue_t * queue, void * item);
+
+/**
+ * @brief Copy the oldest item out and remove it, consumer side only.
+ *
+ * @param queue Pointer to the queue.
+ * @param item Pointer to storage for the item, may be NULL to discard it.
+ * @return true if an item was removed, false if the queue is empty.
+ */
+bool spscQueuePop(spsc_queue_t * queue, void * item);
+
+/**
+ * @brief Number of items currently queued, exact only from the producer or consumer thread.
+ *
+ * @param queue Pointer to the queue.
+ * @return Number of queued items.
+ */
+size_t spscQueueCount(spsc_queue_t * queue);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif